@@ -0,0 +1,54 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#include "allocation_counter.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+   std::atomic<bool> g_counting{false};
+   std::atomic<uint64_t> g_allocations{0};
+}  // namespace
+
+namespace benchmark {
+   void count_allocations(const bool enable) {
+      if (enable) {
+         g_allocations.store(0);
+      }
+      g_counting.store(enable);
+   }
+
+   uint64_t allocations() {
+      return g_allocations.load();
+   }
+}  // namespace benchmark
+
+// array and nothrow new end up here as well
+void* operator new(std::size_t size) {
+   if (g_counting.load(std::memory_order_relaxed)) {
+      g_allocations.fetch_add(1, std::memory_order_relaxed);
+   }
+   void* memory = std::malloc(size ? size : 1);
+   if (nullptr == memory) {
+      throw std::bad_alloc();
+   }
+   return memory;
+}
+
+void operator delete(void* memory) noexcept {
+   std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+   std::free(memory);
+}
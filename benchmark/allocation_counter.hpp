@@ -0,0 +1,21 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <cstdint>
+
+namespace benchmark {
+   // Counts the calls to the global operator new, from all threads, while counting is on.
+   // The replacement operator new lives in allocation_counter.cpp and is only linked into the benchmark
+   void count_allocations(const bool enable);
+   uint64_t allocations();
+}  // namespace benchmark
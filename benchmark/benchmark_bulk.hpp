@@ -0,0 +1,133 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace benchmark {
+   // trivially copyable items of 'Bytes' size, the first 4 bytes carry the value
+   template <size_t Bytes>
+   struct sized_item {
+      uint32_t value = 0;
+      unsigned char padding[Bytes - sizeof(uint32_t)];
+   };
+
+   template <>
+   struct sized_item<sizeof(uint32_t)> {
+      uint32_t value = 0;
+   };
+
+   // producer -> circular_fifo<Item> -> consumer. 'Push' and 'Pop' move the items, one by one or in
+   // bulk. Returns the sum of the values as 'total_sum'
+   template <typename Item, typename Push, typename Pop>
+   result_t runItems(const size_t howMany, const size_t queue_size, Push push, Pop pop) {
+      auto queue = queue_api::CreateQueue<spsc::circular_fifo<Item>>(queue_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      uint64_t received = 0;
+      std::atomic<bool> started{false};
+      std::thread consumer([&] {
+         started = true;
+         while (received < howMany) {
+            if (0 == pop(receiver, received)) {
+               std::this_thread::yield();
+            }
+         }
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      benchmark::stopwatch watch;
+      for (size_t sent = 0; sent < howMany;) {
+         const size_t pushed = push(sender, sent);
+         sent += pushed;
+         if (0 == pushed) {
+            std::this_thread::yield();
+         }
+      }
+      consumer.join();
+      auto elapsed = watch.elapsed_ns();
+      Q_CHECK_EQ(received, uint64_t{howMany});
+      return {howMany, elapsed};
+   }
+
+   template <typename Item>
+   result_t runElementwise(const size_t howMany, const size_t queue_size) {
+      auto push = [](auto& sender, size_t) -> size_t {
+         Item item;
+         item.value = 1;
+         return sender.push(item) ? 1 : 0;
+      };
+      auto pop = [](auto& receiver, uint64_t& sum) -> size_t {
+         Item item;
+         if (!receiver.pop(item)) {
+            return 0;
+         }
+         sum += item.value;
+         return 1;
+      };
+      return runItems<Item>(howMany, queue_size, push, pop);
+   }
+
+   // push_n and pop_n of up to 'batch' items
+   template <typename Item>
+   result_t runBulk(const size_t howMany, const size_t queue_size, const size_t batch) {
+      std::vector<Item> in(batch);
+      for (auto& item : in) {
+         item.value = 1;
+      }
+      std::vector<Item> out(batch);
+      auto push = [&](auto& sender, size_t sent) -> size_t {
+         return sender.push_n(in.data(), std::min(batch, howMany - sent));
+      };
+      auto pop = [&](auto& receiver, uint64_t& sum) -> size_t {
+         const size_t popped = receiver.pop_n(out.data(), batch);
+         for (size_t i = 0; i < popped; ++i) {
+            sum += out[i].value;
+         }
+         return popped;
+      };
+      return runItems<Item>(howMany, queue_size, push, pop);
+   }
+
+   // push_n in batches, the consumer reads the items in place with peek and consume
+   template <typename Item>
+   result_t runReadView(const size_t howMany, const size_t queue_size, const size_t batch) {
+      std::vector<Item> in(batch);
+      for (auto& item : in) {
+         item.value = 1;
+      }
+      auto push = [&](auto& sender, size_t sent) -> size_t {
+         return sender.push_n(in.data(), std::min(batch, howMany - sent));
+      };
+      auto pop = [](auto& receiver, uint64_t& sum) -> size_t {
+         auto view = receiver.peek();
+         for (auto& item : view.first) {
+            sum += item.value;
+         }
+         for (auto& item : view.second) {
+            sum += item.value;
+         }
+         receiver.consume(view.size());
+         return view.size();
+      };
+      return runItems<Item>(howMany, queue_size, push, pop);
+   }
+}  // namespace benchmark
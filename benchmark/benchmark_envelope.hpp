@@ -0,0 +1,114 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "allocation_counter.hpp"
+#include "benchmark_functions.hpp"
+#include "q/envelope.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace benchmark {
+   // three message types through one queue: as unique_ptr<base> with a virtual call, or in an envelope with visit
+   struct base_message {
+      virtual ~base_message() = default;
+      virtual uint64_t handle() const = 0;
+   };
+   struct price_message : base_message {
+      price_message(uint64_t i) : id(i) {}
+      uint64_t handle() const override { return id; }
+      uint64_t id;
+      double price = 1.0;
+   };
+   struct order_message : base_message {
+      order_message(uint64_t i) : id(i) {}
+      uint64_t handle() const override { return id; }
+      uint64_t id;
+      uint64_t quantity = 100;
+      char symbol[16] = "Q";
+   };
+   struct cancel_message : base_message {
+      cancel_message(uint64_t i) : id(i) {}
+      uint64_t handle() const override { return id; }
+      uint64_t id;
+   };
+
+   // Returns the number of messages as 'total_sum', 'allocations' is the number of operator new calls
+   // made by both threads while the messages were passed
+   template <typename Element, typename Make, typename Handle>
+   result_t runMessages(const size_t howMany, const size_t queue_size, Make make, Handle handle, uint64_t& allocations) {
+      auto queue = queue_api::CreateQueue<spsc::circular_fifo<Element>>(queue_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      uint64_t sum = 0;
+      std::atomic<bool> started{false};
+      std::thread consumer([&] {
+         started = true;
+         for (auto& item : receiver) {
+            sum += handle(item);
+         }
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      count_allocations(true);
+      benchmark::stopwatch watch;
+      for (uint64_t i = 0; i < howMany; ++i) {
+         Element item = make(i);
+         while (!sender.push(item)) {
+            std::this_thread::yield();
+         }
+      }
+      sender.close();
+      consumer.join();
+      auto elapsed = watch.elapsed_ns();
+      count_allocations(false);
+      allocations = benchmark::allocations();
+      Q_CHECK_EQ(sum, uint64_t{howMany} * (howMany - 1) / 2);
+      return {howMany, elapsed};
+   }
+
+   inline result_t runVirtualMessages(const size_t howMany, const size_t queue_size, uint64_t& allocations) {
+      using Element = std::unique_ptr<base_message>;
+      auto make = [](uint64_t i) -> Element {
+         switch (i % 3) {
+            case 0: return Element(new price_message(i));
+            case 1: return Element(new order_message(i));
+            default: return Element(new cancel_message(i));
+         }
+      };
+      auto handle = [](Element& item) { return item->handle(); };
+      return runMessages<Element>(howMany, queue_size, make, handle, allocations);
+   }
+
+   inline result_t runEnvelopeMessages(const size_t howMany, const size_t queue_size, uint64_t& allocations) {
+      using Element = message::envelope<64>;
+      auto make = [](uint64_t i) -> Element {
+         switch (i % 3) {
+            case 0: return Element(price_message(i));
+            case 1: return Element(order_message(i));
+            default: return Element(cancel_message(i));
+         }
+      };
+      auto handle = [](Element& item) {
+         uint64_t id = 0;
+         item.visit<price_message, order_message, cancel_message>([&id](auto& msg) { id = msg.id; });
+         return id;
+      };
+      return runMessages<Element>(howMany, queue_size, make, handle, allocations);
+   }
+}  // namespace benchmark
@@ -60,11 +60,12 @@ namespace benchmark {
          Q_CHECK(q.wait_and_push(i, kMaxWaitMs));
          sum += i;
       }
+      q.close();
       return {sum, watch.elapsed_ns()};
    }
 
    template <typename Receiver>
-   result_t Get(Receiver q, size_t stop, std::atomic<bool>& producerStart, std::atomic<bool>& consumerStart) {
+   result_t Get(Receiver q, std::atomic<bool>& producerStart, std::atomic<bool>& consumerStart) {
       using namespace std::chrono_literals;
       consumerStart.store(true);
       while (!producerStart.load()) {
@@ -72,13 +73,8 @@ namespace benchmark {
       }
       benchmark::stopwatch watch;
       uint64_t sum = 0;
-      for (;;) {
-         unsigned int value = 0;
-         Q_CHECK(q.wait_and_pop(value, kMaxWaitMs));
+      for (auto value : q) {  // until the producer closes the queue
          sum += value;
-         if (value == stop) {
-            break;
-         }
       }
       return {sum, watch.elapsed_ns()};
    }
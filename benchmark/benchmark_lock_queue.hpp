@@ -0,0 +1,107 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/mpmc_lock_queue.hpp"
+#include "q/q_api.hpp"
+
+namespace benchmark {
+   // lock_queue as it was before 'wait_and_push': the sfinae_sender fallback polls 'push' instead
+   template <typename T>
+   class polling_lock_queue : public mpmc::lock_queue<T> {
+     public:
+      using mpmc::lock_queue<T>::lock_queue;
+
+     private:
+      using mpmc::lock_queue<T>::wait_and_push;
+   };
+
+   // 'runMPMC' passes its queue size, an unbounded queue is made with 'Args' instead
+   template <typename QueueType, int... Args>
+   class unbounded : public QueueType {
+     public:
+      explicit unbounded(size_t) :
+          QueueType(Args...) {}
+   };
+
+   // N producers and M consumers on one lock_queue. The last producer to finish closes the queue.
+   // 'drain': after each wait_and_pop the consumer takes the whole backlog with 'pop_all'.
+   // Returns the number of items as 'total_sum'
+   template <typename QueueType>
+   result_t runMPMC(const size_t howMany, const size_t producers, const size_t consumers, const size_t queue_size, const bool drain) {
+      using Element = typename QueueType::value_type;
+      auto queue = queue_api::CreateQueue<QueueType>(queue_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      const size_t per_producer = howMany / producers;
+      const uint64_t total = per_producer * producers;
+
+      std::atomic<size_t> running{producers};
+      std::atomic<uint64_t> received{0};
+      std::atomic<bool> start{false};
+      std::vector<std::thread> threads;
+      for (size_t p = 0; p < producers; ++p) {
+         threads.emplace_back([&, sender]() mutable {
+            while (!start.load()) {
+               std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per_producer; ++i) {
+               Element item = 1;
+               Q_CHECK(sender.wait_and_push(item, kMaxWaitMs));
+            }
+            if (1 == running.fetch_sub(1)) {
+               sender.close();
+            }
+         });
+      }
+      for (size_t c = 0; c < consumers; ++c) {
+         threads.emplace_back([&, receiver]() mutable {
+            while (!start.load()) {
+               std::this_thread::yield();
+            }
+            uint64_t sum = 0;
+            std::vector<Element> batch;
+            batch.reserve(queue_size);
+            Element item{};
+            for (;;) {
+               auto result = receiver.wait_and_pop(item, kMaxWaitMs);
+               if (result) {
+                  sum += item;
+                  if (drain) {
+                     batch.clear();
+                     receiver.pop_all(batch);
+                     for (auto& value : batch) {
+                        sum += value;
+                     }
+                  }
+               } else if (result.closed()) {
+                  break;
+               }
+            }
+            received += sum;
+         });
+      }
+
+      benchmark::stopwatch watch;
+      start = true;
+      for (auto& t : threads) {
+         t.join();
+      }
+      auto elapsed = watch.elapsed_ns();
+      Q_CHECK_EQ(received.load(), total);
+      return {total, elapsed};
+   }
+}  // namespace benchmark
@@ -1,14 +1,35 @@
+#include <ctime>
 #include <iomanip>
 #include <iostream>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
+#include <sstream>
+#include "benchmark_bulk.hpp"
+#include "benchmark_envelope.hpp"
 #include "benchmark_functions.hpp"
+#include "benchmark_lock_queue.hpp"
+#include "benchmark_mpsc.hpp"
+#include "benchmark_numa.hpp"
+#include "benchmark_object_pool.hpp"
+#include "benchmark_pointer_fifo.hpp"
+#include "benchmark_rpc_channel.hpp"
+#include "benchmark_round_robin.hpp"
 #include "benchmark_runs.hpp"
+#include "benchmark_thread_pool.hpp"
+#include "benchmark_work_stealing_deque.hpp"
+#include "q/lock_policy.hpp"
+#include "q/mpmc_flat_combining_queue.hpp"
 #include "q/mpmc_lock_queue.hpp"
+#include "q/mpmc_segmented_queue.hpp"
+#include "q/mpmc_two_lock_queue.hpp"
 #include "q/q_api.hpp"
 #include "q/spsc_circular_fifo.hpp"
 
 namespace {
    const size_t kGoodSizedQueueSize = (2 << 16);  // 65536
    const size_t kNumberOfItems = 1000000;
+   const unsigned int kFibonacci = 30;  // fork-join tasks spawned, see benchmark_thread_pool.hpp
 
    struct benchmark_result {
       int runs;
@@ -72,6 +93,158 @@ benchmark_result benchmark_queue(const std::string& comment) {
    return result;
 }
 
+// 'run()' is one run and returns the messages it moved in 'total_sum'. The rows below are built on it
+template <typename Run>
+benchmark_result aggregate_runs(Run run, const int runs, const size_t producers, const size_t consumers,
+                                const std::string& comment) {
+   double min_msgs_per_second = std::numeric_limits<double>::max();
+   double max_msgs_per_second = std::numeric_limits<double>::min();
+   double total_msgs_per_second = 0.0;
+   uint64_t messages = 0;
+
+   for (int i = 0; i < runs; ++i) {
+      auto result = run();
+      messages = result.total_sum;
+      double msgs_per_second = result.total_sum / (result.elapsed_time_in_ns / 1e9);
+      total_msgs_per_second += msgs_per_second;
+      min_msgs_per_second = std::min(min_msgs_per_second, msgs_per_second);
+      max_msgs_per_second = std::max(max_msgs_per_second, msgs_per_second);
+   }
+
+   benchmark_result result;
+   result.runs = runs;
+   result.num_producer_threads = static_cast<int>(producers);
+   result.num_consumer_threads = static_cast<int>(consumers);
+   result.messages_per_iteration = messages;
+   result.mean_msgs_per_second = total_msgs_per_second / runs;
+   result.min_msgs_per_second = min_msgs_per_second;
+   result.max_msgs_per_second = max_msgs_per_second;
+   result.comment = comment;
+   return result;
+}
+
+// same as 'benchmark_queue' with an unbounded queue, every push allocates from a fresh 'Resource' in each run
+template <typename QueueType, typename Resource>
+benchmark_result benchmark_queue_with_resource(const std::string& comment) {
+   auto run = [] {
+      Resource resource;  // outlives the queue
+      auto queue = queue_api::CreateQueue<QueueType>(-1, &resource);
+      auto result = benchmark::runSPSC(queue, kNumberOfItems);
+      result.total_sum = kNumberOfItems;  // runSPSC sums the values, not the messages
+      return result;
+   };
+   return aggregate_runs(run, 33, 1, 1, comment);
+}
+
+// N:M on one lock_queue, consumers pop one by one or drain with 'pop_all'
+template <typename QueueType>
+benchmark_result benchmark_mpmc(const size_t producers, const size_t consumers, const bool drain, const std::string& comment,
+                                const size_t queue_size = 1024) {
+   auto run = [&] { return benchmark::runMPMC<QueueType>(kNumberOfItems, producers, consumers, queue_size, drain); };
+   return aggregate_runs(run, 5, producers, consumers, comment);
+}
+
+// as 'benchmark_mpmc' with pop per item, the comment gets the process CPU time per wall clock time:
+// how many cores were kept busy. Spinning shows up here even when it does not show in the throughput
+template <typename QueueType>
+benchmark_result benchmark_mpmc_cpu(const size_t producers, const size_t consumers, const std::string& comment) {
+   benchmark::stopwatch watch;
+   const std::clock_t cpu_start = std::clock();
+   auto result = benchmark_mpmc<QueueType>(producers, consumers, false, comment);
+   const double cpu_s = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+   const double wall_s = watch.elapsed_ns() / 1e9;
+
+   std::ostringstream cores;
+   cores << std::fixed << std::setprecision(2) << cpu_s / wall_s;
+   result.comment += ", cpu cores busy: " + cores.str();
+   return result;
+}
+
+// N producers and one consumer, 'run(howMany, producers)' is one of the MPSC runs in benchmark_mpsc.hpp.
+// The 1:1 runs in benchmark_bulk.hpp, benchmark_numa.hpp and benchmark_pointer_fifo.hpp use it with one producer
+template <typename Run>
+benchmark_result benchmark_mpsc(Run run, const size_t producers, const std::string& comment) {
+   return aggregate_runs([&] { return run(kNumberOfItems, producers); }, 5, producers, 1, comment);
+}
+
+// one producer and N consumers, 'run(howMany, consumers)' is one of the SPMC runs in benchmark_round_robin.hpp
+template <typename Run>
+benchmark_result benchmark_spmc(Run run, const size_t consumers, const std::string& comment) {
+   auto result = benchmark_mpsc(run, consumers, comment);
+   std::swap(result.num_producer_threads, result.num_consumer_threads);
+   return result;
+}
+
+// Pool workloads: 'messages' are tasks
+template <typename Pool, typename Workload>
+benchmark_result benchmark_pool(Workload workload, const std::string& comment) {
+   const size_t workers = std::max(2u, std::thread::hardware_concurrency());
+   auto run = [&] {
+      Pool pool(workers);
+      return workload(pool);
+   };
+   return aggregate_runs(run, 5, 1, workers, comment);
+}
+
+// 1 owner, N thieves
+benchmark_result benchmark_work_stealing_deque(const size_t thieves) {
+   auto run = [&] { return benchmark::runOwnerThieves(kNumberOfItems, thieves); };
+   return aggregate_runs(run, 5, 1, thieves, "Work stealing deque, 1 owner and N thieves");
+}
+
+// request/reply round trips between two threads
+benchmark_result benchmark_rpc_channel(const size_t in_flight, const std::string& comment) {
+   return aggregate_runs([&] { return benchmark::runPingPong(kNumberOfItems, in_flight); }, 5, 1, 1, comment);
+}
+
+// 1:1 through a circular_fifo, see benchmark_bulk.hpp
+template <size_t Bytes>
+void print_bulk_results() {
+   using item = benchmark::sized_item<Bytes>;
+   const size_t kQueueSize = 1024;
+   const size_t kBatch = 64;
+   const std::string size = std::to_string(Bytes) + "B items";
+   print_result(benchmark_mpsc([&](size_t howMany, size_t) { return benchmark::runElementwise<item>(howMany, kQueueSize); }, 1,
+                               "circular_fifo " + size + ", push/pop per item"));
+   print_result(benchmark_mpsc([&](size_t howMany, size_t) { return benchmark::runBulk<item>(howMany, kQueueSize, kBatch); }, 1,
+                               "circular_fifo " + size + ", push_n/pop_n of 64"));
+   print_result(benchmark_mpsc([&](size_t howMany, size_t) { return benchmark::runReadView<item>(howMany, kQueueSize, kBatch); }, 1,
+                               "circular_fifo " + size + ", push_n of 64, peek/consume"));
+}
+
+// SPSC with the ring and the two threads on chosen NUMA nodes, the comment gets where the ring ended up
+void print_numa_result(const int ring_node, const int producer_node, const int consumer_node, const std::string& comment) {
+   using item = benchmark::sized_item<64>;
+   numa::placement where;
+   auto run = [&](size_t howMany, size_t) {
+      return benchmark::runPlacedSPSC<item>(howMany, kGoodSizedQueueSize, ring_node, producer_node, consumer_node, where);
+   };
+   auto result = benchmark_mpsc(run, 1, comment);
+   result.comment += ", ring on node " + std::to_string(where.node) + (where.bound ? " (bound)" : " (not bound)");
+   print_result(result);
+}
+
+// payloads/messages through a circular_fifo, the comment gets the operator new calls per message
+template <typename Run>
+benchmark_result benchmark_payloads(Run run, const std::string& comment) {
+   const int kRuns = 5;
+   const size_t kQueueSize = 1024;
+   uint64_t total_allocations = 0;
+   auto counted = [&] {
+      uint64_t allocations = 0;
+      auto result = run(kNumberOfItems, kQueueSize, allocations);
+      total_allocations += allocations;
+      return result;
+   };
+   auto result = aggregate_runs(counted, kRuns, 1, 1, comment);
+
+   std::ostringstream allocations_per_message;
+   allocations_per_message << std::fixed << std::setprecision(4)
+                           << static_cast<double>(total_allocations) / (kRuns * kNumberOfItems);
+   result.comment += ", allocations/msg: " + allocations_per_message.str();
+   return result;
+}
+
 int main() {
    // Print the headers
    std::cout << "#runs,\t#p,\t#c,\t#msgs/s,\t#min_msgs/s,\t#max_msgs/s,\tavg call [ns],\tcomment" << std::endl;
@@ -82,6 +255,111 @@ int main() {
    auto spsc_lockqueue_result = benchmark_queue<mpmc::lock_queue<unsigned int>>("SPSC using the lock-based MPMC benchmark");
    print_result(spsc_lockqueue_result);
 
+#if __has_include(<memory_resource>)
+   // a bounded lock_queue never allocates after construction, these rows use an unbounded one. It
+   // allocates under its mutex, so the unsynchronized resources are safe when not shared
+   print_result(benchmark_queue_with_resource<mpmc::pmr::lock_queue<unsigned int>, std::pmr::monotonic_buffer_resource>(
+       "SPSC using the lock-based MPMC, unbounded, pmr monotonic_buffer_resource"));
+   print_result(benchmark_queue_with_resource<mpmc::pmr::lock_queue<unsigned int>, std::pmr::unsynchronized_pool_resource>(
+       "SPSC using the lock-based MPMC, unbounded, pmr unsynchronized_pool_resource"));
+#endif
+
+   for (auto threads : {std::make_pair(1, 1), std::make_pair(4, 1), std::make_pair(1, 4), std::make_pair(4, 4), std::make_pair(8, 8)}) {
+      print_result(benchmark_mpmc<mpmc::lock_queue<unsigned int>>(threads.first, threads.second, false, "MPMC lock_queue, pop per item"));
+      print_result(benchmark_mpmc<mpmc::lock_queue<unsigned int>>(threads.first, threads.second, true, "MPMC lock_queue, pop_all"));
+      print_result(benchmark_mpmc<mpmc::two_lock_queue<unsigned int>>(threads.first, threads.second, false, "MPMC two_lock_queue, pop per item"));
+   }
+   // flat combining against the one and two lock queues as the thread count grows
+   for (int threads : {2, 4, 8, 16}) {
+      print_result(benchmark_mpmc<mpmc::lock_queue<unsigned int>>(threads, threads, false, "MPMC lock_queue, pop per item"));
+      print_result(benchmark_mpmc<mpmc::two_lock_queue<unsigned int>>(threads, threads, false, "MPMC two_lock_queue, pop per item"));
+      print_result(benchmark_mpmc<mpmc::flat_combining_queue<unsigned int>>(threads, threads, false, "MPMC flat_combining_queue, pop per item"));
+      print_result(benchmark_mpmc<benchmark::unbounded<mpmc::segmented_queue<unsigned int>>>(threads, threads, false, "MPMC segmented_queue (lock-free, unbounded), pop per item"));
+   }
+   // unbounded: the mutex queue's deque against the lock-free segments
+   for (auto threads : {std::make_pair(1, 1), std::make_pair(4, 1), std::make_pair(1, 4), std::make_pair(4, 4)}) {
+      print_result(benchmark_mpmc<benchmark::unbounded<mpmc::lock_queue<unsigned int>, -1>>(threads.first, threads.second, false, "MPMC unbounded lock_queue, pop per item"));
+      print_result(benchmark_mpmc<benchmark::unbounded<mpmc::segmented_queue<unsigned int>>>(threads.first, threads.second, false, "MPMC unbounded segmented_queue, pop per item"));
+   }
+   // lock policies for the lock_queue critical sections, at growing contention
+   using adaptive_lock_queue = mpmc::lock_queue<unsigned int, std::allocator<unsigned int>, lock_policy::adaptive_mutex>;
+   using ticket_lock_queue = mpmc::lock_queue<unsigned int, std::allocator<unsigned int>, lock_policy::ticket_mutex>;
+   for (int threads : {1, 2, 4, 8}) {
+      print_result(benchmark_mpmc_cpu<mpmc::lock_queue<unsigned int>>(threads, threads, "MPMC lock_queue, std::mutex"));
+      print_result(benchmark_mpmc_cpu<adaptive_lock_queue>(threads, threads, "MPMC lock_queue, adaptive_mutex"));
+      print_result(benchmark_mpmc_cpu<ticket_lock_queue>(threads, threads, "MPMC lock_queue, ticket_mutex"));
+   }
+   // full queue back-pressure
+   print_result(benchmark_mpmc<mpmc::lock_queue<unsigned int>>(4, 1, false, "MPMC lock_queue, 16 slots, wait_and_push", 16));
+   print_result(benchmark_mpmc<benchmark::polling_lock_queue<unsigned int>>(4, 1, false, "MPMC lock_queue, 16 slots, polling push", 16));
+
+   // unbounded linked MPSC and one shared ring against one SPSC lane per producer
+   auto round_robin = [](size_t howMany, size_t producers) { return benchmark::runRoundRobinMPSC(howMany, producers, 1024); };
+   auto shared_ring = [](size_t howMany, size_t producers) { return benchmark::runRingMPSC(howMany, producers, 1024); };
+   for (size_t producers : {2, 4, 8, 16, 32, 64}) {
+      print_result(benchmark_mpsc(round_robin, producers, "MPSC round-robin over SPSC lanes of 1024"));
+      print_result(benchmark_mpsc(shared_ring, producers, "MPSC ring_queue, one ring of 1024 for all producers"));
+      print_result(benchmark_mpsc(benchmark::runLinkedMPSC, producers, "MPSC linked_queue, node per push"));
+      print_result(benchmark_mpsc(benchmark::runIntrusiveMPSC, producers, "MPSC intrusive_linked_queue, preallocated nodes"));
+   }
+   // round-robin lanes in a std::vector against N known at compile time
+   auto static_4_to_1 = [](size_t howMany, size_t) { return benchmark::runStaticRoundRobinMPSC<4>(howMany, 1024); };
+   auto one_to_n = [](size_t howMany, size_t consumers) { return benchmark::runRoundRobinSPMC(howMany, consumers, 1024); };
+   auto static_1_to_8 = [](size_t howMany, size_t) { return benchmark::runStaticRoundRobinSPMC<8>(howMany, 1024); };
+   print_result(benchmark_mpsc(round_robin, 4, "MPSC round-robin, lanes in a vector"));
+   print_result(benchmark_mpsc(static_4_to_1, 4, "MPSC round-robin, static_size<4>"));
+   print_result(benchmark_spmc(one_to_n, 8, "SPMC round-robin, lanes in a vector"));
+   print_result(benchmark_spmc(static_1_to_8, 8, "SPMC round-robin, static_size<8>"));
+   // round-robin lanes in one allocation against a shared_ptr and a std::vector per lane
+   auto flat_n_to_1 = [](size_t howMany, size_t producers) { return benchmark::runFlatMPSC(howMany, producers, 1024); };
+   auto flat_1_to_n = [](size_t howMany, size_t consumers) { return benchmark::runFlatSPMC(howMany, consumers, 1024); };
+   for (size_t lanes : {4, 16, 64}) {
+      print_result(benchmark_mpsc(round_robin, lanes, "MPSC round-robin, lane per allocation"));
+      print_result(benchmark_mpsc(flat_n_to_1, lanes, "MPSC flat lanes, one allocation"));
+   }
+   print_result(benchmark_spmc(one_to_n, 8, "SPMC round-robin, lane per allocation"));
+   print_result(benchmark_spmc(flat_1_to_n, 8, "SPMC flat lanes, one allocation"));
+
+   auto tiny_tasks = [](auto& pool) { return benchmark::runTinyTasks(pool, kNumberOfItems); };
+   auto fork_join = [](auto& pool) { return benchmark::runForkJoin(pool, kFibonacci); };
+   print_result(benchmark_pool<executor::work_stealing_pool>(tiny_tasks, "Thread pool, tiny tasks: work stealing"));
+   print_result(benchmark_pool<benchmark::lock_queue_pool>(tiny_tasks, "Thread pool, tiny tasks: lock_queue fed"));
+   print_result(benchmark_pool<executor::work_stealing_pool>(fork_join, "Thread pool, fork-join: work stealing"));
+   print_result(benchmark_pool<benchmark::lock_queue_pool>(fork_join, "Thread pool, fork-join: lock_queue fed"));
+
+   for (size_t thieves : {1, 2, 4, 8}) {
+      print_result(benchmark_work_stealing_deque(thieves));
+   }
+
+   print_result(benchmark_rpc_channel(1, "RPC channel ping-pong, 1 call in flight (round trip latency)"));
+   print_result(benchmark_rpc_channel(16, "RPC channel ping-pong, 16 calls in flight"));
+
+   // trivially copyable items: element-wise against the memcpy bulk path
+   print_bulk_results<4>();
+   print_bulk_results<16>();
+   print_bulk_results<64>();
+
+   // one node: all rows are the same placement. Try 'numactl --cpunodebind=0' on a NUMA machine
+   const int far_node = numa::node_count() - 1;
+   const std::string nodes = ", " + std::to_string(numa::node_count()) + " NUMA node(s)";
+   print_numa_result(0, 0, 0, "circular_fifo 64B items, ring and threads on node 0" + nodes);
+   print_numa_result(far_node, 0, 0, "circular_fifo 64B items, threads on node 0, ring on the last node" + nodes);
+   print_numa_result(far_node, 0, far_node, "circular_fifo 64B items, ring on the consumer's node" + nodes);
+   print_numa_result(0, 0, far_node, "circular_fifo 64B items, ring on the producer's node" + nodes);
+
+   for (size_t queue_size : {64, 1024, 65536}) {
+      const std::string slots = std::to_string(queue_size) + " slots";
+      auto circular = [&](size_t howMany, size_t) { return benchmark::runPointers<spsc::circular_fifo<unsigned int*>>(howMany, queue_size); };
+      auto pointers = [&](size_t howMany, size_t) { return benchmark::runPointers<spsc::pointer_fifo<unsigned int*>>(howMany, queue_size); };
+      print_result(benchmark_mpsc(circular, 1, "Pointers: circular_fifo, " + slots));
+      print_result(benchmark_mpsc(pointers, 1, "Pointers: pointer_fifo, " + slots));
+   }
+
+   print_result(benchmark_payloads(benchmark::runUniquePayloads, "256 byte payloads: unique_ptr"));
+   print_result(benchmark_payloads(benchmark::runPooledPayloads, "256 byte payloads: object_pool"));
+   print_result(benchmark_payloads(benchmark::runVirtualMessages, "3 message types: unique_ptr<base>, virtual call"));
+   print_result(benchmark_payloads(benchmark::runEnvelopeMessages, "3 message types: envelope<64>, visit"));
+
    return 0;
 }
 
@@ -0,0 +1,149 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/mpsc_fixed_receiver_round_robin.hpp"
+#include "q/mpsc_linked_queue.hpp"
+#include "q/mpsc_ring_queue.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace benchmark {
+   struct mpsc_message : mpsc::intrusive_node {
+      unsigned int value = 1;
+   };
+
+   // N producer threads push 'per_producer' items each with 'push(producer_index, i)', one consumer
+   // counts them with 'pop(count)'. Returns the number of items as 'total_sum'
+   template <typename Push, typename Pop>
+   result_t runProducers(const size_t producers, const size_t per_producer, Push push, Pop pop) {
+      const uint64_t total = per_producer * producers;
+      std::atomic<bool> start{false};
+      std::vector<std::thread> threads;
+      for (size_t p = 0; p < producers; ++p) {
+         threads.emplace_back([&, p] {
+            while (!start.load()) {
+               std::this_thread::yield();
+            }
+            for (size_t i = 0; i < per_producer; ++i) {
+               push(p, i);
+            }
+         });
+      }
+
+      benchmark::stopwatch watch;
+      start = true;
+      uint64_t received = 0;
+      while (received < total) {
+         pop(received);
+      }
+      auto elapsed = watch.elapsed_ns();
+      for (auto& t : threads) {
+         t.join();
+      }
+      Q_CHECK_EQ(received, total);
+      return {total, elapsed};
+   }
+
+   // one SPSC lane per producer, the consumer round-robins over them
+   inline result_t runRoundRobinMPSC(const size_t howMany, const size_t producers, const size_t lane_size) {
+      using QType = spsc::circular_fifo<unsigned int>;
+      std::vector<queue_api::Sender<QType>> senders;
+      std::vector<queue_api::Receiver<QType>> receivers;
+      for (size_t p = 0; p < producers; ++p) {
+         auto queue = queue_api::CreateQueue<QType>(lane_size);
+         senders.push_back(std::get<queue_api::index::sender>(queue));
+         receivers.push_back(std::get<queue_api::index::receiver>(queue));
+      }
+      mpsc::fixed_size::round_robin::Receiver<QType> receiver(receivers);
+
+      auto push = [&](size_t producer, size_t) {
+         unsigned int item = 1;
+         while (!senders[producer].push(item)) {
+            std::this_thread::yield();
+         }
+      };
+      auto pop = [&](uint64_t& count) {
+         unsigned int item = 0;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item;
+         }
+      };
+      return runProducers(producers, howMany / producers, push, pop);
+   }
+
+   // all producers share one ring of 'ring_size'
+   inline result_t runRingMPSC(const size_t howMany, const size_t producers, const size_t ring_size) {
+      auto queue = queue_api::CreateQueue<mpsc::ring_queue<unsigned int>>(ring_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      auto push = [&](size_t, size_t) {
+         unsigned int item = 1;
+         while (!sender.push(item)) {
+            std::this_thread::yield();
+         }
+      };
+      auto pop = [&](uint64_t& count) {
+         unsigned int item = 0;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item;
+         }
+      };
+      return runProducers(producers, howMany / producers, push, pop);
+   }
+
+   // one node allocation per push
+   inline result_t runLinkedMPSC(const size_t howMany, const size_t producers) {
+      auto queue = queue_api::CreateQueue<mpsc::linked_queue<unsigned int>>();
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      auto push = [&](size_t, size_t) {
+         unsigned int item = 1;
+         sender.push(item);
+      };
+      auto pop = [&](uint64_t& count) {
+         unsigned int item = 0;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item;
+         }
+      };
+      return runProducers(producers, howMany / producers, push, pop);
+   }
+
+   // the messages are allocated before the run, as they would be in a pool
+   inline result_t runIntrusiveMPSC(const size_t howMany, const size_t producers) {
+      auto queue = queue_api::CreateQueue<mpsc::intrusive_linked_queue<mpsc_message>>();
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      const size_t per_producer = howMany / producers;
+      std::unique_ptr<mpsc_message[]> messages(new mpsc_message[per_producer * producers]);
+
+      auto push = [&](size_t producer, size_t i) {
+         mpsc_message* item = &messages[producer * per_producer + i];
+         sender.push(item);
+      };
+      auto pop = [&](uint64_t& count) {
+         mpsc_message* item = nullptr;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item->value;
+         }
+      };
+      return runProducers(producers, per_producer, push, pop);
+   }
+}  // namespace benchmark
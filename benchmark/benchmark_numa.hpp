@@ -0,0 +1,69 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include "benchmark_bulk.hpp"
+#include "benchmark_functions.hpp"
+#include "q/numa.hpp"
+#include "q/q_api.hpp"
+
+namespace benchmark {
+   // producer pinned to 'producer_node' -> circular_fifo on 'ring_node' -> consumer pinned to
+   // 'consumer_node'. 'where' gets the ring's placement. On one node all runs are the same placement,
+   // run under 'numactl' on a NUMA (or numa=fake) machine to compare
+   template <typename Item>
+   result_t runPlacedSPSC(const size_t howMany, const size_t queue_size, const int ring_node, const int producer_node,
+                          const int consumer_node, numa::placement& where) {
+      numa::allocator<Item> memory(ring_node);
+      auto queue = queue_api::CreateQueue<spsc::numa::circular_fifo<Item>>(queue_size, memory);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      where = memory.placement();
+
+      uint64_t received = 0;
+      std::atomic<bool> started{false};
+      std::thread consumer([&] {
+         numa::pin_this_thread(consumer_node);
+         started = true;
+         Item item;
+         for (size_t i = 0; i < howMany; ++i) {
+            while (!receiver.pop(item)) {
+               std::this_thread::yield();
+            }
+            received += item.value;
+         }
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      benchmark::stopwatch watch;
+      std::thread producer([&] {
+         numa::pin_this_thread(producer_node);
+         Item item;
+         item.value = 1;
+         for (size_t i = 0; i < howMany; ++i) {
+            while (!sender.push(item)) {
+               std::this_thread::yield();
+            }
+         }
+      });
+      producer.join();
+      consumer.join();
+      auto elapsed = watch.elapsed_ns();
+      Q_CHECK_EQ(received, uint64_t{howMany});
+      return {howMany, elapsed};
+   }
+}  // namespace benchmark
@@ -0,0 +1,89 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include "allocation_counter.hpp"
+#include "benchmark_functions.hpp"
+#include "q/object_pool.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace benchmark {
+   struct payload {
+      uint64_t value = 0;
+      char data[248];
+   };
+
+   // producer -> circular_fifo -> consumer with a heap payload per message.
+   // Returns the number of messages as 'total_sum', 'allocations' is the number of operator new calls
+   // made by both threads while the messages were passed
+   template <typename MakePayload, typename Pointer>
+   result_t runPayloads(const size_t howMany, const size_t queue_size, MakePayload make_payload, uint64_t& allocations) {
+      auto queue = queue_api::CreateQueue<spsc::circular_fifo<Pointer>>(queue_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      uint64_t received = 0;
+      std::atomic<bool> started{false};
+      std::thread consumer([&] {
+         started = true;
+         uint64_t expected = 0;
+         for (auto& item : receiver) {  // the previous payload is released when the next is popped
+            Q_CHECK_EQ(item->value, expected);
+            ++expected;
+         }
+         received = expected;
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      count_allocations(true);
+      benchmark::stopwatch watch;
+      for (uint64_t i = 0; i < howMany; ++i) {
+         Pointer item = make_payload();
+         item->value = i;
+         while (!sender.push(item)) {
+            std::this_thread::yield();
+         }
+      }
+      sender.close();
+      consumer.join();
+      auto elapsed = watch.elapsed_ns();
+      count_allocations(false);
+      allocations = benchmark::allocations();
+      Q_CHECK_EQ(received, uint64_t{howMany});
+      return {howMany, elapsed};
+   }
+
+   inline result_t runUniquePayloads(const size_t howMany, const size_t queue_size, uint64_t& allocations) {
+      auto make_payload = [] { return std::unique_ptr<payload>(new payload); };
+      return runPayloads<decltype(make_payload), std::unique_ptr<payload>>(howMany, queue_size, make_payload, allocations);
+   }
+
+   // the pool has room for a full queue, the payload the consumer holds and the one being pushed
+   inline result_t runPooledPayloads(const size_t howMany, const size_t queue_size, uint64_t& allocations) {
+      pool::object_pool<payload> payloads(queue_size + 2);
+      auto make_payload = [&payloads] {
+         auto item = payloads.acquire();
+         while (!item) {
+            std::this_thread::yield();
+            item = payloads.acquire();
+         }
+         return item;
+      };
+      return runPayloads<decltype(make_payload), pool::pooled_ptr<payload>>(howMany, queue_size, make_payload, allocations);
+   }
+}  // namespace benchmark
@@ -0,0 +1,61 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+#include "q/spsc_pointer_fifo.hpp"
+
+namespace benchmark {
+   // producer -> QType -> consumer with pointers to values that exist before the run, so only the
+   // queue is measured. Both sides retry with a yield. Returns the sum of the values as 'total_sum'
+   template <typename QType>
+   result_t runPointers(const size_t howMany, const size_t queue_size) {
+      auto queue = queue_api::CreateQueue<QType>(queue_size);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      std::vector<unsigned int> values(howMany, 1);
+
+      uint64_t received = 0;
+      std::atomic<bool> started{false};
+      std::thread consumer([&] {
+         started = true;
+         unsigned int* item = nullptr;
+         for (size_t i = 0; i < howMany; ++i) {
+            while (!receiver.pop(item)) {
+               std::this_thread::yield();
+            }
+            received += *item;
+         }
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      benchmark::stopwatch watch;
+      for (size_t i = 0; i < howMany; ++i) {
+         unsigned int* item = &values[i];
+         while (!sender.push(item)) {
+            std::this_thread::yield();
+         }
+      }
+      consumer.join();
+      auto elapsed = watch.elapsed_ns();
+      Q_CHECK_EQ(received, uint64_t{howMany});
+      return {howMany, elapsed};
+   }
+}  // namespace benchmark
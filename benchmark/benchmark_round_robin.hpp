@@ -0,0 +1,151 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "benchmark_mpsc.hpp"
+#include "q/flat_lanes.hpp"
+#include "q/mpsc_fixed_receiver_round_robin.hpp"
+#include "q/q_api.hpp"
+#include "q/round_robin_api.hpp"
+#include "q/spmc_fixed_sender_round_robin.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace benchmark {
+   // as runRoundRobinMPSC with the N lanes known at compile time
+   template <size_t N>
+   result_t runStaticRoundRobinMPSC(const size_t howMany, const size_t lane_size) {
+      using QType = spsc::circular_fifo<unsigned int>;
+      auto lanes = round_robin::CreateLanes<QType, N>(lane_size);
+      auto& senders = lanes.first;
+      mpsc::static_size::round_robin::Receiver<QType, N> receiver(lanes.second);
+
+      auto push = [&](size_t producer, size_t) {
+         unsigned int item = 1;
+         while (!senders[producer].push(item)) {
+            std::this_thread::yield();
+         }
+      };
+      auto pop = [&](uint64_t& count) {
+         unsigned int item = 0;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item;
+         }
+      };
+      return runProducers(N, howMany / N, push, pop);
+   }
+
+   // one producer pushes 'howMany' items with 'push()', each consumer pops its own lane with
+   // 'pop(consumer)' until it is closed and returns the sum it got. Returns the total as 'total_sum'
+   template <typename Push, typename Close, typename Pop>
+   result_t runConsumers(const size_t howMany, const size_t consumers, Push push, Close close, Pop pop) {
+      std::atomic<bool> start{false};
+      std::vector<uint64_t> sums(consumers, 0);
+      std::vector<std::thread> threads;
+      for (size_t c = 0; c < consumers; ++c) {
+         threads.emplace_back([&, c] {
+            while (!start.load()) {
+               std::this_thread::yield();
+            }
+            sums[c] = pop(c);
+         });
+      }
+
+      benchmark::stopwatch watch;
+      start = true;
+      for (size_t i = 0; i < howMany; ++i) {
+         push();
+      }
+      close();
+      for (auto& t : threads) {
+         t.join();
+      }
+      auto elapsed = watch.elapsed_ns();
+      uint64_t received = 0;
+      for (auto sum : sums) {
+         received += sum;
+      }
+      Q_CHECK_EQ(received, uint64_t{howMany});
+      return {received, elapsed};
+   }
+
+   template <typename Sender, typename Receivers>
+   result_t runRoundRobinConsumers(const size_t howMany, const size_t consumers, Sender& sender, Receivers& receivers) {
+      auto push = [&] {
+         unsigned int item = 1;
+         while (!sender.push(item)) {
+            std::this_thread::yield();
+         }
+      };
+      auto close = [&] { sender.close(); };
+      auto pop = [&](size_t consumer) {
+         uint64_t sum = 0;
+         for (auto value : receivers[consumer]) {
+            sum += value;
+         }
+         return sum;
+      };
+      return runConsumers(howMany, consumers, push, close, pop);
+   }
+
+   // one SPSC lane per consumer, the producer round-robins over them
+   inline result_t runRoundRobinSPMC(const size_t howMany, const size_t consumers, const size_t lane_size) {
+      using QType = spsc::circular_fifo<unsigned int>;
+      std::vector<queue_api::Sender<QType>> senders;
+      std::vector<queue_api::Receiver<QType>> receivers;
+      for (size_t c = 0; c < consumers; ++c) {
+         auto queue = queue_api::CreateQueue<QType>(lane_size);
+         senders.push_back(std::get<queue_api::index::sender>(queue));
+         receivers.push_back(std::get<queue_api::index::receiver>(queue));
+      }
+      spmc::fixed_size::round_robin::Sender<QType> sender(senders);
+      return runRoundRobinConsumers(howMany, consumers, sender, receivers);
+   }
+
+   template <size_t N>
+   result_t runStaticRoundRobinSPMC(const size_t howMany, const size_t lane_size) {
+      using QType = spsc::circular_fifo<unsigned int>;
+      auto lanes = round_robin::CreateLanes<QType, N>(lane_size);
+      spmc::static_size::round_robin::Sender<QType, N> sender(lanes.first);
+      return runRoundRobinConsumers(howMany, N, sender, lanes.second);
+   }
+
+   // as runRoundRobinMPSC with all lanes in one allocation
+   inline result_t runFlatMPSC(const size_t howMany, const size_t producers, const size_t lane_size) {
+      auto lanes = mpsc::flat::CreateLanes<unsigned int>(producers, lane_size);
+      auto& senders = lanes.first;
+      auto& receiver = lanes.second;
+
+      auto push = [&](size_t producer, size_t) {
+         unsigned int item = 1;
+         while (!senders[producer].push(item)) {
+            std::this_thread::yield();
+         }
+      };
+      auto pop = [&](uint64_t& count) {
+         unsigned int item = 0;
+         if (receiver.wait_and_pop(item, kMaxWaitMs)) {
+            count += item;
+         }
+      };
+      return runProducers(producers, howMany / producers, push, pop);
+   }
+
+   // as runRoundRobinSPMC with all lanes in one allocation
+   inline result_t runFlatSPMC(const size_t howMany, const size_t consumers, const size_t lane_size) {
+      auto lanes = spmc::flat::CreateLanes<unsigned int>(consumers, lane_size);
+      return runRoundRobinConsumers(howMany, consumers, lanes.first, lanes.second);
+   }
+}  // namespace benchmark
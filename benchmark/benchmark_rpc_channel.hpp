@@ -0,0 +1,66 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/rpc_channel.hpp"
+
+namespace benchmark {
+   // ping-pong: the client keeps 'in_flight' calls outstanding, the server answers with value + 1.
+   // With one call in flight the average call time is the round trip latency.
+   // Returns the number of calls as 'total_sum'
+   inline result_t runPingPong(const size_t howMany, const size_t in_flight) {
+      using Future = rpc::future<uint64_t, uint64_t>;
+      auto channel = rpc::CreateChannel<uint64_t, uint64_t>(in_flight);
+      auto client = std::get<rpc::index::client>(channel);
+      auto server = std::get<rpc::index::server>(channel);
+      std::atomic<bool> done{false};
+      std::atomic<bool> started{false};
+      std::thread serving([&] {
+         started = true;
+         while (!done.load(std::memory_order_relaxed)) {
+            if (0 == server.serve([](uint64_t& value) { return value + 1; })) {
+               std::this_thread::yield();
+            }
+         }
+      });
+      while (!started.load()) {
+         std::this_thread::yield();
+      }
+
+      std::vector<Future> calls(in_flight);
+      uint64_t errors = 0;
+      benchmark::stopwatch watch;
+      for (uint64_t i = 0; i < howMany; ++i) {
+         auto& call = calls[i % in_flight];
+         if (call.valid()) {
+            errors += (call.get() != i - in_flight + 1);
+         }
+         uint64_t request = i;
+         call = client.call(request);
+      }
+      for (uint64_t i = howMany; i < howMany + in_flight; ++i) {
+         auto& call = calls[i % in_flight];
+         if (call.valid()) {
+            errors += (call.get() != i - in_flight + 1);
+         }
+      }
+      auto elapsed = watch.elapsed_ns();
+      done = true;
+      serving.join();
+      Q_CHECK_EQ(errors, uint64_t{0});
+      return {howMany, elapsed};
+   }
+}  // namespace benchmark
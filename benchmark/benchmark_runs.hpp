@@ -22,7 +22,7 @@ namespace benchmark {
       auto prodResult = std::async(std::launch::async, benchmark::Push<decltype(producer)>,
                                    producer, stop, std::ref(producerStart), std::ref(consumerStart));
       auto consResult = std::async(std::launch::async, benchmark::Get<decltype(consumer)>,
-                                   consumer, stop, std::ref(producerStart), std::ref(consumerStart));
+                                   consumer, std::ref(producerStart), std::ref(consumerStart));
 
       auto sent = prodResult.get();
       auto received = consResult.get();
@@ -0,0 +1,142 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/mpmc_lock_queue.hpp"
+#include "q/thread_pool.hpp"
+
+namespace benchmark {
+   // Reference pool: all workers share ONE lock_queue. Waiting on a result
+   // runs queued tasks meanwhile, same as the work stealing pool
+   class lock_queue_pool {
+     public:
+      template <typename R>
+      struct result {
+         std::shared_ptr<std::atomic<bool>> ready;
+         std::shared_ptr<R> value;
+         lock_queue_pool* pool;
+         R get() {
+            while (!ready->load(std::memory_order_acquire)) {
+               if (!pool->run_one()) {
+                  std::this_thread::yield();
+               }
+            }
+            return *value;
+         }
+      };
+
+      explicit lock_queue_pool(const size_t workers) :
+          tasks_(-1),
+          stop_(false) {
+         for (size_t i = 0; i < workers; ++i) {
+            workers_.emplace_back([this] {
+               std::function<void()> task;
+               while (!stop_.load() || !tasks_.empty()) {
+                  if (tasks_.wait_and_pop(task, std::chrono::milliseconds(10))) {
+                     task();
+                  }
+               }
+            });
+         }
+      }
+
+      ~lock_queue_pool() {
+         stop_.store(true);
+         for (auto& w : workers_) {
+            w.join();
+         }
+      }
+
+      template <typename F>
+      auto submit(F&& f) -> result<decltype(f())> {
+         using R = decltype(f());
+         result<R> r{std::make_shared<std::atomic<bool>>(false), std::make_shared<R>(), this};
+         std::function<void()> task = [r, f = std::forward<F>(f)]() mutable {
+            *r.value = f();
+            r.ready->store(true, std::memory_order_release);
+         };
+         tasks_.push(task);
+         return r;
+      }
+
+      bool run_one() {
+         std::function<void()> task;
+         if (!tasks_.pop(task)) {
+            return false;
+         }
+         task();
+         return true;
+      }
+
+     private:
+      mpmc::lock_queue<std::function<void()>> tasks_;
+      std::atomic<bool> stop_;
+      std::vector<std::thread> workers_;
+   };
+
+   // many tiny tasks submitted from the outside, the injection queue path.
+   // returns the number of tasks as 'total_sum'
+   template <typename Pool>
+   result_t runTinyTasks(Pool& pool, const size_t howMany) {
+      std::atomic<uint64_t> sum{0};
+      benchmark::stopwatch watch;
+      for (size_t i = 1; i <= howMany; ++i) {
+         pool.submit([&sum, i] {
+            sum.fetch_add(i, std::memory_order_relaxed);
+            return 0;
+         });
+      }
+      const uint64_t expected = static_cast<uint64_t>(howMany) * (howMany + 1) / 2;
+      while (sum.load() != expected) {
+         std::this_thread::yield();
+      }
+      return {howMany, watch.elapsed_ns()};
+   }
+
+   // fork-join: tasks spawn tasks and wait for them, the local deque and stealing path
+   template <typename Pool>
+   uint64_t fibonacci(Pool& pool, const unsigned int n) {
+      if (n < 16) {
+         uint64_t a = 0, b = 1;
+         for (unsigned int i = 0; i < n; ++i) {
+            b = a + b;
+            a = b - a;
+         }
+         return a;
+      }
+      auto left = pool.submit([&pool, n] { return fibonacci(pool, n - 1); });
+      uint64_t right = fibonacci(pool, n - 2);
+      return left.get() + right;
+   }
+
+   // returns the number of spawned tasks as 'total_sum'
+   template <typename Pool>
+   result_t runForkJoin(Pool& pool, const unsigned int n) {
+      benchmark::stopwatch watch;
+      auto root = pool.submit([&pool, n] { return fibonacci(pool, n); });
+      uint64_t value = root.get();
+      Q_CHECK(value > 0);
+      uint64_t tasks = 1;
+      std::vector<uint64_t> spawned(n + 1, 0);  // tasks spawned by fibonacci(i)
+      for (unsigned int i = 16; i <= n; ++i) {
+         spawned[i] = 1 + spawned[i - 1] + spawned[i - 2];
+      }
+      tasks += spawned[n];
+      return {tasks, watch.elapsed_ns()};
+   }
+}  // namespace benchmark
@@ -0,0 +1,67 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "benchmark_functions.hpp"
+#include "q/work_stealing_deque.hpp"
+
+namespace benchmark {
+   // 1 owner pushes 'howMany' items and pops every other one back, 'thieves' threads steal
+   // the rest. Returns the number of items as 'total_sum'
+   inline result_t runOwnerThieves(const size_t howMany, const size_t thieves) {
+      work_stealing::deque<uint64_t> deque(1024);
+      std::atomic<bool> done{false};
+      std::atomic<size_t> ready{0};
+      std::atomic<uint64_t> taken_sum{0};
+
+      std::vector<std::thread> threads;
+      for (size_t i = 0; i < thieves; ++i) {
+         threads.emplace_back([&] {
+            uint64_t sum = 0;
+            uint64_t item = 0;
+            ++ready;
+            while (!done.load(std::memory_order_relaxed) || !deque.empty()) {
+               if (deque.steal(item)) {
+                  sum += item;
+               }
+            }
+            taken_sum += sum;
+         });
+      }
+      while (ready.load() != thieves) {
+         std::this_thread::yield();
+      }
+
+      benchmark::stopwatch watch;
+      uint64_t sum = 0;
+      uint64_t item = 0;
+      for (uint64_t i = 1; i <= howMany; ++i) {
+         deque.push(i);
+         if ((i & 1) == 0 && deque.pop(item)) {
+            sum += item;
+         }
+      }
+      while (deque.pop(item)) {
+         sum += item;
+      }
+      done = true;
+      for (auto& t : threads) {
+         t.join();
+      }
+      auto elapsed = watch.elapsed_ns();
+      Q_CHECK_EQ(static_cast<uint64_t>(howMany) * (howMany + 1) / 2, sum + taken_sum.load());
+      return {howMany, elapsed};
+   }
+}  // namespace benchmark
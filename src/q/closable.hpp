@@ -0,0 +1,98 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Closable queues
+*
+* A sender calls 'close()' when it will not push anything more. The receiver pops what is
+* left and then gets the 'closed' status instead of 'empty', so no end-of-stream sentinel is needed.
+*
+*    sender.push(item);                       // receiver thread
+*    sender.close();                          for (auto& item : receiver) {
+*                                                ...                    // until closed and drained
+*                                             }
+*
+* 'status' converts to true only when an item was pushed/popped. Code that treats the
+* result of 'push'/'pop' as a bool works as before.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+
+namespace queue_api {
+   class status {
+     public:
+      enum class code : uint8_t { success,
+                                  unavailable,  // empty at pop, full at push, or timeout
+                                  closed };     // closed at push, closed and drained at pop
+
+      status(const code value = code::unavailable) :
+          code_(value) {}
+
+      operator bool() const { return code_ == code::success; }
+      bool closed() const { return code_ == code::closed; }
+      code value() const { return code_; }
+
+     private:
+      code code_;
+   };
+
+   // for the push/pop of queues that are not closable
+   inline status to_status(const bool success) { return success ? status::code::success : status::code::unavailable; }
+   inline status to_status(const status result) { return result; }
+   inline bool is_closed(const bool) { return false; }
+   inline bool is_closed(const status result) { return result.closed(); }
+
+   // Input iterator for range-for over a receiver, ends when the queue is closed and drained.
+   // Waits for each item with 'wait_and_pop', so the receiver's thread is blocked in between items
+   template <typename Receiver, typename Element>
+   class receive_iterator {
+     public:
+      using iterator_category = std::input_iterator_tag;
+      using value_type = Element;
+      using difference_type = std::ptrdiff_t;
+      using pointer = Element*;
+      using reference = Element&;
+
+      receive_iterator() :
+          receiver_(nullptr) {}  // end
+      explicit receive_iterator(Receiver* receiver) :
+          receiver_(receiver) { next(); }
+
+      Element& operator*() { return item_; }
+      Element* operator->() { return &item_; }
+      receive_iterator& operator++() {
+         next();
+         return *this;
+      }
+      bool operator==(const receive_iterator& other) const { return receiver_ == other.receiver_; }
+      bool operator!=(const receive_iterator& other) const { return receiver_ != other.receiver_; }
+
+     private:
+      void next() {
+         const std::chrono::milliseconds kWait(1000);
+         for (;;) {
+            auto result = receiver_->wait_and_pop(item_, kWait);
+            if (result) {
+               return;
+            }
+            if (is_closed(result)) {
+               receiver_ = nullptr;
+               return;
+            }
+         }
+      }
+
+      Receiver* receiver_;
+      Element item_{};
+   };
+}  // namespace queue_api
@@ -0,0 +1,243 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* C++20 coroutine awaitables on top of the queue_api Sender and Receiver
+*
+*    auto queue = coro::CreateQueue<spsc::circular_fifo<int>>(sender_executor, receiver_executor, 100);
+*    ...
+*    co_await sender.push(value);     // suspends while the queue is full
+*    co_await receiver.pop(value);    // suspends while the queue is empty
+*
+* Both return true when the item was pushed/popped, false when the queue is closed (see q/closable.hpp)
+*
+* A suspended coroutine does not block any thread. When the peer makes progress the coroutine
+* is posted to the executor where it retries its push/pop and is resumed once that succeeds.
+*
+* The executor is anything with a thread safe 'void post(std::function<void()>)'
+*
+* IMPORTANT:
+* 1. Requires C++20. Build with -DUSE_CXX20=ON. With C++17 this header is empty.
+* 2. The same constraints as for the queue type are in place. For a SPSC queue all receiver
+*    coroutines must run on ONE thread, and the receiver executor must resume them on that thread.
+*    Same for the sender side. With a MPMC queue the same executor can be used for both sides.
+* 3. The receiver coroutines are woken by any push, also pushes through the plain queue_api::Sender.
+*    The sender coroutines are only woken by pops done through coro::Receiver.
+* 4. The queue type must support 'attach', see q/readiness.hpp. Endpoints taken with 'queue()' must not
+*    outlive the coroutine Sender and Receiver.
+*/
+
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <coroutine>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "q/closable.hpp"
+#include "q/q_api.hpp"
+#include "q/readiness.hpp"
+
+namespace coro {
+   struct waiter {
+      virtual ~waiter() = default;
+      virtual bool attempt() = 0;  // the push or pop
+      std::coroutine_handle<> handle_;
+   };
+
+   // Parked coroutines for one queue. Is attached as observer of the queue.
+   template <typename Executor>
+   class state : public readiness::observer, public std::enable_shared_from_this<state<Executor>> {
+     public:
+      state(Executor& sender_executor, Executor& receiver_executor) :
+          sender_executor_(sender_executor),
+          receiver_executor_(receiver_executor),
+          senders_waiting_(0) {}
+      virtual ~state() = default;
+
+      // queue went from empty to non-empty
+      void notify() override { wake(false); }
+
+      // a receiver coroutine popped an item
+      void progress() {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (senders_waiting_.load(std::memory_order_relaxed) > 0) {
+            wake(true);
+         }
+      }
+
+      // returns false if the push/pop succeeded and the coroutine should not be suspended
+      bool park(waiter* w, const bool sender);
+
+     private:
+      void wake(const bool senders);
+      void retry(waiter* w, const bool sender);
+
+      Executor& sender_executor_;
+      Executor& receiver_executor_;
+      // a successful push notifies the receivers, so the two sides cannot share a mutex
+      std::mutex receivers_m_;
+      std::mutex senders_m_;
+      std::vector<waiter*> receivers_;
+      std::vector<waiter*> senders_;
+      std::atomic<int> senders_waiting_;
+   };
+
+   // The attempt is done with the mutex held, so a wakeup for it cannot pass by
+   // in between the failed attempt and the parking
+   template <typename Executor>
+   bool state<Executor>::park(waiter* w, const bool sender) {
+      if (sender) {
+         // pairs with the fence in 'progress()'
+         senders_waiting_.fetch_add(1, std::memory_order_relaxed);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(sender ? senders_m_ : receivers_m_);
+         if (!w->attempt()) {
+            (sender ? senders_ : receivers_).push_back(w);
+            return true;
+         }
+      }
+      if (sender) {
+         senders_waiting_.fetch_sub(1, std::memory_order_relaxed);
+      } else {
+         progress();
+      }
+      return false;
+   }
+
+   template <typename Executor>
+   void state<Executor>::wake(const bool senders) {
+      std::vector<waiter*> woken;
+      {
+         std::lock_guard<std::mutex> lock(senders ? senders_m_ : receivers_m_);
+         woken.swap(senders ? senders_ : receivers_);
+      }
+      if (senders) {
+         senders_waiting_.fetch_sub(static_cast<int>(woken.size()), std::memory_order_relaxed);
+      }
+
+      Executor& executor = senders ? sender_executor_ : receiver_executor_;
+      for (auto w : woken) {
+         auto self = this->shared_from_this();
+         executor.post([self, w, senders] { self->retry(w, senders); });
+      }
+   }
+
+   // on the executor: resume if the push/pop now succeeds, otherwise park again
+   template <typename Executor>
+   void state<Executor>::retry(waiter* w, const bool sender) {
+      if (!park(w, sender)) {
+         w->handle_.resume();
+      }
+   }
+
+   template <typename QType, typename Executor>
+   class Receiver {
+     public:
+      Receiver(queue_api::Receiver<QType> receiver, std::shared_ptr<state<Executor>> s) :
+          receiver_(receiver),
+          state_(s) {}
+
+      template <typename Element>
+      struct pop_awaiter : public waiter {
+         Receiver& receiver_;
+         Element& item_;
+         pop_awaiter(Receiver& receiver, Element& item) :
+             receiver_(receiver),
+             item_(item) {}
+
+         bool popped_ = false;
+         bool attempt() override {
+            auto result = receiver_.receiver_.pop(item_);
+            popped_ = result;
+            return popped_ || queue_api::is_closed(result);
+         }
+         bool await_ready() {
+            if (attempt()) {
+               receiver_.state_->progress();
+               return true;
+            }
+            return false;
+         }
+         bool await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            return receiver_.state_->park(this, false);
+         }
+         bool await_resume() { return popped_; }
+      };
+
+      template <typename Element>
+      pop_awaiter<Element> pop(Element& item) { return pop_awaiter<Element>(*this, item); }
+
+      queue_api::Receiver<QType>& queue() { return receiver_; }
+
+     private:
+      queue_api::Receiver<QType> receiver_;
+      std::shared_ptr<state<Executor>> state_;
+   };
+
+   template <typename QType, typename Executor>
+   class Sender {
+     public:
+      Sender(queue_api::Sender<QType> sender, std::shared_ptr<state<Executor>> s) :
+          sender_(sender),
+          state_(s) {}
+
+      template <typename Element>
+      struct push_awaiter : public waiter {
+         Sender& sender_;
+         Element& item_;
+         push_awaiter(Sender& sender, Element& item) :
+             sender_(sender),
+             item_(item) {}
+
+         bool pushed_ = false;
+         bool attempt() override {
+            auto result = sender_.sender_.push(item_);
+            pushed_ = result;
+            return pushed_ || queue_api::is_closed(result);
+         }
+         bool await_ready() { return attempt(); }
+         bool await_suspend(std::coroutine_handle<> handle) {
+            handle_ = handle;
+            return sender_.state_->park(this, true);
+         }
+         bool await_resume() { return pushed_; }
+      };
+
+      template <typename Element>
+      push_awaiter<Element> push(Element& item) { return push_awaiter<Element>(*this, item); }
+
+      queue_api::Sender<QType>& queue() { return sender_; }
+
+     private:
+      queue_api::Sender<QType> sender_;
+      std::shared_ptr<state<Executor>> state_;
+   };
+
+   // same as queue_api::CreateQueue, but with coroutine Sender and Receiver
+   template <typename QType, typename Executor, typename... Args>
+   auto CreateQueue(Executor& sender_executor, Executor& receiver_executor, Args&&... args) {
+      auto queue = queue_api::CreateQueue<QType>(std::forward<Args>(args)...);
+      auto s = std::make_shared<state<Executor>>(sender_executor, receiver_executor);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      receiver.attach(s.get());
+      return std::make_pair(Sender<QType, Executor>{std::get<queue_api::index::sender>(queue), s},
+                            Receiver<QType, Executor>{receiver, s});
+   }
+}  // namespace coro
+
+#endif  // __cpp_impl_coroutine
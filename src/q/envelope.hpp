@@ -0,0 +1,156 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Type-erased message envelope with inline storage, for many message types in one queue
+*
+*    auto queue = queue_api::CreateQueue<spsc::circular_fifo<message::envelope<>>>(1024);
+*    message::envelope<> item(price{42, 1.5});
+*    sender.push(item);
+*    ...
+*    receiver.pop(item);
+*    item.visit<price, order, cancel>(handler);    // handler(price&), handler(order&), handler(cancel&)
+*
+* A message that fits the buffer and is nothrow movable is stored inline, no allocation.
+* A larger message is stored on the heap. For large messages without heap traffic, put them in a
+* 'pool::pooled_ptr<T>' (q/object_pool.hpp): the pointer fits inline and is dispatched as 'pooled_ptr<T>'.
+*
+* Each message type has one static table of function pointers (move and destroy), the envelope holds a
+* pointer to it. The table pointer is also the type id, 'visit' compares it with the tables of the listed types.
+*
+* IMPORTANT:
+* 1. The envelope is move only. A moved-from envelope is empty.
+* 2. 'visit' and 'get' match the exact type that was put in, not base classes.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace message {
+   template <size_t Capacity = 64>
+   class envelope {
+     public:
+      envelope() noexcept = default;
+
+      template <typename Message, typename = typename std::enable_if<!std::is_same<typename std::decay<Message>::type, envelope>::value>::type>
+      envelope(Message&& msg) {
+         emplace<typename std::decay<Message>::type>(std::forward<Message>(msg));
+      }
+
+      envelope(envelope&& other) noexcept { take(other); }
+      envelope& operator=(envelope&& other) noexcept {
+         if (this != &other) {
+            reset();
+            take(other);
+         }
+         return *this;
+      }
+      ~envelope() { reset(); }
+
+      template <typename T, typename... Args>
+      T& emplace(Args&&... args);
+      void reset() noexcept;
+      bool empty() const { return nullptr == ops_; }
+
+      template <typename T>
+      bool holds() const { return ops_ == &table<T>; }
+
+      // nullptr if the envelope holds another type
+      template <typename T>
+      T* get() { return holds<T>() ? static_cast<T*>(address()) : nullptr; }
+
+      // calls 'visitor(T&)' for the first of 'Types' that the envelope holds. false if none matched
+      template <typename... Types, typename Visitor>
+      bool visit(Visitor&& visitor);
+
+      template <typename T>
+      static constexpr bool stored_inline() {
+         return sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t) &&
+                std::is_nothrow_move_constructible<T>::value;
+      }
+
+     private:
+      envelope(const envelope&) = delete;
+      envelope& operator=(const envelope&) = delete;
+
+      struct ops {
+         void (*move)(void* from, void* to) noexcept;  // moves into empty storage, 'from' is left empty
+         void (*destroy)(void* storage) noexcept;
+         bool inline_;
+      };
+
+      template <typename T>
+      static void move_inline(void* from, void* to) noexcept {
+         T* source = static_cast<T*>(from);
+         ::new (to) T(std::move(*source));
+         source->~T();
+      }
+      template <typename T>
+      static void destroy_inline(void* storage) noexcept { static_cast<T*>(storage)->~T(); }
+
+      // the buffer holds a T*
+      template <typename T>
+      static void move_heap(void* from, void* to) noexcept { ::new (to) T*(*static_cast<T**>(from)); }
+      template <typename T>
+      static void destroy_heap(void* storage) noexcept { delete *static_cast<T**>(storage); }
+
+      template <typename T>
+      static constexpr ops table = stored_inline<T>() ? ops{&move_inline<T>, &destroy_inline<T>, true}
+                                                      : ops{&move_heap<T>, &destroy_heap<T>, false};
+
+      void* address() { return ops_->inline_ ? static_cast<void*>(storage_) : *reinterpret_cast<void**>(storage_); }
+      void take(envelope& other) noexcept {
+         if (other.ops_) {
+            other.ops_->move(other.storage_, storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+         }
+      }
+
+      static_assert(Capacity >= sizeof(void*), "the envelope must have room for a pointer");
+      alignas(std::max_align_t) unsigned char storage_[Capacity];
+      const ops* ops_ = nullptr;
+   };
+
+   template <size_t Capacity>
+   template <typename T, typename... Args>
+   T& envelope<Capacity>::emplace(Args&&... args) {
+      reset();
+      T* msg = nullptr;
+      if constexpr (stored_inline<T>()) {
+         msg = ::new (static_cast<void*>(storage_)) T(std::forward<Args>(args)...);
+      } else {
+         msg = new T(std::forward<Args>(args)...);
+         ::new (static_cast<void*>(storage_)) T*(msg);
+      }
+      ops_ = &table<T>;
+      return *msg;
+   }
+
+   template <size_t Capacity>
+   void envelope<Capacity>::reset() noexcept {
+      if (ops_) {
+         ops_->destroy(storage_);
+         ops_ = nullptr;
+      }
+   }
+
+   template <size_t Capacity>
+   template <typename... Types, typename Visitor>
+   bool envelope<Capacity>::visit(Visitor&& visitor) {
+      bool matched = false;
+      // stops at the first match
+      (void)((holds<Types>() ? (visitor(*static_cast<Types*>(address())), matched = true) : false) || ...);
+      return matched;
+   }
+}  // namespace message
@@ -0,0 +1,139 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Epoch based reclamation, for lock-free structures that unlink memory other threads might still read.
+* Ref: Fraser, "Practical lock-freedom" (2004), chapter 5.2
+*
+*    {
+*       reclamation::epoch_guard guard;      // pins this thread in the current epoch
+*       ... read shared pointers ...
+*    }
+*    auto stamp = reclamation::retire_stamp(); // after the memory is unlinked
+*    ...
+*    if (reclamation::safe_to_free(stamp)) ...
+*
+* There is one global epoch. A pinned thread publishes the epoch it saw, and the epoch only advances
+* when every pinned thread has seen the current one. Memory unlinked in epoch E can not be reached by
+* a thread that pins in E + 1 or later, so it is safe to free once the epoch is E + 2.
+*
+* Each thread gets a record on its first guard. A thread_local ThreadExitNotifier gives the record back
+* when the thread exits, so an exited thread never holds back the epoch and its record is reused.
+*
+* IMPORTANT: a thread that stays pinned stops reclamation for everybody. Keep guards short.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "q/thread_exit_notifier.hpp"
+
+namespace reclamation {
+   class epoch_domain {
+     public:
+      static const uint64_t kNotPinned = 0;
+
+      struct record {
+         std::atomic<uint64_t> epoch{kNotPinned};
+         std::atomic<bool> in_use{false};
+         size_t depth = 0;  // nested guards, owning thread only
+         record* next = nullptr;
+      };
+
+      // never destroyed: threads may exit after main
+      static epoch_domain& instance() {
+         static epoch_domain* domain = new epoch_domain;
+         return *domain;
+      }
+
+      // a free record, or a new one. Records are never deleted, there are at most as many as live threads
+      record* acquire() {
+         for (record* r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            if (!r->in_use.load(std::memory_order_relaxed) && !r->in_use.exchange(true, std::memory_order_acquire)) {
+               return r;
+            }
+         }
+         record* fresh = new record;
+         fresh->in_use.store(true, std::memory_order_relaxed);
+         record* head = records_.load(std::memory_order_relaxed);
+         do {
+            fresh->next = head;
+         } while (!records_.compare_exchange_weak(head, fresh, std::memory_order_release, std::memory_order_relaxed));
+         return fresh;
+      }
+
+      void release(record* r) {
+         r->epoch.store(kNotPinned, std::memory_order_release);
+         r->depth = 0;
+         r->in_use.store(false, std::memory_order_release);
+      }
+
+      uint64_t current() const { return epoch_.load(std::memory_order_acquire); }
+
+      // moves the epoch on if every pinned thread has seen the current one. Returns the epoch
+      uint64_t try_advance() {
+         std::atomic_thread_fence(std::memory_order_seq_cst);  // pairs with the fence in epoch_guard
+         uint64_t epoch = epoch_.load();
+         for (record* r = records_.load(std::memory_order_acquire); r; r = r->next) {
+            const uint64_t seen = r->epoch.load();
+            if (seen != kNotPinned && seen != epoch) {
+               return epoch;
+            }
+         }
+         epoch_.compare_exchange_strong(epoch, epoch + 1);
+         return epoch_.load();
+      }
+
+     private:
+      epoch_domain() = default;
+      std::atomic<uint64_t> epoch_{1};
+      std::atomic<record*> records_{nullptr};
+   };
+
+   inline epoch_domain::record* this_thread_record() {
+      thread_local epoch_domain::record* mine = epoch_domain::instance().acquire();
+      thread_local ThreadExitNotifier release_at_exit([](std::thread::id) { epoch_domain::instance().release(mine); });
+      return mine;
+   }
+
+   class epoch_guard {
+     public:
+      epoch_guard() :
+          record_(this_thread_record()) {
+         if (0 == record_->depth++) {
+            record_->epoch.store(epoch_domain::instance().current(), std::memory_order_relaxed);
+            // the record is published before this thread reads any shared pointer
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+         }
+      }
+      ~epoch_guard() {
+         if (0 == --record_->depth) {
+            record_->epoch.store(epoch_domain::kNotPinned, std::memory_order_release);
+         }
+      }
+
+     private:
+      epoch_guard(const epoch_guard&) = delete;
+      epoch_guard& operator=(const epoch_guard&) = delete;
+      epoch_domain::record* record_;
+   };
+
+   // the epoch to keep with memory that was just unlinked
+   inline uint64_t retire_stamp() {
+      return epoch_domain::instance().current();
+   }
+
+   // true when no thread can still read memory retired at 'stamp'
+   inline bool safe_to_free(const uint64_t stamp) {
+      return epoch_domain::instance().try_advance() >= stamp + 2;
+   }
+}  // namespace reclamation
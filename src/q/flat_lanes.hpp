@@ -0,0 +1,385 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* N SPSC lanes in ONE cache aligned allocation, for the round-robin MPSC and SPMC.
+*
+* With mpsc::fixed_size::round_robin every lane is a queue_api::Receiver: a shared_ptr to a separately
+* allocated circular_fifo that points to its own std::vector. A scan is three dependent pointer
+* chases per lane. Here the index of lane i and slot j of lane i are found by arithmetic on one base
+* pointer, and the control blocks are laid out by who writes them:
+*
+*   [unified side: index + cached other index] x N    packed, 4 lanes per cache line
+*   [closed flags] x N                                packed
+*   [lane side: index + cached other index] x N       one cache line per lane
+*   [slots of lane 0][slots of lane 1]...             each lane starts on a cache line
+*
+* The unified side (the MPSC consumer, the SPMC producer) is one thread and owns all the packed
+* entries, a scan over the lanes reads N/4 lines of its own. The lane side is N threads, their
+* entries get a line each so the threads do not false share. Each side caches the index of the
+* other side and only reads the other side's line when the cache says empty/full.
+*
+*    auto queues = mpsc::flat::CreateLanes<Message>(producers, 1024);
+*    auto& senders = queues.first;           // one per producer thread
+*    auto& receiver = queues.second;         // round-robin over all lanes
+*
+*    auto queues = spmc::flat::CreateLanes<Message>(consumers, 1024);
+*    auto& sender = queues.first;            // round-robin over all lanes
+*    auto& receivers = queues.second;        // one per consumer thread
+*
+* An optional last argument puts the arena on a NUMA node, see q/numa.hpp. 'placement()' reports it.
+*
+* The same round-robin fairness and close semantics as mpsc/spmc::fixed_size::round_robin.
+* Element must be default constructible, as for circular_fifo.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "q/closable.hpp"
+#include "q/numa.hpp"
+
+namespace lanes {
+   // which side is one thread for all lanes
+   enum class unified { consumer,  // MPSC
+                        producer   // SPMC
+   };
+
+   template <typename Element, unified Side>
+   class arena {
+      static const size_t kCacheLine = 64;
+      static_assert(alignof(Element) <= kCacheLine, "lanes are cache line aligned");
+
+     public:
+      arena(size_t lanes, size_t lane_size, int node = numa::kAnyNode);
+      ~arena();
+
+      size_t lanes() const { return kLanes; }
+      size_t lane_size() const { return kSize; }
+      numa::placement placement() const { return placement_; }
+
+      // the producer of 'lane'
+      queue_api::status push(size_t lane, Element& item);
+      void close(size_t lane) { closed_[lane].store(true, std::memory_order_release); }
+
+      // the consumer of 'lane'
+      queue_api::status pop(size_t lane, Element& item);
+
+      // snapshots
+      size_t size(size_t lane) const;
+      bool closed(size_t lane) const { return closed_[lane].load(std::memory_order_acquire); }
+
+     private:
+      arena(const arena&) = delete;
+      arena& operator=(const arena&) = delete;
+
+      struct entry {
+         std::atomic<size_t> index;  // head for a consumer, tail for a producer
+         size_t seen;                // the other side's index when last read, owner only
+      };
+      struct alignas(kCacheLine) padded_entry {
+         entry value;
+      };
+
+      static size_t round_up(size_t bytes) { return (bytes + kCacheLine - 1) / kCacheLine * kCacheLine; }
+      size_t increment(size_t idx) const { return (++idx == kCapacity) ? 0 : idx; }
+      entry& producer(size_t lane) const { return (Side == unified::producer) ? unified_[lane] : lane_side_[lane].value; }
+      entry& consumer(size_t lane) const { return (Side == unified::consumer) ? unified_[lane] : lane_side_[lane].value; }
+      Element& slot(size_t lane, size_t idx) const {
+         return *reinterpret_cast<Element*>(slots_ + lane * kLaneBytes + idx * sizeof(Element));
+      }
+
+      const size_t kLanes;
+      const size_t kSize;
+      const size_t kCapacity;  // one slot is always free, as in circular_fifo
+      const size_t kLaneBytes;
+      size_t bytes_;
+      void* memory_;
+      numa::placement placement_;
+      entry* unified_;
+      std::atomic<bool>* closed_;
+      padded_entry* lane_side_;
+      char* slots_;
+   };
+
+   template <typename Element, unified Side>
+   arena<Element, Side>::arena(size_t lanes, size_t lane_size, int node) :
+       kLanes(lanes),
+       kSize(lane_size),
+       kCapacity(lane_size + 1),
+       kLaneBytes(round_up(kCapacity * sizeof(Element))) {
+      const size_t unified_bytes = round_up(kLanes * sizeof(entry));
+      const size_t closed_bytes = round_up(kLanes * sizeof(std::atomic<bool>));
+      const size_t lane_bytes = kLanes * sizeof(padded_entry);
+      bytes_ = unified_bytes + closed_bytes + lane_bytes + kLanes * kLaneBytes;
+      if (numa::kAnyNode == node) {
+         memory_ = ::operator new(bytes_, std::align_val_t{kCacheLine});
+      } else {
+         memory_ = numa::allocate(bytes_, node, &placement_);  // page aligned
+      }
+
+      char* next = static_cast<char*>(memory_);
+      unified_ = reinterpret_cast<entry*>(next);
+      closed_ = reinterpret_cast<std::atomic<bool>*>(next += unified_bytes);
+      lane_side_ = reinterpret_cast<padded_entry*>(next += closed_bytes);
+      slots_ = (next += lane_bytes);
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+         new (&unified_[lane]) entry{{0}, 0};
+         new (&closed_[lane]) std::atomic<bool>(false);
+         new (&lane_side_[lane]) padded_entry{{{0}, 0}};
+         for (size_t idx = 0; idx < kCapacity; ++idx) {
+            new (&slot(lane, idx)) Element();
+         }
+      }
+   }
+
+   template <typename Element, unified Side>
+   arena<Element, Side>::~arena() {
+      for (size_t lane = 0; lane < kLanes; ++lane) {
+         for (size_t idx = 0; idx < kCapacity; ++idx) {
+            slot(lane, idx).~Element();
+         }
+      }
+      if (numa::kAnyNode == placement_.requested) {
+         ::operator delete(memory_, std::align_val_t{kCacheLine});
+      } else {
+         numa::deallocate(memory_, bytes_);
+      }
+   }
+
+   template <typename Element, unified Side>
+   queue_api::status arena<Element, Side>::push(size_t lane, Element& item) {
+      if (closed_[lane].load(std::memory_order_relaxed)) {
+         return queue_api::status::code::closed;
+      }
+      entry& mine = producer(lane);
+      const size_t tail = mine.index.load(std::memory_order_relaxed);
+      const size_t next = increment(tail);
+      if (next == mine.seen) {
+         mine.seen = consumer(lane).index.load(std::memory_order_acquire);
+         if (next == mine.seen) {
+            return queue_api::status::code::unavailable;  // full lane
+         }
+      }
+      slot(lane, tail) = std::move(item);
+      mine.index.store(next, std::memory_order_release);
+      return queue_api::status::code::success;
+   }
+
+   template <typename Element, unified Side>
+   queue_api::status arena<Element, Side>::pop(size_t lane, Element& item) {
+      entry& mine = consumer(lane);
+      const size_t head = mine.index.load(std::memory_order_relaxed);
+      if (head == mine.seen) {
+         mine.seen = producer(lane).index.load(std::memory_order_acquire);
+         if (head == mine.seen) {
+            if (!closed_[lane].load(std::memory_order_acquire)) {
+               return queue_api::status::code::unavailable;  // empty lane
+            }
+            // the pushes before the close are seen after it
+            mine.seen = producer(lane).index.load(std::memory_order_acquire);
+            if (head == mine.seen) {
+               return queue_api::status::code::closed;
+            }
+         }
+      }
+      item = std::move(slot(lane, head));
+      mine.index.store(increment(head), std::memory_order_release);
+      return queue_api::status::code::success;
+   }
+
+   template <typename Element, unified Side>
+   size_t arena<Element, Side>::size(size_t lane) const {
+      const size_t tail = producer(lane).index.load();
+      const size_t head = consumer(lane).index.load();
+      return (tail + kCapacity - head) % kCapacity;
+   }
+
+   // what the round-robin and the single lane ends share
+   template <typename Element, unified Side>
+   class lanes_api {
+     public:
+      using value_type = Element;
+      using arena_type = arena<Element, Side>;
+
+      lanes_api(std::shared_ptr<arena_type> lanes, size_t first, size_t count) :
+          arena_(std::move(lanes)),
+          first_(first),
+          count_(count) {}
+
+      bool empty() const { return 0 == size(); }
+      bool full() const { return size() == capacity(); }
+      size_t capacity() const { return count_ * arena_->lane_size(); }
+      size_t capacity_free() const { return capacity() - size(); }
+      size_t usage() const { return (100 * size() / capacity()); }
+      size_t size() const {
+         size_t used = 0;
+         for (size_t lane = first_; lane < first_ + count_; ++lane) {
+            used += arena_->size(lane);
+         }
+         return used;
+      }
+      bool lock_free() const { return std::atomic<size_t>{}.is_lock_free(); }
+      numa::placement placement() const { return arena_->placement(); }
+      bool closed() const {  // all lanes are closed
+         bool isclosed = true;
+         for (size_t lane = first_; lane < first_ + count_; ++lane) {
+            isclosed = isclosed && arena_->closed(lane);
+         }
+         return isclosed;
+      }
+
+     protected:
+      // 'attempt(lane)' on lane current_, current_ + 1, ... until it succeeds, at most once per lane
+      template <typename Attempt>
+      queue_api::status round_robin(Attempt attempt) {
+         size_t closed = 0;
+         for (size_t count = 0; count < count_; ++count) {
+            const size_t lane = current_;
+            current_ = (current_ + 1 == count_) ? 0 : current_ + 1;
+            auto result = attempt(lane);
+            if (result) {
+               return result;
+            }
+            closed += result.closed() ? 1 : 0;
+         }
+         return (closed == count_) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+      }
+
+      template <typename Attempt>
+      static queue_api::status wait_for(Attempt attempt, const std::chrono::milliseconds max_wait) {
+         using clock = std::chrono::steady_clock;
+         using namespace std::chrono_literals;
+         auto const timeout = clock::now() + max_wait;
+         for (;;) {
+            auto result = attempt();
+            if (result || result.closed() || clock::now() > timeout) {
+               return result;
+            }
+            std::this_thread::sleep_for(100ns);
+         }
+      }
+
+      std::shared_ptr<arena_type> arena_;
+      size_t first_;
+      size_t count_;
+      size_t current_ = 0;
+   };
+}  // namespace lanes
+
+namespace mpsc {
+   namespace flat {
+      // one producer thread per Sender
+      template <typename Element>
+      class Sender : public lanes::lanes_api<Element, lanes::unified::consumer> {
+         using base = lanes::lanes_api<Element, lanes::unified::consumer>;
+
+        public:
+         Sender(std::shared_ptr<typename base::arena_type> lanes, size_t lane) :
+             base(std::move(lanes), lane, 1) {}
+
+         queue_api::status push(Element& item) { return base::arena_->push(base::first_, item); }
+         void close() { base::arena_->close(base::first_); }
+      };
+
+      // the consumer thread, pops the lanes round-robin. Closed when all lanes are closed and drained
+      template <typename Element>
+      class Receiver : public lanes::lanes_api<Element, lanes::unified::consumer> {
+         using base = lanes::lanes_api<Element, lanes::unified::consumer>;
+
+        public:
+         explicit Receiver(std::shared_ptr<typename base::arena_type> lanes) :
+             base(lanes, 0, lanes->lanes()) {}
+
+         queue_api::status pop(Element& item) {
+            return base::round_robin([&](size_t lane) { return base::arena_->pop(lane, item); });
+         }
+         queue_api::status wait_and_pop(Element& item, const std::chrono::milliseconds max_wait) {
+            return base::wait_for([&] { return pop(item); }, max_wait);
+         }
+
+         // range-for until all lanes are closed and drained. See q/closable.hpp
+         queue_api::receive_iterator<Receiver, Element> begin() { return queue_api::receive_iterator<Receiver, Element>(this); }
+         queue_api::receive_iterator<Receiver, Element> end() { return queue_api::receive_iterator<Receiver, Element>(); }
+      };
+
+      // 'producers' lanes of 'lane_size' in one allocation, on NUMA 'node' if given
+      template <typename Element>
+      std::pair<std::vector<Sender<Element>>, Receiver<Element>> CreateLanes(const size_t producers, const size_t lane_size,
+                                                                             const int node = numa::kAnyNode) {
+         auto shared = std::make_shared<lanes::arena<Element, lanes::unified::consumer>>(producers, lane_size, node);
+         std::vector<Sender<Element>> senders;
+         for (size_t lane = 0; lane < producers; ++lane) {
+            senders.emplace_back(shared, lane);
+         }
+         return std::make_pair(std::move(senders), Receiver<Element>(shared));
+      }
+   }  // namespace flat
+}  // namespace mpsc
+
+namespace spmc {
+   namespace flat {
+      // the producer thread, pushes to the lanes round-robin. 'close' closes all lanes
+      template <typename Element>
+      class Sender : public lanes::lanes_api<Element, lanes::unified::producer> {
+         using base = lanes::lanes_api<Element, lanes::unified::producer>;
+
+        public:
+         explicit Sender(std::shared_ptr<typename base::arena_type> lanes) :
+             base(lanes, 0, lanes->lanes()) {}
+
+         queue_api::status push(Element& item) {
+            return base::round_robin([&](size_t lane) { return base::arena_->push(lane, item); });
+         }
+         void close() {
+            for (size_t lane = 0; lane < base::count_; ++lane) {
+               base::arena_->close(lane);
+            }
+         }
+      };
+
+      // one consumer thread per Receiver
+      template <typename Element>
+      class Receiver : public lanes::lanes_api<Element, lanes::unified::producer> {
+         using base = lanes::lanes_api<Element, lanes::unified::producer>;
+
+        public:
+         Receiver(std::shared_ptr<typename base::arena_type> lanes, size_t lane) :
+             base(std::move(lanes), lane, 1) {}
+
+         queue_api::status pop(Element& item) { return base::arena_->pop(base::first_, item); }
+         queue_api::status wait_and_pop(Element& item, const std::chrono::milliseconds max_wait) {
+            return base::wait_for([&] { return pop(item); }, max_wait);
+         }
+
+         // range-for until the lane is closed and drained. See q/closable.hpp
+         queue_api::receive_iterator<Receiver, Element> begin() { return queue_api::receive_iterator<Receiver, Element>(this); }
+         queue_api::receive_iterator<Receiver, Element> end() { return queue_api::receive_iterator<Receiver, Element>(); }
+      };
+
+      // 'consumers' lanes of 'lane_size' in one allocation, on NUMA 'node' if given
+      template <typename Element>
+      std::pair<Sender<Element>, std::vector<Receiver<Element>>> CreateLanes(const size_t consumers, const size_t lane_size,
+                                                                             const int node = numa::kAnyNode) {
+         auto shared = std::make_shared<lanes::arena<Element, lanes::unified::producer>>(consumers, lane_size, node);
+         std::vector<Receiver<Element>> receivers;
+         for (size_t lane = 0; lane < consumers; ++lane) {
+            receivers.emplace_back(shared, lane);
+         }
+         return std::make_pair(Sender<Element>(shared), std::move(receivers));
+      }
+   }  // namespace flat
+}  // namespace spmc
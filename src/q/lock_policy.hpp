@@ -0,0 +1,149 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Locks for short critical sections, to use as the 'Lock' parameter of mpmc::lock_queue
+*
+*    mpmc::lock_queue<T, std::allocator<T>, lock_policy::adaptive_mutex> queue(1024);
+*
+* 'adaptive_mutex': spins a bounded number of times with a pause instruction, then sleeps on a futex
+*                   (Linux) or yields (elsewhere). A holder that is done within the spin never pays
+*                   a context switch. Ref: Drepper, "Futexes Are Tricky" (2011), mutex #3
+* 'ticket_mutex':   FIFO. Each 'lock' takes a ticket and waits for its number to be served, so no
+*                   thread is passed over. Waiters spin, then yield: there is nothing to sleep on.
+*
+* Both are Lockable (lock, try_lock, unlock). With them lock_queue waits on std::condition_variable_any.
+*
+* IMPORTANT:
+* 1. Spinning only pays off with more than one core. On a single core both skip the spin,
+*    the holder cannot make progress while we spin.
+* 2. 'ticket_mutex' hands the lock to the next ticket even when that thread is not running. With more
+*    threads than cores every hand-off waits for a reschedule: use it for fairness on spare cores only.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace lock_policy {
+   // tells the core we are in a spin loop: the sibling hyper-thread gets the pipeline and the loop
+   // exit does not flush it
+   inline void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+      asm volatile("yield" ::: "memory");
+#endif
+   }
+
+   inline bool spinning_pays_off() {
+      static const bool many_cores = std::thread::hardware_concurrency() > 1;
+      return many_cores;
+   }
+
+   class adaptive_mutex {
+     public:
+      static const size_t kSpins = 100;
+
+      adaptive_mutex() = default;
+      adaptive_mutex(const adaptive_mutex&) = delete;
+      adaptive_mutex& operator=(const adaptive_mutex&) = delete;
+
+      void lock() {
+         if (try_lock()) {
+            return;
+         }
+         if (spinning_pays_off()) {
+            for (size_t spin = 0; spin < kSpins; ++spin) {
+               cpu_relax();
+               if (state_.load(std::memory_order_relaxed) == kUnlocked && try_lock()) {
+                  return;
+               }
+            }
+         }
+         // mark the lock as contended, whoever unlocks must then wake a sleeper
+         while (state_.exchange(kContended, std::memory_order_acquire) != kUnlocked) {
+            sleep_while_contended();
+         }
+      }
+
+      bool try_lock() {
+         int expected = kUnlocked;
+         return state_.compare_exchange_strong(expected, kLocked, std::memory_order_acquire, std::memory_order_relaxed);
+      }
+
+      void unlock() {
+         if (state_.exchange(kUnlocked, std::memory_order_release) == kContended) {
+            wake_one();
+         }
+      }
+
+     private:
+      enum : int { kUnlocked = 0,
+                   kLocked = 1,
+                   kContended = 2 };  // locked, and somebody might sleep on it
+
+#if defined(__linux__)
+      static_assert(sizeof(std::atomic<int>) == sizeof(int), "the futex word is the atomic itself");
+      int* word() { return reinterpret_cast<int*>(&state_); }
+      // returns at once if the lock was released in between, the kernel compares the word first
+      void sleep_while_contended() { syscall(SYS_futex, word(), FUTEX_WAIT_PRIVATE, kContended, nullptr, nullptr, 0); }
+      void wake_one() { syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0); }
+#else
+      void sleep_while_contended() { std::this_thread::yield(); }
+      void wake_one() {}
+#endif
+
+      std::atomic<int> state_{kUnlocked};
+   };
+
+   class ticket_mutex {
+     public:
+      static const size_t kSpins = 100;
+
+      ticket_mutex() = default;
+      ticket_mutex(const ticket_mutex&) = delete;
+      ticket_mutex& operator=(const ticket_mutex&) = delete;
+
+      void lock() {
+         const uint32_t ticket = next_.fetch_add(1, std::memory_order_relaxed);
+         const size_t spins = spinning_pays_off() ? kSpins : 0;
+         for (size_t spin = 0; serving_.load(std::memory_order_acquire) != ticket; ++spin) {
+            if (spin < spins) {
+               cpu_relax();
+            } else {
+               std::this_thread::yield();
+            }
+         }
+      }
+
+      // only when nobody holds or waits for the lock
+      bool try_lock() {
+         uint32_t serving = serving_.load(std::memory_order_relaxed);
+         return next_.compare_exchange_strong(serving, serving + 1, std::memory_order_acquire, std::memory_order_relaxed);
+      }
+
+      void unlock() { serving_.store(serving_.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+     private:
+      std::atomic<uint32_t> next_{0};
+      std::atomic<uint32_t> serving_{0};
+   };
+}  // namespace lock_policy
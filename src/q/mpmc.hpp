@@ -17,4 +17,7 @@
 
 #pragma once
 
+#include "q/mpmc_flat_combining_queue.hpp"
 #include "q/mpmc_lock_queue.hpp"
+#include "q/mpmc_segmented_queue.hpp"
+#include "q/mpmc_two_lock_queue.hpp"
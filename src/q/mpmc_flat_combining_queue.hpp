@@ -0,0 +1,425 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Multiple producer, multiple consumer queue with flat combining. Same API as mpmc::lock_queue.
+* Ref: Hendler, Incze, Shavit, Tzafrir: "Flat Combining and the Synchronization-Parallelism Tradeoff" (2010)
+*
+* A thread does not lock the queue, it posts its push or pop in a publication slot and sets the slot's
+* bit in a pending mask. Whoever gets the combiner flag takes the mask and applies all posted requests,
+* its own included, to a plain sequential ring. The others spin on their own slot until it is done,
+* or become the combiner when the flag is free. Under contention one thread applies many requests in a
+* row, so the ring stays in one core's cache and there is no mutex hand-off per item.
+*
+* A thread uses the slot its thread id hashes to, or the next free one. The slot is claimed for the
+* duration of one call only, so no per-thread registration is needed and a slot is never left behind
+* by a thread that exits.
+*
+* IMPORTANT:
+* 1. Waiting for the combiner spins, then yields. Meant for short critical sections and busy queues.
+* 2. 'wait_and_pop'/'wait_and_push' park on a condition variable when the queue is empty/full.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace mpmc {
+   namespace detail {
+      // index of the lowest set bit, 'mask' is not 0
+      inline size_t lowest_bit(const uint64_t mask) {
+#if defined(_MSC_VER) && defined(_M_X64)
+         unsigned long index = 0;
+         _BitScanForward64(&index, mask);
+         return index;
+#elif defined(__GNUC__) || defined(__clang__)
+         return static_cast<size_t>(__builtin_ctzll(mask));
+#else
+         size_t index = 0;
+         while (0 == (mask & (uint64_t{1} << index))) {
+            ++index;
+         }
+         return index;
+#endif
+      }
+   }  // namespace detail
+
+   template <typename T>
+   class flat_combining_queue {
+      static const int kUnlimited = -1;
+      static const int kSmallDefault = 100;
+      static const size_t kSlots = 64;              // one bit each in 'pending_'
+      static const size_t kCombinePasses = 8;       // mask swaps per combining round
+      static const size_t kSpinsBeforeYield = 128;  // the combiner might share our core
+      using clock = std::chrono::steady_clock;
+
+      enum request : uint8_t { none,
+                               push_request,
+                               pop_request,
+                               done };
+
+      struct alignas(64) slot {
+         std::atomic<bool> claimed{false};
+         std::atomic<uint8_t> request{none};
+         T* item = nullptr;
+         queue_api::status result;
+      };
+
+      // what a combining round did, the waiters are notified after the combiner flag is released
+      struct events {
+         size_t pushed = 0;
+         size_t popped = 0;
+         bool was_empty = false;
+      };
+
+     public:
+      using value_type = T;
+
+      // -1 : unbounded
+      // 0 ... N : bounded (0 is silly). The ring is allocated here
+      flat_combining_queue(const int maxSize = kSmallDefault);
+      virtual ~flat_combining_queue() = default;
+
+      bool lock_free() const { return false; }
+      queue_api::status push(T& item) { return post(push_request, item); }
+      queue_api::status wait_and_push(T& item, std::chrono::milliseconds max_wait);  // waits while full
+      queue_api::status pop(T& popped_item) { return post(pop_request, popped_item); }
+      queue_api::status wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+
+      // moves all items to the back of 'out' in one combining round. Returns how many, 0 when empty
+      template <typename Container>
+      size_t pop_all(Container& out);
+
+      bool full() const;
+      bool empty() const { return 0 == size_.load(std::memory_order_relaxed); }
+      size_t size() const { return size_.load(std::memory_order_relaxed); }
+      size_t capacity() const;
+      size_t capacity_free() const { return capacity() - size(); }
+      size_t usage() const { return (100 * size() / capacity()); }
+
+      // see q/readiness.hpp, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // any producer: no more pushes, waiting consumers and producers are woken. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+     private:
+      flat_combining_queue(const flat_combining_queue&) = delete;
+      flat_combining_queue& operator=(const flat_combining_queue&) = delete;
+
+      queue_api::status post(const request kind, T& item);
+      size_t claim();
+      bool try_combine() { return !combining_.load(std::memory_order_relaxed) && !combining_.exchange(true, std::memory_order_acquire); }
+      void combine(events& happened);
+      void end_combine(const events& happened);
+      void lock_combiner(events& happened);
+
+      // the sequential queue, only touched by the combiner
+      bool internal_full() const;
+      size_t internal_size() const { return kMaxSize == kUnlimited ? unbounded_.size() : count_; }
+      queue_api::status internal_push(T& item, events& happened);
+      queue_api::status internal_pop(T& popped_item, events& happened);
+
+      const int kMaxSize;
+      slot slots_[kSlots];
+
+      alignas(64) std::atomic<uint64_t> pending_;
+      alignas(64) std::atomic<bool> combining_;
+      std::deque<T> unbounded_;
+      std::vector<T> ring_;
+      size_t front_;
+      size_t count_;
+
+      alignas(64) std::atomic<size_t> size_;  // written by the combiner
+      std::atomic<bool> closed_;               // written by the combiner
+      std::atomic<readiness::observer*> observer_;
+
+      // parking
+      std::mutex park_m_;
+      std::condition_variable data_cond_;
+      std::condition_variable not_full_cond_;
+      std::atomic<size_t> waiting_consumers_;
+      std::atomic<size_t> waiting_producers_;
+   };
+
+   template <typename T>
+   flat_combining_queue<T>::flat_combining_queue(const int maxSize) :
+       kMaxSize(maxSize),
+       pending_(0),
+       combining_(false),
+       ring_(maxSize == kUnlimited ? 0 : static_cast<size_t>(maxSize)),
+       front_(0),
+       count_(0),
+       size_(0),
+       closed_(false),
+       observer_(nullptr),
+       waiting_consumers_(0),
+       waiting_producers_(0) {}
+
+   template <typename T>
+   queue_api::status flat_combining_queue<T>::wait_and_push(T& item, std::chrono::milliseconds max_wait) {
+      auto const timeout = clock::now() + max_wait;
+      for (;;) {
+         auto result = push(item);
+         if (result || result.closed()) {
+            return result;
+         }
+         std::unique_lock<std::mutex> lock(park_m_);
+         waiting_producers_.fetch_add(1);  // seq_cst, pairs with the combiner's size store
+         bool in_time = true;
+         if (full() && !closed()) {
+            in_time = (not_full_cond_.wait_until(lock, timeout) == std::cv_status::no_timeout);
+         }
+         waiting_producers_.fetch_sub(1);
+         if (!in_time) {
+            lock.unlock();
+            return push(item);
+         }
+      }
+   }
+
+   template <typename T>
+   queue_api::status flat_combining_queue<T>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
+      auto const timeout = clock::now() + max_wait;
+      for (;;) {
+         auto result = pop(popped_item);
+         if (result || result.closed()) {
+            return result;
+         }
+         std::unique_lock<std::mutex> lock(park_m_);
+         waiting_consumers_.fetch_add(1);  // seq_cst, pairs with the combiner's size store
+         bool in_time = true;
+         if (0 == size_.load() && !closed()) {
+            in_time = (data_cond_.wait_until(lock, timeout) == std::cv_status::no_timeout);
+         }
+         waiting_consumers_.fetch_sub(1);
+         if (!in_time) {
+            lock.unlock();
+            return pop(popped_item);
+         }
+      }
+   }
+
+   template <typename T>
+   template <typename Container>
+   size_t flat_combining_queue<T>::pop_all(Container& out) {
+      events happened;
+      lock_combiner(happened);
+      size_t count = 0;
+      while (internal_size() > 0) {
+         out.emplace_back();
+         internal_pop(out.back(), happened);
+         ++count;
+      }
+      end_combine(happened);
+      return count;
+   }
+
+   template <typename T>
+   void flat_combining_queue<T>::close() {
+      events happened;
+      lock_combiner(happened);
+      closed_.store(true);
+      end_combine(happened);
+      {
+         std::lock_guard<std::mutex> lock(park_m_);
+      }
+      data_cond_.notify_all();
+      not_full_cond_.notify_all();
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         observer->notify();
+      }
+   }
+
+   template <typename T>
+   bool flat_combining_queue<T>::full() const {
+      if (kMaxSize == kUnlimited) {
+         return false;
+      }
+      return size_.load() >= static_cast<size_t>(kMaxSize);
+   }
+
+   template <typename T>
+   size_t flat_combining_queue<T>::capacity() const {
+      if (kMaxSize == kUnlimited) {
+         return std::numeric_limits<unsigned int>::max();
+      }
+      return kMaxSize;
+   }
+
+   // private
+   template <typename T>
+   queue_api::status flat_combining_queue<T>::post(const request kind, T& item) {
+      const size_t index = claim();
+      slot& mine = slots_[index];
+      mine.item = &item;
+      mine.request.store(kind, std::memory_order_relaxed);
+      pending_.fetch_or(uint64_t{1} << index, std::memory_order_release);
+
+      size_t spins = 0;
+      while (mine.request.load(std::memory_order_acquire) != done) {
+         if (try_combine()) {
+            events happened;
+            combine(happened);
+            end_combine(happened);
+            continue;
+         }
+         if (++spins > kSpinsBeforeYield) {
+            std::this_thread::yield();
+         }
+      }
+      const queue_api::status result = mine.result;
+      mine.request.store(none, std::memory_order_relaxed);
+      mine.claimed.store(false, std::memory_order_release);
+      return result;
+   }
+
+   template <typename T>
+   size_t flat_combining_queue<T>::claim() {
+      size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % kSlots;
+      for (;;) {
+         if (!slots_[index].claimed.load(std::memory_order_relaxed) &&
+             !slots_[index].claimed.exchange(true, std::memory_order_acquire)) {
+            return index;
+         }
+         index = (index + 1) % kSlots;
+         if (0 == index) {
+            std::this_thread::yield();  // more threads than slots
+         }
+      }
+   }
+
+   // with the combiner flag held
+   template <typename T>
+   void flat_combining_queue<T>::combine(events& happened) {
+      for (size_t pass = 0; pass < kCombinePasses; ++pass) {
+         uint64_t mask = pending_.exchange(0, std::memory_order_acquire);
+         if (0 == mask) {
+            break;
+         }
+         while (mask) {
+            const size_t index = detail::lowest_bit(mask);
+            mask &= mask - 1;
+            slot& posted = slots_[index];
+            if (posted.request.load(std::memory_order_relaxed) == push_request) {
+               posted.result = internal_push(*posted.item, happened);
+            } else {
+               posted.result = internal_pop(*posted.item, happened);
+            }
+            posted.request.store(done, std::memory_order_release);
+         }
+      }
+   }
+
+   // releases the combiner flag, then wakes whoever can make progress now
+   template <typename T>
+   void flat_combining_queue<T>::end_combine(const events& happened) {
+      size_.store(internal_size());  // seq_cst, pairs with the parking threads
+      combining_.store(false, std::memory_order_release);
+
+      const bool wake_consumers = happened.pushed > 0 && waiting_consumers_.load() > 0;
+      const bool wake_producers = happened.popped > 0 && waiting_producers_.load() > 0;
+      if (wake_consumers || wake_producers) {
+         {
+            std::lock_guard<std::mutex> lock(park_m_);  // a thread between its check and its wait
+         }
+         if (wake_consumers) {
+            happened.pushed == 1 ? data_cond_.notify_one() : data_cond_.notify_all();
+         }
+         if (wake_producers) {
+            happened.popped == 1 ? not_full_cond_.notify_one() : not_full_cond_.notify_all();
+         }
+      }
+      if (happened.was_empty) {
+         auto observer = observer_.load(std::memory_order_acquire);
+         if (observer) {
+            observer->notify();
+         }
+      }
+   }
+
+   // for the calls that work on the whole queue, posted requests are served on the way
+   template <typename T>
+   void flat_combining_queue<T>::lock_combiner(events& happened) {
+      size_t spins = 0;
+      while (!try_combine()) {
+         if (++spins > kSpinsBeforeYield) {
+            std::this_thread::yield();
+         }
+      }
+      combine(happened);
+   }
+
+   template <typename T>
+   bool flat_combining_queue<T>::internal_full() const {
+      if (kMaxSize == kUnlimited) {
+         return false;
+      }
+      return count_ >= ring_.size();
+   }
+
+   template <typename T>
+   queue_api::status flat_combining_queue<T>::internal_push(T& item, events& happened) {
+      if (closed_.load(std::memory_order_relaxed)) {
+         return queue_api::status::code::closed;
+      }
+      if (internal_full()) {
+         return queue_api::status::code::unavailable;
+      }
+      happened.was_empty = happened.was_empty || 0 == internal_size();
+      ++happened.pushed;
+      if (kMaxSize == kUnlimited) {
+         unbounded_.push_back(std::move(item));
+         return queue_api::status::code::success;
+      }
+      size_t back = front_ + count_;
+      if (back >= ring_.size()) {
+         back -= ring_.size();
+      }
+      ring_[back] = std::move(item);
+      ++count_;
+      return queue_api::status::code::success;
+   }
+
+   template <typename T>
+   queue_api::status flat_combining_queue<T>::internal_pop(T& popped_item, events& happened) {
+      if (0 == internal_size()) {
+         return closed_.load(std::memory_order_relaxed) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+      }
+      ++happened.popped;
+      if (kMaxSize == kUnlimited) {
+         popped_item = std::move(unbounded_.front());
+         unbounded_.pop_front();
+         return queue_api::status::code::success;
+      }
+      popped_item = std::move(ring_[front_]);
+      if (++front_ == ring_.size()) {
+         front_ = 0;
+      }
+      --count_;
+      return queue_api::status::code::success;
+   }
+}  // namespace mpmc
@@ -25,151 +25,419 @@
 
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <exception>
+#include <limits>
+#include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
 
 /** Multiple producer, multiple consumer (mpmc) thread safe queue
-* protected by mutex. Since 'return by reference' is used this queue won't throw */
+* protected by mutex. Push and pop return a status and the item by reference, they only throw what
+* T's move or the allocator throws. The constructor throws std::invalid_argument for a maxSize below -1 */
 namespace mpmc {
-   template <typename T>
+   // Allocator: where the queue storage lives, see 'mpmc::pmr::lock_queue' below for a memory_resource
+   // Lock: guards the queue, see q/lock_policy.hpp for a spinning and a fair lock
+   template <typename T, typename Allocator = std::allocator<T>, typename Lock = std::mutex>
    class lock_queue {
+      // std::condition_variable only works with std::mutex
+      using condition = typename std::conditional<std::is_same<Lock, std::mutex>::value,
+                                                  std::condition_variable, std::condition_variable_any>::type;
       static const int kUnlimited = -1;
       static const int kSmallDefault = 100;
+      using slot_traits = std::allocator_traits<Allocator>;
       const int kMaxSize;
-      std::queue<T> queue_;
-      mutable std::mutex m_;
-      std::condition_variable data_cond_;
+      const size_t kSlots;                             // ring_ length, 0 when unbounded
+      Allocator allocator_;
+      std::optional<std::deque<T, Allocator>> queue_;  // unbounded only
+      T* ring_;                                        // bounded: kSlots raw slots, allocated up front
+      size_t front_;                                   // ring_ index of the oldest item
+      size_t count_;                                   // items in ring_, constructed in their slots
+      mutable Lock m_;
+      condition data_cond_;
+      condition not_full_cond_;
+      size_t waiting_consumers_;  // parked in 'wait_and_pop', push only notifies when there are any
+      size_t waiting_producers_;  // parked in 'wait_and_push' on a full queue, a pop wakes one of them
+      std::atomic<readiness::observer*> observer_;
+      bool closed_;
 
       lock_queue& operator=(const lock_queue&) = delete;
       lock_queue(const lock_queue& other) = delete;
 
       bool internal_full() const;
       size_t internal_capacity() const;
+      bool internal_empty() const { return 0 == internal_size(); }
+      size_t internal_size() const;
+      void internal_push(T& item);
+      void internal_pop(T& popped_item);
+      T& internal_front();
+      void internal_drop_front();
+      void notify_pushed(const bool was_empty, const bool wake_consumer);
+      static size_t ring_slots(const int maxSize);
 
      public:
+      using value_type = T;
+      using allocator_type = Allocator;
+      using lock_type = Lock;
+
       // -1 : unbounded
-      // 0 ... N : bounded (0 is silly)
-      lock_queue(const int maxSize = kSmallDefault);
+      // 0 ... N : bounded (0 is silly). The slots are allocated here, raw: push move constructs
+      //           an item in its slot and pop destroys it, T needs no default constructor
+      // below -1 : std::invalid_argument
+      lock_queue(const int maxSize = kSmallDefault, const Allocator& allocator = Allocator());
+      ~lock_queue();
 
       bool lock_free() const;
-      bool push(T& item);
-      bool pop(T& popped_item);
-      bool wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+      queue_api::status push(T& item);
+      queue_api::status wait_and_push(T& item, std::chrono::milliseconds max_wait);  // waits while full
+      queue_api::status pop(T& popped_item);
+      queue_api::status wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+
+      // moves all items to the back of 'out' with one lock. Returns how many, 0 when empty
+      template <typename Container>
+      size_t pop_all(Container& out);
       bool full();
       bool empty() const;
       size_t size() const;
       size_t capacity() const;
       size_t capacity_free() const;
       size_t usage() const;
+
+      // see q/readiness.hpp, nullptr detaches
+      void attach(readiness::observer* observer);
+
+      // any producer: no more pushes, waiting consumers and producers are woken. See q/closable.hpp
+      void close();
+      bool closed() const;
    };
 
    // maxSize of -1 equals unlimited size
-   template <typename T>
-   lock_queue<T>::lock_queue(int maxSize) :
-       kMaxSize(maxSize) {}
+   template <typename T, typename Allocator, typename Lock>
+   lock_queue<T, Allocator, Lock>::lock_queue(int maxSize, const Allocator& allocator) :
+       kMaxSize(maxSize),
+       kSlots(ring_slots(maxSize)),
+       allocator_(allocator),
+       ring_(nullptr),
+       front_(0),
+       count_(0),
+       waiting_consumers_(0),
+       waiting_producers_(0),
+       observer_(nullptr),
+       closed_(false) {
+      if (kMaxSize == kUnlimited) {
+         queue_.emplace(allocator_);
+      } else if (kSlots > 0) {
+         ring_ = slot_traits::allocate(allocator_, kSlots);
+      }
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   lock_queue<T, Allocator, Lock>::~lock_queue() {
+      if (nullptr == ring_) {
+         return;
+      }
+      while (count_ > 0) {
+         internal_drop_front();
+      }
+      slot_traits::deallocate(allocator_, ring_, kSlots);
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::ring_slots(const int maxSize) {
+      if (maxSize < kUnlimited) {
+         throw std::invalid_argument("mpmc::lock_queue: maxSize " + std::to_string(maxSize) + " is below -1 (unbounded)");
+      }
+      return (maxSize == kUnlimited) ? 0 : static_cast<size_t>(maxSize);
+   }
 
-   template <typename T>
-   bool lock_queue<T>::lock_free() const {
+   template <typename T, typename Allocator, typename Lock>
+   bool lock_queue<T, Allocator, Lock>::lock_free() const {
       return false;
    }
 
-   template <typename T>
-   bool lock_queue<T>::push(T& item) {
+   template <typename T, typename Allocator, typename Lock>
+   queue_api::status lock_queue<T, Allocator, Lock>::push(T& item) {
+      bool was_empty = false;
+      bool wake = false;
       {
-         std::lock_guard<std::mutex> lock(m_);
+         std::lock_guard<Lock> lock(m_);
+         if (closed_) {
+            return queue_api::status::code::closed;
+         }
          if (internal_full()) {
-            return false;
+            return queue_api::status::code::unavailable;
          }
-         queue_.push(std::move(item));
+         was_empty = internal_empty();
+         internal_push(item);
+         wake = waiting_consumers_ > 0;
       }  // lock_guard off
-      data_cond_.notify_one();
-      return true;
+      notify_pushed(was_empty, wake);
+      return queue_api::status::code::success;
    }
 
-   template <typename T>
-   bool lock_queue<T>::pop(T& popped_item) {
-      std::lock_guard<std::mutex> lock(m_);
-      if (queue_.empty()) {
-         return false;
+   // an unbounded queue is never full, this is then the same as 'push'
+   template <typename T, typename Allocator, typename Lock>
+   queue_api::status lock_queue<T, Allocator, Lock>::wait_and_push(T& item, std::chrono::milliseconds max_wait) {
+      bool was_empty = false;
+      bool wake = false;
+      {
+         std::unique_lock<Lock> lock(m_);
+         auto const timeout = std::chrono::steady_clock::now() + max_wait;
+         while (internal_full() && !closed_) {
+            ++waiting_producers_;
+            const auto waited = not_full_cond_.wait_until(lock, timeout);
+            --waiting_producers_;
+            if (waited == std::cv_status::timeout) {
+               break;
+            }
+         }
+         if (closed_) {
+            return queue_api::status::code::closed;
+         }
+         if (internal_full()) {
+            return queue_api::status::code::unavailable;
+         }
+         was_empty = internal_empty();
+         internal_push(item);
+         wake = waiting_consumers_ > 0;
+      }  // lock off
+      notify_pushed(was_empty, wake);
+      return queue_api::status::code::success;
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   queue_api::status lock_queue<T, Allocator, Lock>::pop(T& popped_item) {
+      bool wake = false;
+      {
+         std::lock_guard<Lock> lock(m_);
+         if (internal_empty()) {
+            return closed_ ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+         internal_pop(popped_item);
+         wake = waiting_producers_ > 0;  // a slot is free, see 'wait_and_push'
+      }  // lock_guard off
+      if (wake) {
+         not_full_cond_.notify_one();
       }
-      popped_item = std::move(queue_.front());
-      queue_.pop();
-      return true;
+      return queue_api::status::code::success;
    }
 
-   template <typename T>
-   bool lock_queue<T>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
-      std::unique_lock<std::mutex> lock(m_);
-      auto const timeout = std::chrono::steady_clock::now() + max_wait;
-      while (queue_.empty()) {
-         if (data_cond_.wait_until(lock, timeout) == std::cv_status::timeout) {
-            break;
+   template <typename T, typename Allocator, typename Lock>
+   queue_api::status lock_queue<T, Allocator, Lock>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
+      bool wake = false;
+      {
+         std::unique_lock<Lock> lock(m_);
+         auto const timeout = std::chrono::steady_clock::now() + max_wait;
+         while (internal_empty() && !closed_) {
+            ++waiting_consumers_;
+            const auto waited = data_cond_.wait_until(lock, timeout);
+            --waiting_consumers_;
+            if (waited == std::cv_status::timeout) {
+               break;
+            }
+            //  This 'while' loop is equal to
+            //  data_cond_.wait(lock, [](bool result){return !queue_.empty() || closed_;});
          }
-         //  This 'while' loop is equal to
-         //  data_cond_.wait(lock, [](bool result){return !queue_.empty();});
+         if (internal_empty()) {
+            return closed_ ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+         internal_pop(popped_item);
+         wake = waiting_producers_ > 0;
+      }  // lock off
+      if (wake) {
+         not_full_cond_.notify_one();
       }
-      if (queue_.empty()) {
-         return false;
+      return queue_api::status::code::success;
+   }
+
+   // an unbounded queue swaps its whole deque into an empty 'out' of the same type. Otherwise the
+   // items are moved one by one, still under the lock: reserve room in 'out' to avoid allocating there
+   template <typename T, typename Allocator, typename Lock>
+   template <typename Container>
+   size_t lock_queue<T, Allocator, Lock>::pop_all(Container& out) {
+      size_t count = 0;
+      bool wake = false;
+      {
+         std::lock_guard<Lock> lock(m_);
+         count = internal_size();
+         if constexpr (std::is_same<Container, std::deque<T, Allocator>>::value) {
+            if (kMaxSize == kUnlimited && out.empty() && out.get_allocator() == queue_->get_allocator()) {
+               out.swap(*queue_);
+               return count;  // unbounded, no producer waits for room
+            }
+         }
+         for (size_t i = 0; i < count; ++i) {
+            out.push_back(std::move(internal_front()));
+            internal_drop_front();
+         }
+         wake = waiting_producers_ > 0 && count > 0;
+      }  // lock_guard off
+      if (wake) {
+         not_full_cond_.notify_all();
       }
+      return count;
+   }
 
-      popped_item = std::move(queue_.front());
-      queue_.pop();
-      return true;
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::close() {
+      {
+         std::lock_guard<Lock> lock(m_);
+         closed_ = true;
+      }
+      data_cond_.notify_all();
+      not_full_cond_.notify_all();
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         observer->notify();
+      }
    }
 
-   template <typename T>
-   bool lock_queue<T>::full() {
-      std::lock_guard<std::mutex> lock(m_);
+   template <typename T, typename Allocator, typename Lock>
+   bool lock_queue<T, Allocator, Lock>::closed() const {
+      std::lock_guard<Lock> lock(m_);
+      return closed_;
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   bool lock_queue<T, Allocator, Lock>::full() {
+      std::lock_guard<Lock> lock(m_);
       return internal_full();
    }
 
-   template <typename T>
-   bool lock_queue<T>::empty() const {
-      std::lock_guard<std::mutex> lock(m_);
-      return queue_.empty();
+   template <typename T, typename Allocator, typename Lock>
+   bool lock_queue<T, Allocator, Lock>::empty() const {
+      std::lock_guard<Lock> lock(m_);
+      return internal_empty();
    }
 
-   template <typename T>
-   size_t lock_queue<T>::size() const {
-      std::lock_guard<std::mutex> lock(m_);
-      return queue_.size();
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::size() const {
+      std::lock_guard<Lock> lock(m_);
+      return internal_size();
    }
 
-   template <typename T>
-   size_t lock_queue<T>::capacity() const {
-      std::lock_guard<std::mutex> lock(m_);
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::capacity() const {
+      std::lock_guard<Lock> lock(m_);
       return internal_capacity();
    }
 
-   template <typename T>
-   size_t lock_queue<T>::capacity_free() const {
-      std::lock_guard<std::mutex> lock(m_);
-      return internal_capacity() - queue_.size();
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::capacity_free() const {
+      std::lock_guard<Lock> lock(m_);
+      return internal_capacity() - internal_size();
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::usage() const {
+      std::lock_guard<Lock> lock(m_);
+      return (100 * internal_size() / internal_capacity());
    }
 
-   template <typename T>
-   size_t lock_queue<T>::usage() const {
-      std::lock_guard<std::mutex> lock(m_);
-      return (100 * queue_.size() / internal_capacity());
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::attach(readiness::observer* observer) {
+      observer_.store(observer, std::memory_order_release);
    }
 
    // private
-   template <typename T>
-   size_t lock_queue<T>::internal_capacity() const {
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::notify_pushed(const bool was_empty, const bool wake_consumer) {
+      if (wake_consumer) {
+         data_cond_.notify_one();
+      }
+      if (was_empty) {
+         auto observer = observer_.load(std::memory_order_acquire);
+         if (observer) {
+            observer->notify();
+         }
+      }
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::internal_capacity() const {
       if (kMaxSize == kUnlimited) {
          return std::numeric_limits<unsigned int>::max();
       }
       return kMaxSize;
    }
 
-   template <typename T>
-   bool lock_queue<T>::internal_full() const {
+   template <typename T, typename Allocator, typename Lock>
+   bool lock_queue<T, Allocator, Lock>::internal_full() const {
       if (kMaxSize == kUnlimited) {
          return false;
       }
-      return (queue_.size() >= static_cast<size_t>(kMaxSize));
+      return (count_ >= kSlots);
+   }
+
+   template <typename T, typename Allocator, typename Lock>
+   size_t lock_queue<T, Allocator, Lock>::internal_size() const {
+      if (kMaxSize == kUnlimited) {
+         return queue_->size();
+      }
+      return count_;
    }
+
+   // call only when not full
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::internal_push(T& item) {
+      if (kMaxSize == kUnlimited) {
+         queue_->push_back(std::move(item));
+         return;
+      }
+      size_t back = front_ + count_;
+      if (back >= kSlots) {
+         back -= kSlots;
+      }
+      slot_traits::construct(allocator_, ring_ + back, std::move(item));
+      ++count_;
+   }
+
+   // call only when not empty
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::internal_pop(T& popped_item) {
+      popped_item = std::move(internal_front());
+      internal_drop_front();
+   }
+
+   // call only when not empty
+   template <typename T, typename Allocator, typename Lock>
+   T& lock_queue<T, Allocator, Lock>::internal_front() {
+      if (kMaxSize == kUnlimited) {
+         return queue_->front();
+      }
+      return ring_[front_];
+   }
+
+   // call only when not empty, the oldest item is destroyed
+   template <typename T, typename Allocator, typename Lock>
+   void lock_queue<T, Allocator, Lock>::internal_drop_front() {
+      if (kMaxSize == kUnlimited) {
+         queue_->pop_front();
+         return;
+      }
+      slot_traits::destroy(allocator_, ring_ + front_);
+      if (++front_ == kSlots) {
+         front_ = 0;
+      }
+      --count_;
+   }
+
+#if __has_include(<memory_resource>)
+   namespace pmr {
+      // storage from a std::pmr::memory_resource: lock_queue<T> queue(maxSize, &resource)
+      template <typename T>
+      using lock_queue = mpmc::lock_queue<T, std::pmr::polymorphic_allocator<T>>;
+   }  // namespace pmr
+#endif
 }  // namespace mpmc
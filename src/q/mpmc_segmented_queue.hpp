@@ -0,0 +1,411 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Unbounded lock-free multiple producer, multiple consumer queue. A list of array segments, each with
+* a producer index and a consumer index that are claimed with fetch-add, and a state per slot.
+* Ref: Yang & Mellor-Crummey, "A Wait-free Queue as Fast as Fetch-and-Add" (2016), the segment list.
+*
+* A producer takes the next index of the tail segment, claims the slot (empty -> writing), moves the
+* item in and marks it full. A consumer takes the next index of the head segment. If the producer of
+* that index has not started yet, the consumer marks the slot abandoned and takes the next one, the
+* producer then also moves on. When a segment runs out of indexes the next one is linked in.
+*
+* Segments that every consumer has left are retired with the epoch they were unlinked in, see
+* q/epoch_reclamation.hpp. Once no thread can read them they go back to a few spare segments, or are
+* deleted. Memory is the segments with live items, the retired ones the epoch has not passed yet, and
+* at most 'kSpareSegments' spares.
+*
+* IMPORTANT:
+* 1. Threads register with the reclamation domain on their first call, and leave it when they exit.
+* 2. A consumer that lands on a slot that is being written waits for that producer (spins, then yields).
+* 3. Retiring and reusing a segment takes a short lock, once per 'SegmentSize' items.
+* 4. Close when the producers are done, a push that runs at the same time as 'close' may be lost.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "q/closable.hpp"
+#include "q/epoch_reclamation.hpp"
+#include "q/readiness.hpp"
+
+namespace mpmc {
+   template <typename T, size_t SegmentSize = 256>
+   class segmented_queue {
+      static const size_t kSpareSegments = 4;
+      static const size_t kSpinsBeforeYield = 64;
+      using clock = std::chrono::steady_clock;
+
+      enum state : uint8_t { kEmpty,
+                             kWriting,
+                             kFull,
+                             kTaken,
+                             kAbandoned };
+
+      struct slot {
+         std::atomic<uint8_t> state{kEmpty};
+         typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+         T* item() { return std::launder(reinterpret_cast<T*>(&storage)); }
+      };
+
+      struct segment {
+         alignas(64) std::atomic<size_t> enqueue{0};
+         alignas(64) std::atomic<size_t> dequeue{0};
+         std::atomic<segment*> next{nullptr};
+         slot slots[SegmentSize];
+      };
+
+     public:
+      using value_type = T;
+
+      segmented_queue();
+      virtual ~segmented_queue();
+
+      bool lock_free() const { return true; }
+      queue_api::status push(T& item);
+      queue_api::status pop(T& popped_item);
+      queue_api::status wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+
+      // pops until the queue looks empty. Returns how many, 0 when empty
+      template <typename Container>
+      size_t pop_all(Container& out);
+
+      bool empty() const;
+      bool full() const { return false; }
+      size_t size() const;
+      size_t capacity() const { return std::numeric_limits<unsigned int>::max(); }
+      size_t capacity_free() const { return capacity() - size(); }
+      size_t usage() const { return (100 * size() / capacity()); }
+
+      // segments in use, retired or spare: the memory footprint in 'SegmentSize' steps
+      size_t allocated_segments() const { return allocated_.load(std::memory_order_relaxed); }
+
+      // see q/readiness.hpp, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // any producer: no more pushes, waiting consumers are woken. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+     private:
+      segmented_queue(const segmented_queue&) = delete;
+      segmented_queue& operator=(const segmented_queue&) = delete;
+
+      void advance_tail(segment* full_segment);
+      bool advance_head(segment* used_segment);
+      bool looks_empty() const;  // within an epoch_guard
+      void pushed(segment* at, const size_t index);
+
+      segment* new_segment();
+      void retire(segment* used);
+      void recycle(segment* unused);  // with recycle_m_ held
+
+      alignas(64) std::atomic<segment*> head_;
+      alignas(64) std::atomic<segment*> tail_;
+
+      alignas(64) std::atomic<bool> closed_;
+      std::atomic<size_t> waiting_consumers_;
+      std::atomic<readiness::observer*> observer_;
+      std::atomic<size_t> allocated_;
+      std::mutex park_m_;
+      std::condition_variable data_cond_;
+
+      std::mutex recycle_m_;
+      std::vector<std::pair<segment*, uint64_t>> retired_;  // segment, retire stamp
+      std::vector<segment*> spare_;
+   };
+
+   template <typename T, size_t SegmentSize>
+   segmented_queue<T, SegmentSize>::segmented_queue() :
+       closed_(false),
+       waiting_consumers_(0),
+       observer_(nullptr),
+       allocated_(0) {
+      segment* first = new_segment();
+      head_.store(first);
+      tail_.store(first);
+   }
+
+   // no other thread uses the queue any more, all segments can go at once
+   template <typename T, size_t SegmentSize>
+   segmented_queue<T, SegmentSize>::~segmented_queue() {
+      segment* seg = head_.load();
+      while (seg) {
+         for (auto& s : seg->slots) {
+            if (s.state.load(std::memory_order_relaxed) == kFull) {
+               s.item()->~T();
+            }
+         }
+         segment* next = seg->next.load();
+         delete seg;
+         seg = next;
+      }
+      for (auto& r : retired_) {
+         delete r.first;
+      }
+      for (auto* s : spare_) {
+         delete s;
+      }
+   }
+
+   template <typename T, size_t SegmentSize>
+   queue_api::status segmented_queue<T, SegmentSize>::push(T& item) {
+      if (closed_.load(std::memory_order_acquire)) {
+         return queue_api::status::code::closed;
+      }
+      reclamation::epoch_guard guard;
+      for (;;) {
+         segment* seg = tail_.load(std::memory_order_acquire);
+         if (seg->enqueue.load(std::memory_order_relaxed) >= SegmentSize) {
+            advance_tail(seg);  // no fetch-add on a used up segment, the index would only grow
+            continue;
+         }
+         const size_t index = seg->enqueue.fetch_add(1);  // seq_cst, pairs with a parking consumer
+         if (index >= SegmentSize) {
+            advance_tail(seg);
+            continue;
+         }
+         slot& s = seg->slots[index];
+         uint8_t expected = kEmpty;
+         if (!s.state.compare_exchange_strong(expected, kWriting, std::memory_order_acquire, std::memory_order_relaxed)) {
+            continue;  // a consumer gave up on this slot
+         }
+         ::new (static_cast<void*>(&s.storage)) T(std::move(item));
+         s.state.store(kFull, std::memory_order_release);
+         pushed(seg, index);
+         return queue_api::status::code::success;
+      }
+   }
+
+   template <typename T, size_t SegmentSize>
+   queue_api::status segmented_queue<T, SegmentSize>::pop(T& popped_item) {
+      const bool was_closed = closed();  // before the emptiness check
+      reclamation::epoch_guard guard;
+      for (;;) {
+         segment* seg = head_.load(std::memory_order_acquire);
+         const size_t claimed = seg->dequeue.load(std::memory_order_relaxed);
+         if (claimed >= SegmentSize) {
+            if (!advance_head(seg)) {
+               break;
+            }
+            continue;
+         }
+         if (claimed >= seg->enqueue.load()) {
+            break;  // nothing pushed here yet, do not burn an index
+         }
+         const size_t index = seg->dequeue.fetch_add(1, std::memory_order_acq_rel);
+         if (index >= SegmentSize) {
+            continue;
+         }
+         slot& s = seg->slots[index];
+         uint8_t current = s.state.load(std::memory_order_acquire);
+         if (current == kEmpty && s.state.compare_exchange_strong(current, kAbandoned, std::memory_order_acq_rel)) {
+            continue;  // its producer will take another index
+         }
+         for (size_t spins = 0; current != kFull; current = s.state.load(std::memory_order_acquire)) {
+            if (++spins > kSpinsBeforeYield) {
+               std::this_thread::yield();  // the producer is moving the item in
+            }
+         }
+         T* item = s.item();
+         popped_item = std::move(*item);
+         item->~T();
+         s.state.store(kTaken, std::memory_order_relaxed);
+         return queue_api::status::code::success;
+      }
+      return was_closed ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+   }
+
+   // A consumer only sleeps on an empty queue. It raises 'waiting_consumers_' before it checks,
+   // a producer raises the enqueue index before it reads 'waiting_consumers_': one sees the other
+   template <typename T, size_t SegmentSize>
+   queue_api::status segmented_queue<T, SegmentSize>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
+      auto const timeout = clock::now() + max_wait;
+      for (;;) {
+         auto result = pop(popped_item);
+         if (result || result.closed()) {
+            return result;
+         }
+         std::unique_lock<std::mutex> lock(park_m_);
+         waiting_consumers_.fetch_add(1);
+         bool in_time = true;
+         if (empty() && !closed()) {
+            in_time = (data_cond_.wait_until(lock, timeout) == std::cv_status::no_timeout);
+         }
+         waiting_consumers_.fetch_sub(1);
+         if (!in_time) {
+            lock.unlock();
+            return pop(popped_item);
+         }
+      }
+   }
+
+   template <typename T, size_t SegmentSize>
+   template <typename Container>
+   size_t segmented_queue<T, SegmentSize>::pop_all(Container& out) {
+      size_t count = 0;
+      T item;
+      while (pop(item)) {
+         out.emplace_back(std::move(item));
+         ++count;
+      }
+      return count;
+   }
+
+   template <typename T, size_t SegmentSize>
+   bool segmented_queue<T, SegmentSize>::empty() const {
+      reclamation::epoch_guard guard;
+      return looks_empty();
+   }
+
+   template <typename T, size_t SegmentSize>
+   size_t segmented_queue<T, SegmentSize>::size() const {
+      reclamation::epoch_guard guard;
+      size_t count = 0;
+      for (segment* seg = head_.load(std::memory_order_acquire); seg; seg = seg->next.load(std::memory_order_acquire)) {
+         const size_t pushed = std::min(seg->enqueue.load(), SegmentSize);
+         const size_t popped = std::min(seg->dequeue.load(), SegmentSize);
+         count += pushed > popped ? pushed - popped : 0;
+      }
+      return count;
+   }
+
+   template <typename T, size_t SegmentSize>
+   void segmented_queue<T, SegmentSize>::close() {
+      closed_.store(true);
+      {
+         std::lock_guard<std::mutex> lock(park_m_);  // a consumer between its check and its wait
+      }
+      data_cond_.notify_all();
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         observer->notify();
+      }
+   }
+
+   // private
+   template <typename T, size_t SegmentSize>
+   void segmented_queue<T, SegmentSize>::advance_tail(segment* full_segment) {
+      segment* next = full_segment->next.load(std::memory_order_acquire);
+      if (nullptr == next) {
+         segment* fresh = new_segment();
+         if (full_segment->next.compare_exchange_strong(next, fresh, std::memory_order_acq_rel)) {
+            next = fresh;
+         } else {
+            std::lock_guard<std::mutex> lock(recycle_m_);  // never seen by another thread
+            recycle(fresh);
+         }
+      }
+      tail_.compare_exchange_strong(full_segment, next, std::memory_order_acq_rel);
+   }
+
+   // every index of 'used_segment' is claimed by a consumer. False if there is no next segment
+   template <typename T, size_t SegmentSize>
+   bool segmented_queue<T, SegmentSize>::advance_head(segment* used_segment) {
+      segment* next = used_segment->next.load(std::memory_order_acquire);
+      if (nullptr == next) {
+         return false;
+      }
+      segment* tail = used_segment;
+      tail_.compare_exchange_strong(tail, next, std::memory_order_acq_rel);  // the tail never points behind the head
+      if (head_.compare_exchange_strong(used_segment, next, std::memory_order_acq_rel)) {
+         retire(used_segment);
+      }
+      return true;
+   }
+
+   template <typename T, size_t SegmentSize>
+   bool segmented_queue<T, SegmentSize>::looks_empty() const {
+      for (segment* seg = head_.load(std::memory_order_acquire); seg; seg = seg->next.load(std::memory_order_acquire)) {
+         const size_t popped = seg->dequeue.load();
+         const size_t pushed = seg->enqueue.load();  // seq_cst, see 'wait_and_pop'
+         if (popped < pushed && popped < SegmentSize) {
+            return false;
+         }
+         if (pushed < SegmentSize) {
+            return true;  // the last segment in use
+         }
+      }
+      return true;
+   }
+
+   template <typename T, size_t SegmentSize>
+   void segmented_queue<T, SegmentSize>::pushed(segment* at, const size_t index) {
+      if (waiting_consumers_.load() > 0) {
+         {
+            std::lock_guard<std::mutex> lock(park_m_);
+         }
+         data_cond_.notify_one();
+      }
+      // the consumers had caught up with this index: the queue went from empty to non-empty
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer && at->dequeue.load(std::memory_order_relaxed) >= index) {
+         observer->notify();
+      }
+   }
+
+   template <typename T, size_t SegmentSize>
+   typename segmented_queue<T, SegmentSize>::segment* segmented_queue<T, SegmentSize>::new_segment() {
+      {
+         std::lock_guard<std::mutex> lock(recycle_m_);
+         if (!spare_.empty()) {
+            segment* reused = spare_.back();
+            spare_.pop_back();
+            return reused;
+         }
+      }
+      allocated_.fetch_add(1, std::memory_order_relaxed);
+      return new segment;
+   }
+
+   template <typename T, size_t SegmentSize>
+   void segmented_queue<T, SegmentSize>::retire(segment* used) {
+      const uint64_t stamp = reclamation::retire_stamp();
+      std::lock_guard<std::mutex> lock(recycle_m_);
+      retired_.emplace_back(used, stamp);
+      size_t kept = 0;
+      for (auto& r : retired_) {
+         if (reclamation::safe_to_free(r.second)) {
+            recycle(r.first);
+         } else {
+            retired_[kept++] = r;
+         }
+      }
+      retired_.resize(kept);
+   }
+
+   template <typename T, size_t SegmentSize>
+   void segmented_queue<T, SegmentSize>::recycle(segment* unused) {
+      if (spare_.size() >= kSpareSegments) {
+         allocated_.fetch_sub(1, std::memory_order_relaxed);
+         delete unused;
+         return;
+      }
+      unused->enqueue.store(0, std::memory_order_relaxed);
+      unused->dequeue.store(0, std::memory_order_relaxed);
+      unused->next.store(nullptr, std::memory_order_relaxed);
+      for (auto& s : unused->slots) {
+         s.state.store(kEmpty, std::memory_order_relaxed);
+      }
+      spare_.push_back(unused);
+   }
+}  // namespace mpmc
@@ -0,0 +1,362 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Multiple producer, multiple consumer queue with one lock for the producers and one for the consumers.
+* Same API as mpmc::lock_queue, so the two can be swapped through queue_api::CreateQueue.
+*
+* Linked list with a dummy node, after Michael & Scott: "Simple, Fast, and Practical Non-Blocking and
+* Blocking Concurrent Queue Algorithms" (1996). Producers append behind the tail lock, consumers unlink
+* behind the head lock. The dummy node keeps them apart: they never touch the same node's fields,
+* except the 'next' pointer of the last node, which is atomic.
+*
+* The item count is kept in an atomic, 'size()'/'empty()'/'full()' read it without a lock.
+* A push allocates its node before it takes the lock, a pop frees the old dummy after it lets go of the lock.
+*
+* Parking (wait_and_pop/wait_and_push) uses a waiter count per side: the other side only takes the
+* lock of the parked side, to notify, when somebody is parked.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
+
+namespace mpmc {
+   template <typename T>
+   class two_lock_queue {
+      static const int kUnlimited = -1;
+      static const int kSmallDefault = 100;
+      using clock = std::chrono::steady_clock;
+
+      struct node {
+         T value{};
+         std::atomic<node*> next{nullptr};
+      };
+
+     public:
+      using value_type = T;
+
+      // -1 : unbounded
+      // 0 ... N : bounded (0 is silly)
+      two_lock_queue(const int maxSize = kSmallDefault);
+      virtual ~two_lock_queue();
+
+      bool lock_free() const { return false; }
+      queue_api::status push(T& item);
+      queue_api::status wait_and_push(T& item, std::chrono::milliseconds max_wait);  // waits while full
+      queue_api::status pop(T& popped_item);
+      queue_api::status wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+
+      // moves all items to the back of 'out' with one head lock. Returns how many, 0 when empty
+      template <typename Container>
+      size_t pop_all(Container& out);
+
+      bool full() const { return internal_full(); }
+      bool empty() const { return 0 == size_.load(std::memory_order_relaxed); }
+      size_t size() const { return size_.load(std::memory_order_relaxed); }
+      size_t capacity() const;
+      size_t capacity_free() const { return capacity() - size(); }
+      size_t usage() const { return (100 * size() / capacity()); }
+
+      // see q/readiness.hpp, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // any producer: no more pushes, waiting consumers and producers are woken. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+     private:
+      two_lock_queue(const two_lock_queue&) = delete;
+      two_lock_queue& operator=(const two_lock_queue&) = delete;
+
+      bool internal_full() const;
+      queue_api::status push_locked(T& item, std::unique_ptr<node>& fresh, size_t& before);
+      queue_api::status pop_locked(T& popped_item, node*& old_head);
+      void pushed(const size_t before);
+      void popped(const size_t count);
+
+      // parks on 'cond' until woken or timeout, false at timeout. 'ready' is checked again after
+      // 'waiting' is raised: the other side raises 'ready' before it reads 'waiting'
+      template <typename Ready>
+      bool park(std::unique_lock<std::mutex>& lock, std::condition_variable& cond, std::atomic<size_t>& waiting,
+                Ready ready, const clock::time_point timeout);
+
+      typedef char cache_line[64];
+      const int kMaxSize;
+
+      cache_line pad_head_;
+      std::mutex head_m_;
+      node* head_;  // the dummy, guarded by head_m_
+      std::condition_variable data_cond_;
+
+      cache_line pad_tail_;
+      std::mutex tail_m_;
+      node* tail_;  // guarded by tail_m_
+      std::condition_variable not_full_cond_;
+
+      cache_line pad_shared_;
+      std::atomic<size_t> size_;
+      std::atomic<size_t> waiting_consumers_;
+      std::atomic<size_t> waiting_producers_;
+      std::atomic<bool> closed_;  // written under tail_m_
+      std::atomic<readiness::observer*> observer_;
+      cache_line pad_end_;
+   };
+
+   template <typename T>
+   two_lock_queue<T>::two_lock_queue(const int maxSize) :
+       kMaxSize(maxSize),
+       head_(new node),
+       tail_(head_),
+       size_(0),
+       waiting_consumers_(0),
+       waiting_producers_(0),
+       closed_(false),
+       observer_(nullptr) {}
+
+   template <typename T>
+   two_lock_queue<T>::~two_lock_queue() {
+      while (head_) {
+         node* next = head_->next.load(std::memory_order_relaxed);
+         delete head_;
+         head_ = next;
+      }
+   }
+
+   template <typename T>
+   queue_api::status two_lock_queue<T>::push(T& item) {
+      if (internal_full()) {
+         return queue_api::status::code::unavailable;  // no allocation for a push that fails
+      }
+      std::unique_ptr<node> fresh(new node);
+      queue_api::status result;
+      size_t before = 0;
+      {
+         std::lock_guard<std::mutex> lock(tail_m_);
+         result = push_locked(item, fresh, before);
+      }
+      if (result) {
+         pushed(before);
+      }
+      return result;
+   }
+
+   template <typename T>
+   queue_api::status two_lock_queue<T>::wait_and_push(T& item, std::chrono::milliseconds max_wait) {
+      std::unique_ptr<node> fresh(new node);
+      queue_api::status result;
+      size_t before = 0;
+      {
+         std::unique_lock<std::mutex> lock(tail_m_);
+         auto const timeout = clock::now() + max_wait;
+         auto room = [this] { return !internal_full() || closed_.load(std::memory_order_relaxed); };
+         while (!room()) {
+            if (!park(lock, not_full_cond_, waiting_producers_, room, timeout)) {
+               break;
+            }
+         }
+         result = push_locked(item, fresh, before);
+      }
+      if (result) {
+         pushed(before);
+      }
+      return result;
+   }
+
+   template <typename T>
+   queue_api::status two_lock_queue<T>::pop(T& popped_item) {
+      node* old_head = nullptr;
+      queue_api::status result;
+      {
+         std::lock_guard<std::mutex> lock(head_m_);
+         result = pop_locked(popped_item, old_head);
+      }
+      if (result) {
+         delete old_head;
+         popped(1);
+      }
+      return result;
+   }
+
+   template <typename T>
+   queue_api::status two_lock_queue<T>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
+      node* old_head = nullptr;
+      queue_api::status result;
+      {
+         std::unique_lock<std::mutex> lock(head_m_);
+         auto const timeout = clock::now() + max_wait;
+         auto ready = [this] { return nullptr != head_->next.load() || closed_.load(); };
+         while (!ready()) {
+            if (!park(lock, data_cond_, waiting_consumers_, ready, timeout)) {
+               break;
+            }
+         }
+         result = pop_locked(popped_item, old_head);
+      }
+      if (result) {
+         delete old_head;
+         popped(1);
+      }
+      return result;
+   }
+
+   template <typename T>
+   template <typename Container>
+   size_t two_lock_queue<T>::pop_all(Container& out) {
+      size_t count = 0;
+      node* first = nullptr;
+      node* last = nullptr;
+      {
+         std::lock_guard<std::mutex> lock(head_m_);
+         first = head_;
+         node* next = head_->next.load(std::memory_order_acquire);
+         while (next) {
+            out.emplace_back(std::move(next->value));
+            head_ = next;
+            next = head_->next.load(std::memory_order_acquire);
+            ++count;
+         }
+         last = head_;  // the new dummy
+      }
+      while (first != last) {
+         node* next = first->next.load(std::memory_order_relaxed);
+         delete first;
+         first = next;
+      }
+      if (count > 0) {
+         popped(count);
+      }
+      return count;
+   }
+
+   // pushes after 'close' are refused under the same lock, so a consumer that sees
+   // 'closed_' also sees every item that made it in
+   template <typename T>
+   void two_lock_queue<T>::close() {
+      {
+         std::lock_guard<std::mutex> lock(tail_m_);
+         closed_.store(true);
+      }
+      not_full_cond_.notify_all();
+      {
+         std::lock_guard<std::mutex> lock(head_m_);  // a consumer between its check and its wait
+      }
+      data_cond_.notify_all();
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         observer->notify();
+      }
+   }
+
+   template <typename T>
+   size_t two_lock_queue<T>::capacity() const {
+      if (kMaxSize == kUnlimited) {
+         return std::numeric_limits<unsigned int>::max();
+      }
+      return kMaxSize;
+   }
+
+   // private
+   template <typename T>
+   bool two_lock_queue<T>::internal_full() const {
+      if (kMaxSize == kUnlimited) {
+         return false;
+      }
+      return size_.load() >= static_cast<size_t>(kMaxSize);
+   }
+
+   // The size is raised under the tail lock before the item is linked, so a consumer never lowers it
+   // below zero and the next producer's full check counts this item. 'before' is the size it replaced
+   template <typename T>
+   queue_api::status two_lock_queue<T>::push_locked(T& item, std::unique_ptr<node>& fresh, size_t& before) {
+      if (closed_.load(std::memory_order_relaxed)) {
+         return queue_api::status::code::closed;
+      }
+      if (internal_full()) {
+         return queue_api::status::code::unavailable;
+      }
+      fresh->value = std::move(item);
+      node* linked = fresh.release();
+      before = size_.fetch_add(1);
+      tail_->next.store(linked);  // seq_cst: pairs with a parking consumer, see 'park'
+      tail_ = linked;
+      return queue_api::status::code::success;
+   }
+
+   template <typename T>
+   queue_api::status two_lock_queue<T>::pop_locked(T& popped_item, node*& old_head) {
+      const bool closed = closed_.load(std::memory_order_acquire);  // before the emptiness check
+      node* next = head_->next.load(std::memory_order_acquire);
+      if (nullptr == next) {
+         return closed ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+      }
+      popped_item = std::move(next->value);
+      old_head = head_;
+      head_ = next;
+      return queue_api::status::code::success;
+   }
+
+   // after the tail lock is released
+   template <typename T>
+   void two_lock_queue<T>::pushed(const size_t before) {
+      if (waiting_consumers_.load() > 0) {
+         {
+            std::lock_guard<std::mutex> lock(head_m_);  // a consumer between its check and its wait
+         }
+         data_cond_.notify_one();
+      }
+      if (0 == before) {
+         auto observer = observer_.load(std::memory_order_acquire);
+         if (observer) {
+            observer->notify();
+         }
+      }
+   }
+
+   // after the head lock is released. As in lock_queue every pop wakes a parked producer,
+   // 'pop_all' wakes all of them
+   template <typename T>
+   void two_lock_queue<T>::popped(const size_t count) {
+      size_.fetch_sub(count);
+      if (kMaxSize == kUnlimited || 0 == count) {
+         return;
+      }
+      if (waiting_producers_.load() > 0) {
+         {
+            std::lock_guard<std::mutex> lock(tail_m_);  // a producer between its check and its wait
+         }
+         if (1 == count) {
+            not_full_cond_.notify_one();
+         } else {
+            not_full_cond_.notify_all();
+         }
+      }
+   }
+
+   template <typename T>
+   template <typename Ready>
+   bool two_lock_queue<T>::park(std::unique_lock<std::mutex>& lock, std::condition_variable& cond,
+                                std::atomic<size_t>& waiting, Ready ready, const clock::time_point timeout) {
+      bool in_time = true;
+      waiting.fetch_add(1);  // seq_cst
+      if (!ready()) {
+         in_time = (cond.wait_until(lock, timeout) == std::cv_status::no_timeout);
+      }
+      waiting.fetch_sub(1);
+      return in_time;
+   }
+}  // namespace mpmc
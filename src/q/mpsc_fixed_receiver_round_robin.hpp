@@ -20,14 +20,26 @@
 * 4. A producer SPSC queue that is congested will have items that takes longer time to go through than a SPSC queue that is not congested. The Consumer pops each queue in a round-robin manner.
 * 5. If there is no item available in the 'current' queue the POP(..) attempt will go to the next
    queue until at most all queues are visited once.
+* 6. Each producer closes its own queue. The receiver is closed when ALL queues are closed and drained.
+*
+* 'mpsc::static_size::round_robin::Receiver<QType, N>': the same with N producers known at compile
+* time, see 'round_robin::static_API'
+*
+*    auto lanes = round_robin::CreateLanes<spsc::circular_fifo<int>, 4>(1024);
+*    mpsc::static_size::round_robin::Receiver<spsc::circular_fifo<int>, 4> receiver(lanes.second);
 */
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
+#include <thread>
 #include <utility>
 #include <vector>
+#include "q/closable.hpp"
 #include "q/q_api.hpp"
+#include "q/readiness.hpp"
 #include "q/round_robin_api.hpp"
 #include "q/spsc_circular_fifo.hpp"
 
@@ -55,10 +67,23 @@ namespace mpsc {
             virtual ~Receiver() = default;
 
             template <typename Element>
-            bool pop(Element& item);
+            queue_api::status pop(Element& item);
 
             template <typename Element>
-            bool wait_and_pop(Element& item, const std::chrono::milliseconds wait_ms);
+            queue_api::status wait_and_pop(Element& item, const std::chrono::milliseconds wait_ms);
+
+            // range-for until all queues are closed and drained. See q/closable.hpp
+            template <typename Q = QType>
+            queue_api::receive_iterator<Receiver, typename Q::value_type> begin() {
+               return queue_api::receive_iterator<Receiver, typename Q::value_type>(this);
+            }
+            template <typename Q = QType>
+            queue_api::receive_iterator<Receiver, typename Q::value_type> end() {
+               return queue_api::receive_iterator<Receiver, typename Q::value_type>();
+            }
+
+            // the observer is attached to all producer queues, see q/readiness.hpp
+            void attach(readiness::observer* observer);
          };
 
          template <typename QType>
@@ -67,29 +92,36 @@ namespace mpsc {
 
          template <typename QType>
          template <typename Element>
-         bool Receiver<QType>::pop(Element& item) {
-            bool result = false;
+         queue_api::status Receiver<QType>::pop(Element& item) {
             const size_t loop_check = QueueAPI::queues_.size();
 
+            size_t closed = 0;
             size_t count = 0;
-            while (!result && count++ < loop_check) {
-               result = QueueAPI::queues_[QueueAPI::current_].pop(item);
+            while (count++ < loop_check) {
+               auto result = QueueAPI::queues_[QueueAPI::current_].pop(item);
                QueueAPI::current_ = QueueAPI::increment(QueueAPI::current_);
+               if (result) {
+                  return queue_api::status::code::success;
+               }
+               closed += queue_api::is_closed(result) ? 1 : 0;
             }
-            return result;
+            return (closed == loop_check) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
          }
 
          template <typename QType>
          template <typename Element>
-         bool Receiver<QType>::wait_and_pop(Element& item, const std::chrono::milliseconds max_wait) {
+         queue_api::status Receiver<QType>::wait_and_pop(Element& item, const std::chrono::milliseconds max_wait) {
             using milliseconds = std::chrono::milliseconds;
             using clock = std::chrono::steady_clock;
             using namespace std::chrono_literals;
             auto t1 = clock::now();
-            bool result = false;
+            queue_api::status result;
             const size_t wrap = QueueAPI::current_;
             while (!result) {
                result = pop(item);
+               if (result.closed()) {
+                  break;
+               }
                auto elapsed_ms = std::chrono::duration_cast<milliseconds>(clock::now() - t1);
                if (elapsed_ms > max_wait) {
                   break;
@@ -100,6 +132,69 @@ namespace mpsc {
             }
             return result;
          }
+
+         template <typename QType>
+         void Receiver<QType>::attach(readiness::observer* observer) {
+            for (auto& q : QueueAPI::queues_) {
+               q.attach(observer);
+            }
+         }
       }  // namespace round_robin
    }     // namespace fixed_size
+
+   namespace static_size {
+      namespace round_robin {
+         // As mpsc::fixed_size::round_robin::Receiver for N producers known at compile time
+         template <typename QType, size_t N>
+         class Receiver : public ::round_robin::static_API<QType, queue_api::Receiver<QType>, N> {
+           public:
+            using QueueAPI = ::round_robin::static_API<QType, queue_api::Receiver<QType>, N>;
+
+            Receiver(std::array<queue_api::Receiver<QType>, N> receivers) :
+                QueueAPI(std::move(receivers)) {}
+            virtual ~Receiver() = default;
+
+            template <typename Element>
+            queue_api::status pop(Element& item) {
+               return QueueAPI::visit([&item](queue_api::Receiver<QType>& q) { return q.pop(item); });
+            }
+
+            template <typename Element>
+            queue_api::status wait_and_pop(Element& item, const std::chrono::milliseconds max_wait);
+
+            // range-for until all queues are closed and drained. See q/closable.hpp
+            template <typename Q = QType>
+            queue_api::receive_iterator<Receiver, typename Q::value_type> begin() {
+               return queue_api::receive_iterator<Receiver, typename Q::value_type>(this);
+            }
+            template <typename Q = QType>
+            queue_api::receive_iterator<Receiver, typename Q::value_type> end() {
+               return queue_api::receive_iterator<Receiver, typename Q::value_type>();
+            }
+
+            // the observer is attached to all producer queues, see q/readiness.hpp
+            void attach(readiness::observer* observer) {
+               for (auto& q : QueueAPI::queues_) {
+                  q.attach(observer);
+               }
+            }
+         };
+
+         // as the fixed_size Receiver: a short sleep when a visit of all queues found nothing
+         template <typename QType, size_t N>
+         template <typename Element>
+         queue_api::status Receiver<QType, N>::wait_and_pop(Element& item, const std::chrono::milliseconds max_wait) {
+            using clock = std::chrono::steady_clock;
+            using namespace std::chrono_literals;
+            auto const timeout = clock::now() + max_wait;
+            for (;;) {
+               auto result = pop(item);
+               if (result || result.closed() || clock::now() > timeout) {
+                  return result;
+               }
+               std::this_thread::sleep_for(100ns);
+            }
+         }
+      }  // namespace round_robin
+   }     // namespace static_size
 }  // namespace mpsc
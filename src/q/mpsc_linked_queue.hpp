@@ -0,0 +1,301 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* MPSC - Multiple Producers - Single Consumer, unbounded linked list. Any number of producers,
+* they do not have to be known up front as with mpsc::fixed_size::round_robin.
+* Ref: Dmitry Vyukov, "Intrusive MPSC node-based queue" (1024cores.net)
+*
+* A push is one atomic exchange of the head and one store to link the old head to the new node:
+* wait-free for the producers. The consumer walks the list from the tail without atomic RMW.
+*
+* 'mpsc::intrusive_linked_queue<Node>': Node derives from 'mpsc::intrusive_node', the queue links the
+*                                        nodes themselves and never allocates or deletes. Elements
+*                                        are 'Node*', e.g. nodes from a pool::object_pool.
+* 'mpsc::linked_queue<T>':               elements by value, one node allocation per push.
+*
+*    auto queue = queue_api::CreateQueue<mpsc::linked_queue<std::string>>();
+*
+* IMPORTANT:
+* 1. Only ONE thread may pop. 'size()' walks the list and is for the consumer thread only.
+* 2. A producer preempted between its exchange and its link hides the items behind it until it
+*    runs again, 'pop' then returns 'unavailable' on a queue that is not 'empty()'.
+* 3. 'close()' is queued like an item: what was pushed before it is delivered first. Close when the
+*    producers are done, a push that runs at the same time as 'close' may be lost.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "q/closable.hpp"
+
+namespace mpsc {
+   struct intrusive_node {
+      std::atomic<intrusive_node*> next{nullptr};
+   };
+
+   template <typename Node>
+   class intrusive_linked_queue {
+      using clock = std::chrono::steady_clock;
+
+     public:
+      using value_type = Node*;
+
+      intrusive_linked_queue();
+      virtual ~intrusive_linked_queue() = default;  // the nodes belong to the caller
+
+      bool lock_free() const { return true; }
+      queue_api::status push(Node*& item);
+      queue_api::status pop(Node*& popped_item);
+      queue_api::status wait_and_pop(Node*& popped_item, std::chrono::milliseconds max_wait);
+
+      bool empty() const { return head_.load() == tail_.load(); }  // seq_cst, see 'wait_and_pop'
+      bool full() const { return false; }
+      size_t size() const { return size_.load(std::memory_order_relaxed); }  // any thread, a snapshot
+      size_t capacity() const { return std::numeric_limits<unsigned int>::max(); }
+      size_t capacity_free() const { return capacity() - size(); }
+      size_t usage() const { return (100 * size() / capacity()); }
+
+      // any producer, once. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+     private:
+      intrusive_linked_queue(const intrusive_linked_queue&) = delete;
+      intrusive_linked_queue& operator=(const intrusive_linked_queue&) = delete;
+
+      void link(intrusive_node* node);
+      void wake_consumer();
+      intrusive_node* unlink();
+
+      alignas(64) std::atomic<intrusive_node*> head_;  // producers
+      alignas(64) std::atomic<intrusive_node*> tail_;  // consumer, atomic only so 'empty()' can compare it
+      bool close_seen_;                                 // consumer
+      intrusive_node stub_;                             // keeps the list non-empty
+      intrusive_node close_marker_;
+      alignas(64) std::atomic<size_t> size_;          // raised before the link, so never below zero
+      alignas(64) std::atomic<bool> closed_;
+      std::atomic<bool> consumer_waiting_;
+      std::mutex park_m_;
+      std::condition_variable data_cond_;
+   };
+
+   template <typename T>
+   class linked_queue {
+      struct node : intrusive_node {
+         explicit node(T&& item) :
+             value(std::move(item)) {}
+         T value;
+      };
+
+     public:
+      using value_type = T;
+
+      linked_queue() = default;
+      virtual ~linked_queue();
+
+      bool lock_free() const { return true; }
+      queue_api::status push(T& item);
+      queue_api::status pop(T& popped_item);
+      queue_api::status wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait);
+
+      bool empty() const { return nodes_.empty(); }
+      bool full() const { return false; }
+      size_t size() const { return nodes_.size(); }
+      size_t capacity() const { return nodes_.capacity(); }
+      size_t capacity_free() const { return nodes_.capacity_free(); }
+      size_t usage() const { return nodes_.usage(); }
+
+      void close() { nodes_.close(); }
+      bool closed() const { return nodes_.closed(); }
+
+     private:
+      queue_api::status take(const queue_api::status result, node* popped, T& popped_item);
+
+      intrusive_linked_queue<node> nodes_;
+   };
+
+   // intrusive_linked_queue
+   template <typename Node>
+   intrusive_linked_queue<Node>::intrusive_linked_queue() :
+       head_(&stub_),
+       tail_(&stub_),
+       close_seen_(false),
+       size_(0),
+       closed_(false),
+       consumer_waiting_(false) {
+      static_assert(std::is_base_of<intrusive_node, Node>::value, "Node must derive from mpsc::intrusive_node");
+   }
+
+   template <typename Node>
+   queue_api::status intrusive_linked_queue<Node>::push(Node*& item) {
+      if (closed_.load(std::memory_order_acquire)) {
+         return queue_api::status::code::closed;
+      }
+      size_.fetch_add(1, std::memory_order_relaxed);
+      link(item);
+      wake_consumer();
+      return queue_api::status::code::success;
+   }
+
+   template <typename Node>
+   queue_api::status intrusive_linked_queue<Node>::pop(Node*& popped_item) {
+      for (;;) {
+         intrusive_node* node = unlink();
+         if (nullptr == node) {
+            return (close_seen_ && empty()) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+         if (node == &close_marker_) {
+            close_seen_ = true;
+            continue;
+         }
+         size_.fetch_sub(1, std::memory_order_relaxed);
+         popped_item = static_cast<Node*>(node);
+         return queue_api::status::code::success;
+      }
+   }
+
+   // A consumer only sleeps on an empty queue. It raises 'consumer_waiting_' before it checks 'empty()',
+   // a producer moves the head before it reads 'consumer_waiting_': one of them sees the other
+   template <typename Node>
+   queue_api::status intrusive_linked_queue<Node>::wait_and_pop(Node*& popped_item, std::chrono::milliseconds max_wait) {
+      auto const timeout = clock::now() + max_wait;
+      for (;;) {
+         auto result = pop(popped_item);
+         if (result || result.closed() || clock::now() >= timeout) {
+            return result;
+         }
+         if (!empty()) {
+            std::this_thread::yield();  // a producer is between its exchange and its link
+            continue;
+         }
+         std::unique_lock<std::mutex> lock(park_m_);
+         consumer_waiting_.store(true);
+         bool in_time = true;
+         if (empty()) {
+            in_time = (data_cond_.wait_until(lock, timeout) == std::cv_status::no_timeout);
+         }
+         consumer_waiting_.store(false, std::memory_order_relaxed);
+         if (!in_time) {
+            lock.unlock();
+            return pop(popped_item);
+         }
+      }
+   }
+
+   template <typename Node>
+   void intrusive_linked_queue<Node>::close() {
+      if (!closed_.exchange(true)) {
+         link(&close_marker_);
+         wake_consumer();
+      }
+   }
+
+   // private
+   template <typename Node>
+   void intrusive_linked_queue<Node>::link(intrusive_node* node) {
+      node->next.store(nullptr, std::memory_order_relaxed);
+      intrusive_node* previous = head_.exchange(node);  // seq_cst, pairs with the consumer's 'empty()'
+      previous->next.store(node, std::memory_order_release);
+   }
+
+   template <typename Node>
+   void intrusive_linked_queue<Node>::wake_consumer() {
+      if (consumer_waiting_.load()) {
+         {
+            std::lock_guard<std::mutex> lock(park_m_);  // the consumer between its check and its wait
+         }
+         data_cond_.notify_one();
+      }
+   }
+
+   // the oldest node, or nullptr. The stub is put back at the end when the last node is taken, so the
+   // last node's 'next' is never written by a producer after it is handed out
+   template <typename Node>
+   intrusive_node* intrusive_linked_queue<Node>::unlink() {
+      intrusive_node* tail = tail_.load(std::memory_order_relaxed);
+      intrusive_node* next = tail->next.load(std::memory_order_acquire);
+      if (tail == &stub_) {
+         if (nullptr == next) {
+            return nullptr;
+         }
+         tail_.store(next, std::memory_order_relaxed);
+         tail = next;
+         next = next->next.load(std::memory_order_acquire);
+      }
+      if (next) {
+         tail_.store(next, std::memory_order_relaxed);
+         return tail;
+      }
+      if (tail != head_.load(std::memory_order_acquire)) {
+         return nullptr;  // a push is not linked yet
+      }
+      link(&stub_);
+      next = tail->next.load(std::memory_order_acquire);
+      if (next) {
+         tail_.store(next, std::memory_order_relaxed);
+         return tail;
+      }
+      return nullptr;
+   }
+
+   // linked_queue
+   template <typename T>
+   linked_queue<T>::~linked_queue() {
+      node* popped = nullptr;
+      while (nodes_.pop(popped)) {
+         delete popped;
+      }
+   }
+
+   template <typename T>
+   queue_api::status linked_queue<T>::push(T& item) {
+      if (nodes_.closed()) {
+         return queue_api::status::code::closed;  // no allocation for a push that fails
+      }
+      node* fresh = new node(std::move(item));
+      auto result = nodes_.push(fresh);
+      if (!result) {
+         item = std::move(fresh->value);
+         delete fresh;
+      }
+      return result;
+   }
+
+   template <typename T>
+   queue_api::status linked_queue<T>::pop(T& popped_item) {
+      node* popped = nullptr;
+      const auto result = nodes_.pop(popped);
+      return take(result, popped, popped_item);
+   }
+
+   template <typename T>
+   queue_api::status linked_queue<T>::wait_and_pop(T& popped_item, std::chrono::milliseconds max_wait) {
+      node* popped = nullptr;
+      const auto result = nodes_.wait_and_pop(popped, max_wait);
+      return take(result, popped, popped_item);
+   }
+
+   template <typename T>
+   queue_api::status linked_queue<T>::take(const queue_api::status result, node* popped, T& popped_item) {
+      if (result) {
+         popped_item = std::move(popped->value);
+         delete popped;
+      }
+      return result;
+   }
+}  // namespace mpsc
@@ -0,0 +1,186 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* MPSC - Multiple Producers - Single Consumer, one bounded ring shared by all producers.
+* Ref: Dmitry Vyukov, "Bounded MPMC queue" (1024cores.net), with the consumer side made single threaded
+*
+* Compared to mpsc::fixed_size::round_robin (one SPSC lane per producer):
+*   - one ring of 'size' items, not one per producer
+*   - global FIFO: items come out in the order the producers claimed their slots
+*   - producers do not have to be known up front
+*
+* A producer claims a slot with a CAS on the tail, writes the item and then publishes the slot's
+* sequence number. The consumer only reads a slot whose sequence says it is published, so it never
+* sees a half written item. The consumer has no atomic RMW and never waits: wait-free.
+*
+*    auto queue = queue_api::CreateQueue<mpsc::ring_queue<std::string>>(1024);
+*
+* Same API as spsc::circular_fifo: push, pop, attach (q/readiness.hpp), close (q/closable.hpp)
+*
+* IMPORTANT:
+* 1. Only ONE thread may pop.
+* 2. A producer preempted between its claim and its publish holds back the items claimed after it,
+*    'pop' returns 'unavailable' on a queue that is not 'empty()' until that producer runs again.
+* 3. 'close()' is set in the tail itself: a claim after the close fails, a claim before it is delivered.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <memory>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
+
+namespace mpsc {
+   template <typename Element>
+   class ring_queue {
+     public:
+      using value_type = Element;
+
+      explicit ring_queue(const size_t size);
+      virtual ~ring_queue() = default;
+
+      queue_api::status push(Element& item);
+      queue_api::status pop(Element& item);
+      bool empty() const { return position(tail_.load()) == head_.load(); }
+      bool full() const { return size() >= kSize; }
+      size_t capacity() const { return kSize; }
+      size_t capacity_free() const { return kSize - size(); }
+      size_t usage() const { return (100 * size() / kSize); }
+      size_t size() const;
+      bool lock_free() const { return std::atomic<size_t>{}.is_lock_free(); }
+
+      // consumer side: see q/readiness.hpp. Attach before the producers start, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // any producer, once. See q/closable.hpp
+      void close();
+      bool closed() const { return 0 != (tail_.load(std::memory_order_acquire) & kClosedBit); }
+
+     private:
+      ring_queue(const ring_queue&) = delete;
+      ring_queue& operator=(const ring_queue&) = delete;
+
+      // 'sequence' is the position the slot is free for, or position + 1 once the item is published
+      struct slot {
+         std::atomic<size_t> sequence;
+         Element value;
+      };
+
+      static const size_t kClosedBit = size_t{1} << (std::numeric_limits<size_t>::digits - 1);
+      static size_t position(const size_t tail) { return tail & ~kClosedBit; }
+      slot& at(const size_t position) { return slots_[position % kSize]; }
+      void notify_if_drained(readiness::observer* observer, size_t pushed) const;
+
+      const size_t kSize;
+      std::unique_ptr<slot[]> slots_;
+
+      alignas(64) std::atomic<size_t> tail_;  // next position to claim, producers. 'kClosedBit' when closed
+      alignas(64) std::atomic<size_t> head_;  // next position to pop, consumer
+      std::atomic<readiness::observer*> observer_;
+      char pad_[64];
+   };
+
+   template <typename Element>
+   ring_queue<Element>::ring_queue(const size_t size) :
+       kSize(size),
+       slots_(new slot[size]),
+       tail_(0),
+       head_(0),
+       observer_(nullptr) {
+      for (size_t i = 0; i < kSize; ++i) {
+         slots_[i].sequence.store(i, std::memory_order_relaxed);
+      }
+   }
+
+   template <typename Element>
+   queue_api::status ring_queue<Element>::push(Element& item) {
+      size_t tail = tail_.load(std::memory_order_relaxed);
+      for (;;) {
+         if (tail & kClosedBit) {
+            return queue_api::status::code::closed;
+         }
+         slot& claim = at(tail);
+         const size_t sequence = claim.sequence.load(std::memory_order_acquire);
+         if (sequence != tail) {
+            if (sequence < tail) {
+               return queue_api::status::code::unavailable;  // full: the consumer has not freed the slot
+            }
+            tail = tail_.load(std::memory_order_relaxed);  // another producer claimed it
+            continue;
+         }
+         // a failed CAS reloads 'tail', also when a close set the bit
+         if (tail_.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed, std::memory_order_relaxed)) {
+            claim.value = std::move(item);
+            claim.sequence.store(tail + 1, std::memory_order_release);
+            auto observer = observer_.load(std::memory_order_acquire);
+            if (observer) {
+               notify_if_drained(observer, tail);
+            }
+            return queue_api::status::code::success;
+         }
+      }
+   }
+
+   // As spsc::circular_fifo::pop. The consumer waits for its head slot to be published, not for the tail
+   template <typename Element>
+   queue_api::status ring_queue<Element>::pop(Element& item) {
+      const size_t head = head_.load(std::memory_order_relaxed);
+      slot& oldest = at(head);
+      if (oldest.sequence.load(std::memory_order_acquire) != head + 1) {
+         const bool closed = this->closed();
+         if (!closed && nullptr == observer_.load(std::memory_order_relaxed)) {
+            return queue_api::status::code::unavailable;
+         }
+
+         // pairs with the fence in 'notify_if_drained'. When closed: the claims before the close are
+         // in the tail we read, and a claimed slot that is not published yet is not 'closed'
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (oldest.sequence.load(std::memory_order_acquire) != head + 1) {
+            const bool drained = closed && position(tail_.load(std::memory_order_acquire)) == head;
+            return drained ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+      }
+
+      item = std::move(oldest.value);
+      oldest.sequence.store(head + kSize, std::memory_order_release);  // free for the next lap
+      head_.store(head + 1, std::memory_order_release);
+      return queue_api::status::code::success;
+   }
+
+   template <typename Element>
+   size_t ring_queue<Element>::size() const {
+      const size_t head = head_.load();
+      const size_t tail = position(tail_.load());
+      return tail > head ? tail - head : 0;  // claimed, not all published yet
+   }
+
+   template <typename Element>
+   void ring_queue<Element>::close() {
+      tail_.fetch_or(kClosedBit, std::memory_order_acq_rel);
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         observer->notify();
+      }
+   }
+
+   // The consumer might wait for exactly the slot we published. With more producers, the one that
+   // publishes the consumer's head slot is the one that notifies
+   template <typename Element>
+   void ring_queue<Element>::notify_if_drained(readiness::observer* observer, size_t pushed) const {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (head_.load(std::memory_order_relaxed) == pushed) {
+         observer->notify();
+      }
+   }
+}  // namespace mpsc
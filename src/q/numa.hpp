@@ -0,0 +1,259 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Queue storage on a chosen NUMA node. A ring allocated by the main thread lands on the main thread's
+* node, and every push or pop from a thread on the other socket crosses the interconnect.
+*
+* 'numa::allocator<T>(node)' maps fresh pages and sets the preferred node policy on them (mbind)
+* before anything touches them, so they fault in on 'node' whichever thread constructs the queue.
+* The policy is 'preferred', not 'bind': when the node is out of memory the pages come from another
+* node instead of failing. 'placement()' reports the node that was asked for and the node the kernel
+* put the first page on.
+*
+*    numa::allocator<int> memory(numa::this_node());     // called on the consumer thread: its node
+*    auto queue = queue_api::CreateQueue<spsc::numa::circular_fifo<int>>(1024, memory);
+*    memory.placement().node;                            // where the ring is
+*
+*    auto lanes = mpsc::flat::CreateLanes<int>(producers, 1024, consumer_node);  // q/flat_lanes.hpp
+*
+* 'node_of_cpu(cpu)' gives the node of a thread that is pinned but not yet started.
+*
+* Degrades gracefully: on a single node machine, on non-Linux, or when the kernel refuses the policy
+* (containers often filter mbind) the memory is allocated as usual and 'placement().bound' is false.
+* To try it on one socket, boot with 'numa=fake=2' or run the benchmark under numactl.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <new>
+#include <string>
+#include "q/spsc_circular_fifo.hpp"
+#if defined(__linux__)
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace numa {
+   const int kAnyNode = -1;
+
+   struct placement {
+      int requested = kAnyNode;  // the node that was asked for
+      int node = kAnyNode;       // the node of the first page, kAnyNode when the kernel does not say
+      bool bound = false;        // the kernel took the memory policy
+   };
+
+   namespace detail {
+      // "0-3,8,10-11" as in /sys/devices/system/node, calls 'add(id)' for each
+      template <typename Add>
+      bool parse_list(const std::string& path, Add add) {
+         FILE* file = std::fopen(path.c_str(), "r");
+         if (nullptr == file) {
+            return false;
+         }
+         bool any = false;
+         int first = 0;
+         while (1 == std::fscanf(file, "%d", &first)) {
+            int last = first;
+            if (1 != std::fscanf(file, "-%d", &last)) {
+               last = first;
+            }
+            for (int id = first; id <= last; ++id) {
+               add(id);
+            }
+            any = true;
+            if (',' != std::fgetc(file)) {
+               break;
+            }
+         }
+         std::fclose(file);
+         return any;
+      }
+
+      inline size_t page_size() {
+#if defined(__linux__)
+         static const size_t kPageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+         return kPageSize;
+#else
+         return 4096;
+#endif
+      }
+
+      inline size_t round_to_pages(size_t bytes) {
+         const size_t page = page_size();
+         return (std::max(bytes, size_t{1}) + page - 1) / page * page;
+      }
+
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_get_mempolicy)
+      // from <numaif.h>, not included so that libnuma is not needed
+      const int kMpolPreferred = 1;
+      const unsigned long kMpolFNode = 1 << 0;
+      const unsigned long kMpolFAddr = 1 << 1;
+      const int kMaxNodes = 1024;
+      const size_t kBitsPerWord = 8 * sizeof(unsigned long);
+
+      inline bool mbind_preferred(void* memory, size_t bytes, int node) {
+         unsigned long mask[kMaxNodes / kBitsPerWord] = {};
+         mask[node / kBitsPerWord] = 1UL << (node % kBitsPerWord);
+         // the kernel reads maxnode - 1 bits
+         return 0 == syscall(SYS_mbind, memory, bytes, kMpolPreferred, mask, kMaxNodes + 1, 0);
+      }
+
+      inline int node_of(const void* address) {
+         int node = kAnyNode;
+         if (0 != syscall(SYS_get_mempolicy, &node, nullptr, 0, address, kMpolFNode | kMpolFAddr)) {
+            return kAnyNode;
+         }
+         return node;
+      }
+#else
+      const int kMaxNodes = 1;
+      inline bool mbind_preferred(void*, size_t, int) { return false; }
+      inline int node_of(const void*) { return kAnyNode; }
+#endif
+   }  // namespace detail
+
+   // nodes with memory, 1 when unknown
+   inline int node_count() {
+      static const int kNodes = [] {
+         int highest = 0;
+         detail::parse_list("/sys/devices/system/node/online", [&](int node) { highest = std::max(highest, node); });
+         return highest + 1;
+      }();
+      return kNodes;
+   }
+
+   // the node the calling thread runs on right now, 0 when unknown
+   inline int this_node() {
+#if defined(__linux__) && defined(SYS_getcpu)
+      unsigned cpu = 0;
+      unsigned node = 0;
+      if (0 == syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+         return static_cast<int>(node);
+      }
+#endif
+      return 0;
+   }
+
+   // the node of 'cpu', 0 when unknown
+   inline int node_of_cpu(int cpu) {
+      for (int node = 0; node < node_count(); ++node) {
+         bool found = false;
+         detail::parse_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist",
+                            [&](int id) { found = found || id == cpu; });
+         if (found) {
+            return node;
+         }
+      }
+      return 0;
+   }
+
+   // the node of the page at 'address', the page is faulted in. kAnyNode when unknown
+   inline int node_of(const void* address) { return detail::node_of(address); }
+
+   // runs the calling thread on the cpus of 'node' only, so what it touches first is put there.
+   // False, and nothing changed, when the node's cpus are not known
+   inline bool pin_this_thread(int node) {
+#if defined(__linux__)
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      const bool known = detail::parse_list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist",
+                                            [&](int cpu) { CPU_SET(cpu, &cpus); });
+      return known && 0 == sched_setaffinity(0, sizeof(cpus), &cpus);
+#else
+      (void)node;
+      return false;
+#endif
+   }
+
+   // whole pages, preferred on 'node' unless it is kAnyNode. Throws std::bad_alloc
+   inline void* allocate(size_t bytes, int node, placement* report) {
+      bytes = detail::round_to_pages(bytes);
+#if defined(__linux__)
+      void* memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (MAP_FAILED == memory) {
+         throw std::bad_alloc();
+      }
+#else
+      void* memory = ::operator new(bytes, std::align_val_t{detail::page_size()});
+#endif
+      placement where;
+      where.requested = node;
+      // one node: nothing to choose from
+      if (node >= 0 && node < detail::kMaxNodes && node_count() > 1) {
+         where.bound = detail::mbind_preferred(memory, bytes, node);
+      }
+      where.node = (node_count() > 1) ? node_of(memory) : 0;
+      if (nullptr != report) {
+         *report = where;
+      }
+      return memory;
+   }
+
+   inline void deallocate(void* memory, size_t bytes) {
+      bytes = detail::round_to_pages(bytes);
+#if defined(__linux__)
+      munmap(memory, bytes);
+#else
+      ::operator delete(memory, std::align_val_t{detail::page_size()});
+#endif
+   }
+
+   // storage for circular_fifo, lock_queue or any std container. Each allocation is whole pages of
+   // its own, meant for a few long lived rings. Copies share the placement report
+   template <typename T>
+   class allocator {
+     public:
+      using value_type = T;
+
+      explicit allocator(int node = kAnyNode) :
+          node_(node),
+          report_(std::make_shared<numa::placement>()) {
+         report_->requested = node;
+      }
+      template <typename U>
+      allocator(const allocator<U>& other) :
+          node_(other.node_),
+          report_(other.report_) {}
+
+      T* allocate(size_t n) { return static_cast<T*>(numa::allocate(n * sizeof(T), node_, report_.get())); }
+      void deallocate(T* p, size_t n) { numa::deallocate(p, n * sizeof(T)); }
+
+      int node() const { return node_; }
+      // of the latest allocation
+      numa::placement placement() const { return *report_; }
+
+      // any allocator can give the pages back
+      template <typename U>
+      bool operator==(const allocator<U>&) const { return true; }
+      template <typename U>
+      bool operator!=(const allocator<U>&) const { return false; }
+
+     private:
+      template <typename U>
+      friend class allocator;
+
+      int node_;
+      std::shared_ptr<numa::placement> report_;
+   };
+}  // namespace numa
+
+namespace spsc {
+   namespace numa {
+      // ring storage on a chosen node: circular_fifo<T> queue(size, ::numa::allocator<T>(node))
+      template <typename Element>
+      using circular_fifo = spsc::circular_fifo<Element, ::numa::allocator<Element>>;
+   }  // namespace numa
+}  // namespace spsc
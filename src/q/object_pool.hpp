@@ -0,0 +1,126 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Object pool with a return path, for payloads that travel through a SPSC queue
+*
+*    pool::object_pool<Payload> payloads(1024);
+*    auto payload = payloads.acquire();              // producer thread
+*    sender.push(payload);
+*    ...
+*    receiver.pop(payload);                          // consumer thread
+*    payload.reset();                                // goes back to the producer through the return ring
+*
+* All objects are created with the pool. 'acquire' hands them out as a 'pooled_ptr', a std::unique_ptr
+* whose deleter gives the object back. Objects released on the consumer thread go back to the producer
+* through a circular_fifo, objects released on the producer thread go straight to its free list.
+* In steady state there is no heap allocation on either thread.
+*
+* IMPORTANT:
+* 1. ONE producer thread calls 'acquire'. The objects can be released on that thread and on ONE other thread.
+* 2. 'acquire' returns an empty pooled_ptr when all objects are in use.
+* 3. A returned object is handed out again as is, it is not reset or re-constructed.
+* 4. The pool must outlive all the objects it has handed out.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "q/spsc_circular_fifo.hpp"
+
+namespace pool {
+   template <typename T>
+   class object_pool;
+
+   template <typename T>
+   struct recycler {
+      object_pool<T>* pool_ = nullptr;
+      void operator()(T* object) const { pool_->recycle(object); }
+   };
+
+   template <typename T>
+   using pooled_ptr = std::unique_ptr<T, recycler<T>>;
+
+   template <typename T>
+   class object_pool {
+     public:
+      explicit object_pool(const size_t count);
+      virtual ~object_pool() = default;
+
+      pooled_ptr<T> acquire();    // producer thread
+      void recycle(T* object);    // called by the pooled_ptr deleter
+      size_t capacity() const { return kCount; }
+      size_t available() const;   // snapshot
+
+     private:
+      object_pool(const object_pool&) = delete;
+      object_pool& operator=(const object_pool&) = delete;
+
+      const size_t kCount;
+      std::unique_ptr<T[]> storage_;
+      std::vector<T*> free_;              // producer thread only
+      spsc::circular_fifo<T*> returned_;  // consumer -> producer, big enough for all objects
+      std::atomic<size_t> free_count_;    // size of 'free_', for 'available()'
+      std::atomic<std::thread::id> owner_;
+   };
+
+   template <typename T>
+   object_pool<T>::object_pool(const size_t count) :
+       kCount(count),
+       storage_(new T[count]),
+       returned_(count),
+       free_count_(count),
+       owner_(std::thread::id()) {
+      free_.reserve(count);
+      for (size_t i = count; i > 0; --i) {
+         free_.push_back(&storage_[i - 1]);
+      }
+   }
+
+   template <typename T>
+   pooled_ptr<T> object_pool<T>::acquire() {
+      const auto self = std::this_thread::get_id();
+      if (owner_.load(std::memory_order_relaxed) != self) {
+         owner_.store(self, std::memory_order_relaxed);
+      }
+
+      if (free_.empty()) {
+         T* object = nullptr;
+         while (returned_.pop(object)) {
+            free_.push_back(object);
+         }
+         if (free_.empty()) {
+            return pooled_ptr<T>(nullptr, recycler<T>{this});  // all in use
+         }
+      }
+      T* object = free_.back();
+      free_.pop_back();
+      free_count_.store(free_.size(), std::memory_order_relaxed);
+      return pooled_ptr<T>(object, recycler<T>{this});
+   }
+
+   template <typename T>
+   void object_pool<T>::recycle(T* object) {
+      if (std::this_thread::get_id() == owner_.load(std::memory_order_relaxed)) {
+         free_.push_back(object);
+         free_count_.store(free_.size(), std::memory_order_relaxed);
+      } else {
+         returned_.push(object);  // cannot be full, it has room for all objects
+      }
+   }
+
+   template <typename T>
+   size_t object_pool<T>::available() const {
+      return free_count_.load(std::memory_order_relaxed) + returned_.size();
+   }
+}  // namespace pool
@@ -0,0 +1,244 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Pipeline ring - a disruptor-style multi-stage pipeline over ONE preallocated ring
+*
+* A chain like decode -> enrich -> persist built from spsc queues moves every item
+* once per hop. With the pipeline ring the item is moved once into a ring slot by
+* the producer and then stays there. Each stage owns a sequence cursor and processes
+* the slots that the stage(s) it depends on have already released.
+*
+* IMPORTANT:
+* 1. One producer thread. One thread per stage.
+* 2. The topology is set up with 'add_stage' BEFORE any producer or stage thread is started.
+* 3. A stage with no dependencies consumes directly after the producer.
+* 4. Stages that depend on the same stage run in parallel on the same slots (diamond topology).
+*    A stage may only modify the parts of the item that no parallel stage is reading.
+* 5. The producer can only reuse a slot when ALL stages have released it.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace pipeline {
+   // Per stage counters. 'processed' gives the throughput when sampled over time,
+   // 'lag' is how many published items the stage has not yet released.
+   struct stage_stats {
+      uint64_t processed;
+      uint64_t lag;
+      uint64_t batches;
+   };
+
+   template <typename Element>
+   class ring {
+     public:
+      using stage_id = size_t;
+
+      explicit ring(const size_t size);
+      virtual ~ring() = default;
+
+      // setup: call before producer and stage threads are started. A dependency must be a stage that
+      // was added before, else std::invalid_argument
+      stage_id add_stage(std::initializer_list<stage_id> dependencies = {});
+
+      // producer API
+      bool push(Element& item);
+
+      // stage API: 'handler(Element&)' is called for every slot the stage is allowed to process.
+      // The cursor is released once per batch. Returns number of processed items
+      template <typename Handler>
+      size_t process(const stage_id stage, Handler&& handler, const size_t max_batch = std::numeric_limits<size_t>::max());
+
+      stage_stats stats(const stage_id stage) const;
+      size_t stages() const { return stages_.size(); }
+
+      bool empty() const;
+      bool full() const;
+      size_t capacity() const;
+      size_t capacity_free() const;
+      size_t usage() const;
+      size_t size() const;
+      bool lock_free() const;
+
+     private:
+      typedef char cache_line[64];
+      struct stage_state {
+         cache_line pad_begin_;
+         std::atomic<uint64_t> cursor_{0};  // sequence of the next slot to process
+         std::atomic<uint64_t> batches_{0};
+         uint64_t cached_available_{0};  // only touched by the stage's own thread
+         std::vector<stage_id> dependencies_;
+         cache_line pad_end_;
+      };
+
+      uint64_t available(const stage_state& state) const;
+      uint64_t gating_sequence() const;
+
+      const size_t kSize;
+      cache_line pad_storage_;
+      std::vector<Element> array_;
+      std::vector<std::unique_ptr<stage_state>> stages_;
+      std::vector<stage_id> gating_;  // stages that no other stage depends on
+
+      cache_line pad_published_;
+      std::atomic<uint64_t> published_;
+      uint64_t cached_gate_;  // only touched by the producer
+      cache_line pad_end_;
+   };
+
+   template <typename Element>
+   ring<Element>::ring(const size_t size) :
+       kSize(size),
+       array_(size),
+       published_(0),
+       cached_gate_(0) {
+   }
+
+   template <typename Element>
+   typename ring<Element>::stage_id ring<Element>::add_stage(std::initializer_list<stage_id> dependencies) {
+      const stage_id id = stages_.size();
+      for (auto dependency : dependencies) {
+         if (dependency >= id) {
+            throw std::invalid_argument("pipeline::ring::add_stage: dependency " + std::to_string(dependency) +
+                                        " is not an existing stage");
+         }
+      }
+      auto state = std::make_unique<stage_state>();
+      for (auto dependency : dependencies) {
+         state->dependencies_.push_back(dependency);
+         gating_.erase(std::remove(gating_.begin(), gating_.end(), dependency), gating_.end());
+      }
+      stages_.push_back(std::move(state));
+      gating_.push_back(id);
+      return id;
+   }
+
+   // the producer can only claim a slot that all terminal stages have released
+   template <typename Element>
+   bool ring<Element>::push(Element& item) {
+      const uint64_t sequence = published_.load(std::memory_order_relaxed);
+      if (sequence - cached_gate_ >= kSize) {
+         cached_gate_ = gating_sequence();
+         if (sequence - cached_gate_ >= kSize) {
+            return false;  // full ring
+         }
+      }
+
+      array_[sequence % kSize] = std::move(item);
+      published_.store(sequence + 1, std::memory_order_release);
+      return true;
+   }
+
+   template <typename Element>
+   template <typename Handler>
+   size_t ring<Element>::process(const stage_id stage, Handler&& handler, const size_t max_batch) {
+      stage_state& state = *stages_[stage];
+      const uint64_t begin = state.cursor_.load(std::memory_order_relaxed);
+      if (begin == state.cached_available_) {
+         state.cached_available_ = available(state);
+         if (begin == state.cached_available_) {
+            return 0;  // nothing released by the stage(s) we depend on
+         }
+      }
+
+      const uint64_t end = begin + std::min<uint64_t>(state.cached_available_ - begin, max_batch);
+      for (uint64_t sequence = begin; sequence != end; ++sequence) {
+         handler(array_[sequence % kSize]);
+      }
+      state.cursor_.store(end, std::memory_order_release);
+      state.batches_.store(state.batches_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      return static_cast<size_t>(end - begin);
+   }
+
+   template <typename Element>
+   stage_stats ring<Element>::stats(const stage_id stage) const {
+      const stage_state& state = *stages_[stage];
+      const uint64_t processed = state.cursor_.load(std::memory_order_acquire);
+      const uint64_t published = published_.load(std::memory_order_acquire);
+      return {processed, published - processed, state.batches_.load(std::memory_order_relaxed)};
+   }
+
+   // private
+   template <typename Element>
+   uint64_t ring<Element>::available(const stage_state& state) const {
+      if (state.dependencies_.empty()) {
+         return published_.load(std::memory_order_acquire);
+      }
+
+      uint64_t minimum = std::numeric_limits<uint64_t>::max();
+      for (auto dependency : state.dependencies_) {
+         minimum = std::min(minimum, stages_[dependency]->cursor_.load(std::memory_order_acquire));
+      }
+      return minimum;
+   }
+
+   template <typename Element>
+   uint64_t ring<Element>::gating_sequence() const {
+      if (gating_.empty()) {
+         return published_.load(std::memory_order_relaxed);  // no stages: nothing holds the slots
+      }
+
+      uint64_t minimum = std::numeric_limits<uint64_t>::max();
+      for (auto stage : gating_) {
+         minimum = std::min(minimum, stages_[stage]->cursor_.load(std::memory_order_acquire));
+      }
+      return minimum;
+   }
+
+   // snapshot with acceptance that this comparison is not atomic
+   template <typename Element>
+   bool ring<Element>::empty() const {
+      return (size() == 0);
+   }
+
+   template <typename Element>
+   bool ring<Element>::full() const {
+      return (size() >= kSize);
+   }
+
+   template <typename Element>
+   size_t ring<Element>::capacity() const {
+      return kSize;
+   }
+
+   template <typename Element>
+   size_t ring<Element>::capacity_free() const {
+      return (kSize - size());
+   }
+
+   // percent usage
+   template <typename Element>
+   size_t ring<Element>::usage() const {
+      return (100 * size() / kSize);
+   }
+
+   // items that are published but not yet released by all stages
+   template <typename Element>
+   size_t ring<Element>::size() const {
+      const uint64_t gate = gating_sequence();
+      const uint64_t published = published_.load(std::memory_order_acquire);
+      return static_cast<size_t>(published > gate ? published - gate : 0);
+   }
+
+   template <typename Element>
+   bool ring<Element>::lock_free() const {
+      return std::atomic<uint64_t>{}.is_lock_free();
+   }
+}  // namespace pipeline
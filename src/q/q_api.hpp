@@ -18,6 +18,8 @@
 #include <chrono>
 #include <memory>
 #include <tuple>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
 #include "q/sfinae_receiver.hpp"
 #include "q/sfinae_sender.hpp"
 
@@ -65,6 +67,7 @@ namespace queue_api {
       size_t size() const { return _qref.size(); }
       bool lock_free() const { return _qref.lock_free(); }
       size_t usage() const { return _qref.usage(); }
+      bool closed() const { return _qref.closed(); }
 
       std::shared_ptr<QType> _q;
       QType& _qref;
@@ -79,13 +82,20 @@ namespace queue_api {
       virtual ~Sender() = default;
 
       template <typename Element>
-      bool push(Element& item) { return Base<QType>::_qref.push(item); }
+      auto push(Element& item) { return Base<QType>::_qref.push(item); }
 
       // if wait_and_push isn't supported by the queue, then sfinae_sender supplies a default
       template <typename Element>
-      bool wait_and_push(Element& item, const std::chrono::milliseconds wait_ms) {
+      auto wait_and_push(Element& item, const std::chrono::milliseconds wait_ms) {
          return sfinae_sender::wait_and_push(Base<QType>::_qref, item, wait_ms);
       }
+
+      // up to 'count' items with one call, only for queues that support 'push_n'
+      template <typename Element>
+      size_t push_n(Element* items, size_t count) { return Base<QType>::_qref.push_n(items, count); }
+
+      // no more pushes, only for queues that support 'close'. See q/closable.hpp
+      void close() { Base<QType>::_qref.close(); }
    };
 
    // struct with : pop() + base Queue API
@@ -97,13 +107,34 @@ namespace queue_api {
       virtual ~Receiver() = default;
 
       template <typename Element>
-      bool pop(Element& item) { return Base<QType>::_qref.pop(item); }
+      auto pop(Element& item) { return Base<QType>::_qref.pop(item); }
 
       // if wait_and_pop isn't supported by the queue, then sfinae_receiver supplies a default
       template <typename Element>
-      bool wait_and_pop(Element& item, const std::chrono::milliseconds wait_ms) {
+      auto wait_and_pop(Element& item, const std::chrono::milliseconds wait_ms) {
          return sfinae_receiver::wait_and_pop(Base<QType>::_qref, item, wait_ms);
       }
+
+      // all waiting items with one call, only for queues that support 'pop_all'
+      template <typename Container>
+      size_t pop_all(Container& out) { return Base<QType>::_qref.pop_all(out); }
+
+      // up to 'max' items with one call, only for queues that support 'pop_n'
+      template <typename Element>
+      size_t pop_n(Element* items, size_t max) { return Base<QType>::_qref.pop_n(items, max); }
+
+      // the waiting items in place and 'consume' to release them, only for queues that support 'peek'
+      auto peek() const { return Base<QType>::_qref.peek(); }
+      void consume(size_t count) { Base<QType>::_qref.consume(count); }
+
+      // range-for until the queue is closed and drained. See q/closable.hpp
+      template <typename Q = QType>
+      receive_iterator<Receiver, typename Q::value_type> begin() { return receive_iterator<Receiver, typename Q::value_type>(this); }
+      template <typename Q = QType>
+      receive_iterator<Receiver, typename Q::value_type> end() { return receive_iterator<Receiver, typename Q::value_type>(); }
+
+      // empty to non-empty notifications, only for queues that support 'attach'. See q/readiness.hpp
+      void attach(readiness::observer* observer) { Base<QType>::_qref.attach(observer); }
    };
 
    template <typename QType, typename... Args>
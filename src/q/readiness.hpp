@@ -0,0 +1,28 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at https://github.com/KjellKod/Q
+*/
+
+#pragma once
+
+namespace readiness {
+   // A queue with an attached observer calls 'notify()' from the producer side when the
+   // queue goes from empty to non-empty. While the consumer lags behind no notification is done,
+   // so a busy queue is not paying for one wakeup per push.
+   //
+   // An observer that waits for readiness must issue a std::atomic_thread_fence(std::memory_order_seq_cst)
+   // AFTER it has started to listen for 'notify()' and BEFORE it checks the queue for emptiness.
+   //
+   // Only one observer can be attached to a queue. The observer must outlive the attachment.
+   struct observer {
+      virtual ~observer() = default;
+      virtual void notify() = 0;
+   };
+}  // namespace readiness
@@ -0,0 +1,125 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Readiness file descriptor: lets a queue consumer sleep in epoll/poll/select together with sockets
+*
+* Linux uses an eventfd, other POSIX platforms use a non-blocking pipe.
+* The descriptor becomes readable when an attached queue goes from empty to non-empty.
+* Signaling is coalesced twice: the queue only notifies on the empty -> non-empty transition,
+* and the notifier only writes to the descriptor once until the consumer calls 'clear()'.
+*
+* Consumer loop:
+*    epoll_wait(...)            // fd() is readable
+*    notifier.clear();          // BEFORE draining
+*    while (receiver.pop(item)) { ... }
+*
+* IMPORTANT:
+* 1. Works with circular_fifo, lock_queue and the MPSC round-robin Receiver (see 'attach' in each of them)
+* 2. The notifier must outlive the attachment. Detach with 'attach(nullptr)'
+*/
+
+#pragma once
+
+#if !defined(_WIN32)
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdint>
+#include "q/readiness.hpp"
+
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+namespace readiness {
+   class fd_notifier : public observer {
+     public:
+      fd_notifier();
+      virtual ~fd_notifier();
+
+      int fd() const { return read_fd_; }  // register this one for read events
+      bool valid() const { return read_fd_ >= 0; }
+
+      // producer side, called by the queue
+      void notify() override;
+
+      // consumer side, call before draining the queue(s)
+      void clear();
+
+      // number of times the descriptor was actually written to
+      uint64_t signals() const { return signals_.load(std::memory_order_relaxed); }
+
+     private:
+      fd_notifier(const fd_notifier&) = delete;
+      fd_notifier& operator=(const fd_notifier&) = delete;
+
+      int read_fd_;
+      int write_fd_;
+      std::atomic<bool> signaled_;
+      std::atomic<uint64_t> signals_;
+   };
+
+   inline fd_notifier::fd_notifier() :
+       read_fd_(-1),
+       write_fd_(-1),
+       signaled_(false),
+       signals_(0) {
+#if defined(__linux__)
+      read_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      write_fd_ = read_fd_;
+#else
+      int fds[2];
+      if (0 == ::pipe(fds)) {
+         for (int fd : fds) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+         }
+         read_fd_ = fds[0];
+         write_fd_ = fds[1];
+      }
+#endif
+   }
+
+   inline fd_notifier::~fd_notifier() {
+      if (read_fd_ >= 0) {
+         ::close(read_fd_);
+      }
+      if (write_fd_ >= 0 && write_fd_ != read_fd_) {
+         ::close(write_fd_);
+      }
+   }
+
+   inline void fd_notifier::notify() {
+      // pairs with the fence in 'clear()': either we see the cleared flag
+      // or the consumer sees what was pushed before this notification
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (signaled_.load(std::memory_order_relaxed) || signaled_.exchange(true)) {
+         return;  // already readable, the consumer has not yet cleared it
+      }
+
+      signals_.fetch_add(1, std::memory_order_relaxed);
+      uint64_t one = 1;
+      ssize_t written = ::write(write_fd_, &one, sizeof(one));
+      (void)written;  // full pipe/eventfd is still readable
+   }
+
+   // the descriptor is emptied BEFORE the flag is cleared. The opposite order could lose the
+   // readable state while the flag says it's set, after which every notify is skipped
+   inline void fd_notifier::clear() {
+      uint64_t value = 0;
+      while (::read(read_fd_, &value, sizeof(value)) > 0) {
+      }
+      signaled_.store(false);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+   }
+}  // namespace readiness
+
+#endif  // !defined(_WIN32)
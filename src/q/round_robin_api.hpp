@@ -23,10 +23,16 @@
 *    that is not congested. The Consumer pops each queue in a round-robin manner.
 * 5. If there is no item available in the 'current' queue the POP(..) attempt will go to the next
 *    queue until at most all queues are visited once.
+*
+* 'static_API<QType, QueueUsageApi, N>' is the same with the number of queues known at compile time:
+* the queues are kept in a std::array, a visit of all queues is unrolled and a power of two N wraps
+* with a mask. 'CreateLanes<QType, N>(args...)' makes the N queues.
 */
 
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <utility>
 #include <vector>
 #include "q/q_api.hpp"
@@ -51,6 +57,7 @@ namespace round_robin {
       size_t usage() const;
       size_t size() const;
       bool lock_free() const;
+      bool closed() const;  // all queues are closed
 
      protected:
       std::vector<QueueUsageApi> queues_;
@@ -130,4 +137,131 @@ namespace round_robin {
       }
       return lockless;
    }
+
+   template <typename QType, typename QueueUsageApi>
+   bool API<QType, QueueUsageApi>::closed() const {
+      bool isclosed = true;
+      for (const auto& r : queues_) {
+         isclosed = isclosed && r.closed();
+      }
+      return isclosed;
+   }
+
+   // N queues known at compile time
+   template <typename QType, typename QueueUsageApi, size_t N>
+   class static_API {
+      static_assert(N > 0, "at least one queue");
+
+     public:
+      static const size_t kQueues = N;
+
+      static_API(std::array<QueueUsageApi, N> queues) :
+          queues_(std::move(queues)),
+          current_(0) {}
+      virtual ~static_API() = default;
+
+      static size_t increment(size_t idx) { return wrap(idx + 1); }
+      bool empty() const {
+         return all([](const QueueUsageApi& q) { return q.empty(); });
+      }
+      bool full() const {
+         return all([](const QueueUsageApi& q) { return q.full(); });
+      }
+      size_t capacity() const {
+         return sum([](const QueueUsageApi& q) { return q.capacity(); });
+      }
+      size_t capacity_free() const {
+         return sum([](const QueueUsageApi& q) { return q.capacity_free(); });
+      }
+      size_t usage() const {
+         return sum([](const QueueUsageApi& q) { return q.usage(); }) / N;
+      }
+      size_t size() const {
+         return sum([](const QueueUsageApi& q) { return q.size(); });
+      }
+      bool lock_free() const {
+         return all([](const QueueUsageApi& q) { return q.lock_free(); });
+      }
+      bool closed() const {  // all queues are closed
+         return all([](const QueueUsageApi& q) { return q.closed(); });
+      }
+
+     protected:
+      // 'idx' is at most 2N - 2: one subtraction, or a mask for a power of two
+      static size_t wrap(size_t idx) {
+         if constexpr (0 == (N & (N - 1))) {
+            return idx & (N - 1);
+         } else {
+            return idx < N ? idx : idx - N;
+         }
+      }
+
+      // 'attempt(queue)' on queue current_, current_ + 1, ... until it succeeds, at most N times.
+      // The loop is unrolled. Afterwards 'current_' is the queue after the one that succeeded.
+      // Returns the status of the last attempt, 'closed' if all queues are closed
+      template <typename Attempt>
+      queue_api::status visit(Attempt attempt) {
+         return visit(attempt, std::make_index_sequence<N>{});
+      }
+
+      std::array<QueueUsageApi, N> queues_;
+      size_t current_;
+
+     private:
+      template <typename Attempt, size_t... I>
+      queue_api::status visit(Attempt& attempt, std::index_sequence<I...>) {
+         size_t closed = 0;
+         const size_t start = current_;
+         const bool done = (try_one(attempt, wrap(start + I), closed) || ...);
+         if (done) {
+            return queue_api::status::code::success;
+         }
+         return (closed == N) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+      }
+
+      template <typename Attempt>
+      bool try_one(Attempt& attempt, const size_t idx, size_t& closed) {
+         auto result = attempt(queues_[idx]);
+         if (result) {
+            current_ = wrap(idx + 1);
+            return true;
+         }
+         closed += queue_api::is_closed(result) ? 1 : 0;
+         return false;
+      }
+
+      template <typename Check>
+      bool all(Check check) const {
+         bool every = true;
+         for (const auto& q : queues_) {
+            every = every && check(q);
+         }
+         return every;
+      }
+
+      template <typename Count>
+      size_t sum(Count count) const {
+         size_t total = 0;
+         for (const auto& q : queues_) {
+            total += count(q);
+         }
+         return total;
+      }
+   };
+
+   namespace detail {
+      template <typename QType, size_t... I, typename... Args>
+      auto create_lanes(std::index_sequence<I...>, const Args&... args) {
+         constexpr size_t N = sizeof...(I);
+         std::array<std::pair<queue_api::Sender<QType>, queue_api::Receiver<QType>>, N> lanes{{((void)I, queue_api::CreateQueue<QType>(args...))...}};
+         return std::make_pair(std::array<queue_api::Sender<QType>, N>{{lanes[I].first...}},
+                               std::array<queue_api::Receiver<QType>, N>{{lanes[I].second...}});
+      }
+   }  // namespace detail
+
+   // N queues of QType, each made with 'args'. The senders first, the receivers second
+   template <typename QType, size_t N, typename... Args>
+   std::pair<std::array<queue_api::Sender<QType>, N>, std::array<queue_api::Receiver<QType>, N>> CreateLanes(const Args&... args) {
+      return detail::create_lanes<QType>(std::make_index_sequence<N>{}, args...);
+   }
 }  // namespace round_robin
@@ -0,0 +1,296 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Request/reply channel between two threads, built on two spsc::circular_fifo
+*
+*    auto channel = rpc::CreateChannel<Request, Reply>(16);   // max 16 calls in flight
+*    auto client = std::get<rpc::index::client>(channel);
+*    auto server = std::get<rpc::index::server>(channel);
+*
+*    // client thread                          // server thread
+*    auto reply = client.call(request);         server.serve([](Request& r) { return Reply{...}; });
+*    Reply value = reply.get();
+*
+* Every call takes a reply slot, the slot index is the correlation id. The server echoes the id with
+* the reply and the client puts the reply into its slot, so replies can be picked up in any order.
+* Slots and ring buffers are allocated when the channel is created, a call does not allocate.
+*
+* IMPORTANT:
+* 1. ONE client thread and ONE server thread. The client thread owns the futures.
+* 2. 'call' returns an invalid future when all slots are in use, the request is then left untouched.
+* 3. 'get' busy waits for the reply, it only starts to yield the CPU after a while. Meant for pinned
+*    threads where latency matters more than CPU.
+* 4. A future that is destroyed without 'get' gives back its slot once the reply has arrived.
+* 5. Request and Reply must be default constructible and movable.
+* 6. A future points to its channel with a raw pointer, it must not outlive the Client and Server.
+*    An invalid future (default constructed, moved from or already taken) is never ready.
+*/
+
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "q/spsc_circular_fifo.hpp"
+
+namespace rpc {
+   namespace index {
+      const int client = 0;
+      const int server = 1;
+   }  // namespace index
+
+   template <typename Request, typename Reply>
+   class channel {
+     public:
+      explicit channel(const size_t slots);
+      virtual ~channel() = default;
+
+      // client side
+      bool send(Request& request, uint32_t& id);
+      bool ready(const uint32_t id);
+      void take(const uint32_t id, Reply& reply);
+      void release(const uint32_t id);
+      size_t in_flight() const { return slots_.size() - free_.size(); }
+      size_t capacity() const { return slots_.size(); }
+
+      // server side
+      template <typename Handler>
+      size_t serve(Handler&& handler, const size_t max_requests);
+
+     private:
+      channel(const channel&) = delete;
+      channel& operator=(const channel&) = delete;
+      void collect();
+
+      struct request_envelope {
+         uint32_t id;
+         Request request;
+      };
+      struct reply_envelope {
+         uint32_t id;
+         Reply reply;
+      };
+      enum class state : uint8_t { free, pending, done, abandoned };
+      struct slot {
+         state state_ = state::free;
+         Reply reply_;
+      };
+
+      // at most 'slots' calls are in flight, so neither ring can be full when pushed to
+      spsc::circular_fifo<request_envelope> requests_;
+      spsc::circular_fifo<reply_envelope> replies_;
+
+      // client thread only
+      std::vector<slot> slots_;
+      std::vector<uint32_t> free_;
+      request_envelope outgoing_;
+      reply_envelope incoming_;
+
+      // server thread only
+      request_envelope served_;
+      reply_envelope answer_;
+   };
+
+   template <typename Request, typename Reply>
+   class future {
+     public:
+      future() = default;
+      future(channel<Request, Reply>* ch, const uint32_t id) :
+          channel_(ch),
+          id_(id) {}
+      future(future&& other) :
+          channel_(other.channel_),
+          id_(other.id_) { other.channel_ = nullptr; }
+      future& operator=(future&& other) {
+         if (this != &other) {
+            abandon();
+            channel_ = other.channel_;
+            id_ = other.id_;
+            other.channel_ = nullptr;
+         }
+         return *this;
+      }
+      virtual ~future() { abandon(); }
+
+      bool valid() const { return channel_ != nullptr; }
+      bool ready() { return channel_ != nullptr && channel_->ready(id_); }
+      uint32_t id() const { return id_; }
+
+      // false if the reply has not arrived yet, or the future is invalid
+      bool try_get(Reply& reply) {
+         if (!ready()) {
+            return false;
+         }
+         channel_->take(id_, reply);
+         channel_ = nullptr;
+         return true;
+      }
+
+      // the future must be valid
+      Reply get() {
+         assert(valid() && "rpc::future::get on an invalid future");
+         Reply reply;
+         size_t spins = 0;
+         while (!try_get(reply)) {
+            if (++spins > kSpinsBeforeYield) {
+               std::this_thread::yield();  // the server might share our core
+            }
+         }
+         return reply;
+      }
+
+     private:
+      future(const future&) = delete;
+      future& operator=(const future&) = delete;
+      void abandon() {
+         if (channel_) {
+            channel_->release(id_);
+            channel_ = nullptr;
+         }
+      }
+
+      static const size_t kSpinsBeforeYield = 4096;
+      channel<Request, Reply>* channel_ = nullptr;
+      uint32_t id_ = 0;
+   };
+
+   template <typename Request, typename Reply>
+   class Client {
+     public:
+      explicit Client(std::shared_ptr<channel<Request, Reply>> ch) :
+          channel_(ch) {}
+
+      future<Request, Reply> call(Request& request) {
+         uint32_t id = 0;
+         if (!channel_->send(request, id)) {
+            return future<Request, Reply>();
+         }
+         return future<Request, Reply>(channel_.get(), id);
+      }
+
+      size_t in_flight() const { return channel_->in_flight(); }
+      size_t capacity() const { return channel_->capacity(); }
+
+     private:
+      std::shared_ptr<channel<Request, Reply>> channel_;
+   };
+
+   template <typename Request, typename Reply>
+   class Server {
+     public:
+      explicit Server(std::shared_ptr<channel<Request, Reply>> ch) :
+          channel_(ch) {}
+
+      // handles the waiting requests with 'Reply handler(Request&)'. Returns the number handled
+      template <typename Handler>
+      size_t serve(Handler&& handler, const size_t max_requests = std::numeric_limits<size_t>::max()) {
+         return channel_->serve(std::forward<Handler>(handler), max_requests);
+      }
+
+     private:
+      std::shared_ptr<channel<Request, Reply>> channel_;
+   };
+
+   template <typename Request, typename Reply>
+   std::pair<Client<Request, Reply>, Server<Request, Reply>> CreateChannel(const size_t slots) {
+      auto ch = std::make_shared<channel<Request, Reply>>(slots);
+      return std::make_pair(Client<Request, Reply>(ch), Server<Request, Reply>(ch));
+   }
+
+   template <typename Request, typename Reply>
+   channel<Request, Reply>::channel(const size_t slots) :
+       requests_(slots),
+       replies_(slots),
+       slots_(slots),
+       outgoing_(),
+       incoming_(),
+       served_(),
+       answer_() {
+      free_.reserve(slots);
+      for (size_t i = slots; i > 0; --i) {
+         free_.push_back(static_cast<uint32_t>(i - 1));
+      }
+   }
+
+   template <typename Request, typename Reply>
+   bool channel<Request, Reply>::send(Request& request, uint32_t& id) {
+      if (free_.empty()) {
+         collect();  // abandoned slots come back when their reply arrives
+      }
+      if (free_.empty()) {
+         return false;  // all slots in use
+      }
+      id = free_.back();
+      outgoing_.id = id;
+      outgoing_.request = std::move(request);
+      requests_.push(outgoing_);
+      free_.pop_back();
+      slots_[id].state_ = state::pending;
+      return true;
+   }
+
+   // moves the arrived replies into their slots
+   template <typename Request, typename Reply>
+   void channel<Request, Reply>::collect() {
+      while (replies_.pop(incoming_)) {
+         slot& s = slots_[incoming_.id];
+         if (s.state_ == state::abandoned) {
+            s.state_ = state::free;
+            free_.push_back(incoming_.id);
+         } else {
+            s.reply_ = std::move(incoming_.reply);
+            s.state_ = state::done;
+         }
+      }
+   }
+
+   template <typename Request, typename Reply>
+   bool channel<Request, Reply>::ready(const uint32_t id) {
+      if (slots_[id].state_ != state::done) {
+         collect();
+      }
+      return slots_[id].state_ == state::done;
+   }
+
+   template <typename Request, typename Reply>
+   void channel<Request, Reply>::take(const uint32_t id, Reply& reply) {
+      reply = std::move(slots_[id].reply_);
+      slots_[id].state_ = state::free;
+      free_.push_back(id);
+   }
+
+   template <typename Request, typename Reply>
+   void channel<Request, Reply>::release(const uint32_t id) {
+      slot& s = slots_[id];
+      if (s.state_ == state::pending) {
+         s.state_ = state::abandoned;  // freed when the reply arrives
+      } else {
+         s.state_ = state::free;
+         free_.push_back(id);
+      }
+   }
+
+   template <typename Request, typename Reply>
+   template <typename Handler>
+   size_t channel<Request, Reply>::serve(Handler&& handler, const size_t max_requests) {
+      size_t handled = 0;
+      while (handled < max_requests && requests_.pop(served_)) {
+         answer_.id = served_.id;
+         answer_.reply = handler(served_.request);
+         replies_.push(answer_);
+         ++handled;
+      }
+      return handled;
+   }
+}  // namespace rpc
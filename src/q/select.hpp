@@ -0,0 +1,188 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Select: block on many receivers of different queue types at the same time
+*
+* Instead of one polling loop per queue, all receivers in a select share ONE wakeup signal.
+* The producers notify the signal when their queue goes from empty to non-empty (see q/readiness.hpp)
+*
+* IMPORTANT:
+* 1. The select is used by ONE thread, the consumer thread of all its receivers.
+* 2. A queue can only be part of one select at the time. The select detaches from the queues when destroyed,
+*    producers must not push to the queues while the select is destroyed.
+* 3. 'wait' returns the id of the highest priority source that is ready. With equal priority the
+*    source that was added first wins. The caller pops from that source.
+* 4. A timer source is ready when its period has passed. It is re-armed when 'wait' or 'poll' returns it.
+* 5. A closed queue is ready, like a closed channel in Go. Its pop returns the closed status once
+*    drained, see q/closable.hpp. Only queues that support 'close' can be added.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <vector>
+#include "q/q_api.hpp"
+#include "q/readiness.hpp"
+
+namespace selector {
+   // One wakeup mechanism for many queues. The mutex is only touched when someone is waiting
+   class signal : public readiness::observer {
+     public:
+      signal() :
+          epoch_(0),
+          waiters_(0) {}
+      virtual ~signal() = default;
+
+      void notify() override {
+         epoch_.fetch_add(1, std::memory_order_seq_cst);
+         if (waiters_.load(std::memory_order_seq_cst) > 0) {
+            { std::lock_guard<std::mutex> lock(m_); }
+            cond_.notify_all();
+         }
+      }
+
+      // waiting protocol: enter() -> epoch() -> check the queues -> wait_until(epoch, ...) -> leave()
+      void enter() { waiters_.fetch_add(1, std::memory_order_seq_cst); }
+      void leave() { waiters_.fetch_sub(1, std::memory_order_seq_cst); }
+      uint64_t epoch() const {
+         const auto current = epoch_.load(std::memory_order_seq_cst);
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         return current;
+      }
+
+      // returns false on timeout
+      bool wait_until(const uint64_t epoch, const std::chrono::steady_clock::time_point timeout) {
+         std::unique_lock<std::mutex> lock(m_);
+         return cond_.wait_until(lock, timeout, [&] { return epoch_.load(std::memory_order_seq_cst) != epoch; });
+      }
+
+     private:
+      std::atomic<uint64_t> epoch_;
+      std::atomic<int> waiters_;
+      std::mutex m_;
+      std::condition_variable cond_;
+   };
+
+   class select {
+     public:
+      static constexpr size_t kTimeout = std::numeric_limits<size_t>::max();
+      using clock = std::chrono::steady_clock;
+
+      select() = default;
+      virtual ~select();
+
+      // returns the id of the source, ids are given in order 0, 1, 2 ...
+      template <typename QType>
+      size_t add(queue_api::Receiver<QType> receiver, const int priority = 0);
+      size_t add_timer(const std::chrono::milliseconds period, const int priority = 0);
+
+      // id of the ready source, or kTimeout
+      size_t poll();
+      size_t wait(const std::chrono::milliseconds max_wait);
+      size_t size() const { return sources_.size(); }
+
+     private:
+      select(const select&) = delete;
+      select& operator=(const select&) = delete;
+
+      struct source {
+         size_t id;
+         int priority;
+         std::function<bool()> ready;
+         std::function<void()> detach;
+         std::chrono::milliseconds period;
+         clock::time_point due;
+      };
+      size_t insert(source item);
+      clock::time_point next_due(clock::time_point timeout) const;
+
+      std::vector<source> sources_;  // sorted on priority, highest first
+      size_t next_id_ = 0;
+      signal signal_;
+   };
+
+   inline select::~select() {
+      for (auto& s : sources_) {
+         if (s.detach) {
+            s.detach();
+         }
+      }
+   }
+
+   template <typename QType>
+   size_t select::add(queue_api::Receiver<QType> receiver, const int priority) {
+      receiver.attach(&signal_);
+      source item{next_id_, priority,
+                  [receiver] { return !receiver.empty() || receiver.closed(); },
+                  [receiver]() mutable { receiver.attach(nullptr); },
+                  std::chrono::milliseconds(0), clock::time_point::max()};
+      return insert(std::move(item));
+   }
+
+   inline size_t select::add_timer(const std::chrono::milliseconds period, const int priority) {
+      source item{next_id_, priority, nullptr, nullptr, period, clock::now() + period};
+      return insert(std::move(item));
+   }
+
+   inline size_t select::insert(source item) {
+      auto position = std::upper_bound(sources_.begin(), sources_.end(), item.priority,
+                                       [](int priority, const source& s) { return priority > s.priority; });
+      sources_.insert(position, std::move(item));
+      return next_id_++;
+   }
+
+   inline size_t select::poll() {
+      const auto now = clock::now();
+      for (auto& s : sources_) {
+         if (s.ready) {
+            if (s.ready()) {
+               return s.id;
+            }
+         } else if (now >= s.due) {
+            // the next period after 'now', the periods that were missed fire only once
+            const auto missed = (s.period.count() > 0) ? (now - s.due) / s.period : 0;
+            s.due += s.period * (missed + 1);
+            return s.id;
+         }
+      }
+      return kTimeout;
+   }
+
+   inline select::clock::time_point select::next_due(clock::time_point timeout) const {
+      for (const auto& s : sources_) {
+         if (!s.ready) {
+            timeout = std::min(timeout, s.due);
+         }
+      }
+      return timeout;
+   }
+
+   inline size_t select::wait(const std::chrono::milliseconds max_wait) {
+      const auto timeout = clock::now() + max_wait;
+      signal_.enter();
+      size_t id = kTimeout;
+      for (;;) {
+         const auto epoch = signal_.epoch();
+         id = poll();
+         if (id != kTimeout || clock::now() >= timeout) {
+            break;
+         }
+         signal_.wait_until(epoch, next_due(timeout));
+      }
+      signal_.leave();
+      return id;
+   }
+}  // namespace selector
@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <thread>
+#include "q/closable.hpp"
 
 namespace sfinae_sender {
    // SFINAE: Substitution Failure Is Not An Error
@@ -9,19 +10,21 @@ namespace sfinae_sender {
    // 1. If 'wait_and_pop' exists in the queue it uses that
    // 2. If only 'pop' exists it implements 'wait_and_pop' expected
    // -- FYI: The wait is set to increments of 100 ns
+   // -- A closed queue returns at once, see q/closable.hpp
    template <typename T, typename Element>
-   bool wrapper(T& t, Element& e, std::chrono::milliseconds max_wait) {
+   auto wrapper(T& t, Element& e, std::chrono::milliseconds max_wait) -> decltype(t.push(e)) {
       using milliseconds = std::chrono::milliseconds;
       using clock = std::chrono::steady_clock;
       using namespace std::chrono_literals;
       auto t1 = clock::now();
-      bool result = false;
-      while (!(result = t.push(e))) {
+      auto result = t.push(e);
+      while (!result && !queue_api::is_closed(result)) {
          std::this_thread::sleep_for(100ns);
          auto elapsed_ms = std::chrono::duration_cast<milliseconds>(clock::now() - t1);
          if (elapsed_ms > max_wait) {
             return result;
          }
+         result = t.push(e);
       }
       return result;
    }
@@ -37,7 +40,7 @@ namespace sfinae_sender {
    }
 
    template <typename T, typename Element>
-   int wait_and_push(T& t, Element& e, std::chrono::milliseconds ms) {
+   auto wait_and_push(T& t, Element& e, std::chrono::milliseconds ms) {
       // SFINAE magic happens with the '0'.
       // For the matching call the '0' will be typed to int.
       // For non-matching call it will be typed to long
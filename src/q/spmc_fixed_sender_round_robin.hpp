@@ -21,13 +21,20 @@
 *    SPSC queue that is not congested. The Consumer pops each queue in a round-robin manner.
 * 5. If there is no item available in the 'current' queue the POP(..) attempt will go to the next
 *    queue until at most all queues are visited once.
+* 6. 'close' closes all the queues. Each consumer drains its own queue and then sees it as closed.
+*
+* 'spmc::static_size::round_robin::Sender<QType, N>': the same with N consumers known at compile
+* time, see 'round_robin::static_API'
 */
 
 #pragma once
 
+#include <array>
 #include <chrono>
+#include <cstddef>
 #include <utility>
 #include <vector>
+#include "q/closable.hpp"
 #include "q/q_api.hpp"
 #include "q/round_robin_api.hpp"
 #include "q/spsc_circular_fifo.hpp"
@@ -56,7 +63,10 @@ namespace spmc {
             virtual ~Sender() = default;
 
             template <typename Element>
-            bool push(Element& item);
+            queue_api::status push(Element& item);
+
+            // no more pushes to any of the queues. See q/closable.hpp
+            void close();
          };
 
          template <typename QType>
@@ -65,17 +75,55 @@ namespace spmc {
 
          template <typename QType>
          template <typename Element>
-         bool Sender<QType>::push(Element& item) {
-            bool result = false;
+         queue_api::status Sender<QType>::push(Element& item) {
             const size_t loop_check = QueueAPI::queues_.size();
 
+            size_t closed = 0;
             size_t count = 0;
-            while (!result && count++ < loop_check) {
-               result = QueueAPI::queues_[QueueAPI::current_].push(item);
+            while (count++ < loop_check) {
+               auto result = QueueAPI::queues_[QueueAPI::current_].push(item);
                QueueAPI::current_ = QueueAPI::increment(QueueAPI::current_);
+               if (result) {
+                  return queue_api::status::code::success;
+               }
+               closed += queue_api::is_closed(result) ? 1 : 0;
+            }
+            return (closed == loop_check) ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+
+         template <typename QType>
+         void Sender<QType>::close() {
+            for (auto& q : QueueAPI::queues_) {
+               q.close();
             }
-            return result;
          }
       }  // namespace round_robin
    }     // namespace fixed_size
+
+   namespace static_size {
+      namespace round_robin {
+         // As spmc::fixed_size::round_robin::Sender for N consumers known at compile time
+         template <typename QType, size_t N>
+         class Sender : public ::round_robin::static_API<QType, queue_api::Sender<QType>, N> {
+           public:
+            using QueueAPI = ::round_robin::static_API<QType, queue_api::Sender<QType>, N>;
+
+            Sender(std::array<queue_api::Sender<QType>, N> senders) :
+                QueueAPI(std::move(senders)) {}
+            virtual ~Sender() = default;
+
+            template <typename Element>
+            queue_api::status push(Element& item) {
+               return QueueAPI::visit([&item](queue_api::Sender<QType>& q) { return q.push(item); });
+            }
+
+            // no more pushes to any of the queues. See q/closable.hpp
+            void close() {
+               for (auto& q : QueueAPI::queues_) {
+                  q.close();
+               }
+            }
+         };
+      }  // namespace round_robin
+   }     // namespace static_size
 }  // namespace spmc
@@ -22,3 +22,4 @@
 #pragma once
 
 #include "q/spsc_circular_fifo.hpp"
+#include "q/spsc_pointer_fifo.hpp"
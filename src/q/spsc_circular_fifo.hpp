@@ -24,27 +24,61 @@
 
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <cstring>
+#include <memory>
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#endif
 #include <thread>
+#include <type_traits>
 #include <vector>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
 
 namespace spsc {
+   // contiguous items in the ring, C++17 has no std::span
    template <typename Element>
+   struct span {
+      Element* data = nullptr;
+      size_t size = 0;
+      Element* begin() const { return data; }
+      Element* end() const { return data + size; }
+      Element& operator[](size_t idx) const { return data[idx]; }
+   };
+
+   // the waiting items: 'first' runs to the end of the ring, 'second' continues from its start
+   template <typename Element>
+   struct read_view {
+      span<const Element> first;
+      span<const Element> second;
+      size_t size() const { return first.size + second.size; }
+      bool empty() const { return 0 == size(); }
+   };
+
+   // Allocator: where the ring storage lives, see 'spsc::pmr::circular_fifo' below for a memory_resource
+   template <typename Element, typename Allocator = std::allocator<Element>>
    class circular_fifo {
      public:
-      explicit circular_fifo(const size_t size) :
+      using value_type = Element;
+      using allocator_type = Allocator;
+
+      explicit circular_fifo(const size_t size, const Allocator& allocator = Allocator()) :
           kSize(size),
           kCapacity(kSize + 1),
-          array_(kCapacity),
+          array_(kCapacity, allocator),
           tail_(0),
+          observer_(nullptr),
+          closed_(false),
           head_(0) {
       }
 
       virtual ~circular_fifo() {}
 
-      bool push(Element& item);
-      bool pop(Element& item);
+      queue_api::status push(Element& item);
+      queue_api::status pop(Element& item);
       bool empty() const;
       bool full() const;
       size_t capacity() const;
@@ -55,86 +89,234 @@ namespace spsc {
       size_t tail() const { return tail_.load(); }
       size_t head() const { return head_.load(); }
 
+      // bulk transfers: up to 'count' items, returns how many. At most two contiguous copies, split
+      // where the ring wraps, and a memcpy when Element is trivially copyable. Items are moved from
+      size_t push_n(Element* items, size_t count);
+      size_t pop_n(Element* items, size_t max);
+
+      // consumer side: the waiting items in place, no copy. They stay valid until 'consume(count)'
+      // gives the first 'count' of them back to the producer
+      read_view<Element> peek() const;
+      void consume(size_t count);
+
+      // consumer side: see q/readiness.hpp. Attach before the producer starts, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // producer side: no more pushes. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
      private:
       typedef char cache_line[64];
       size_t increment(size_t idx) const { return (idx + 1) % kCapacity; }
+      size_t readable(size_t head) const;
+      static void copy_range(Element* to, Element* from, size_t count);
+      void notify_if_drained(readiness::observer* observer, size_t pushed) const;
       const size_t kSize;
       const size_t kCapacity;
 
       cache_line pad_storage_;
-      std::vector<Element> array_;
+      std::vector<Element, Allocator> array_;
 
       cache_line padtail_;
       std::atomic<size_t> tail_;
+      std::atomic<readiness::observer*> observer_;  // read by the producer, set once by the consumer
+      std::atomic<bool> closed_;                    // set once by the producer
       cache_line padhead_;
       std::atomic<size_t> head_;  // head(output) index
       cache_line padend_;
    };
 
-   template <typename Element>
-   bool circular_fifo<Element>::push(Element& item) {
+   template <typename Element, typename Allocator>
+   queue_api::status circular_fifo<Element, Allocator>::push(Element& item) {
+      if (closed_.load(std::memory_order_relaxed)) {
+         return queue_api::status::code::closed;
+      }
+
       const auto currenttail_ = tail_.load(std::memory_order_relaxed);
       const auto nexttail_ = increment(currenttail_);
 
       if (nexttail_ != head_.load(std::memory_order_acquire)) {
          array_[currenttail_] = std::move(item);
          tail_.store(nexttail_, std::memory_order_release);
-         return true;
+         auto observer = observer_.load(std::memory_order_acquire);
+         if (observer) {
+            notify_if_drained(observer, currenttail_);
+         }
+         return queue_api::status::code::success;
       }
 
-      return false;  // full queue
+      return queue_api::status::code::unavailable;  // full queue
+   }
+
+   // The pushes before the close are visible to a consumer that sees 'closed_'.
+   // A sleeping consumer is always woken, the queue might be empty already
+   template <typename Element, typename Allocator>
+   void circular_fifo<Element, Allocator>::close() {
+      closed_.store(true, std::memory_order_release);
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         observer->notify();
+      }
+   }
+
+   // The consumer has popped everything up to the item we just pushed: it might
+   // have seen the queue as empty and be waiting for us.
+   // The fence pairs with the observer's fence before its emptiness check
+   template <typename Element, typename Allocator>
+   void circular_fifo<Element, Allocator>::notify_if_drained(readiness::observer* observer, size_t pushed) const {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (head_.load(std::memory_order_relaxed) == pushed) {
+         observer->notify();
+      }
    }
 
    // Pop by Consumer can only update the head (load with relaxed, store with release)
    //     the tail must be accessed with at least aquire
-   template <typename Element>
-   bool circular_fifo<Element>::pop(Element& item) {
+   template <typename Element, typename Allocator>
+   queue_api::status circular_fifo<Element, Allocator>::pop(Element& item) {
       const auto currenthead_ = head_.load(std::memory_order_relaxed);
       if (currenthead_ == tail_.load(std::memory_order_acquire)) {
-         return false;  // empty queue
+         const bool closed = closed_.load(std::memory_order_acquire);
+         if (!closed && nullptr == observer_.load(std::memory_order_relaxed)) {
+            return queue_api::status::code::unavailable;  // empty queue
+         }
+
+         // with an observer the consumer goes to sleep after a failed pop. Pairs with
+         // the fence in 'notify_if_drained' so that either the producer notifies or we see the item.
+         // When closed: an item pushed just before the close is seen by the re-check
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (currenthead_ == tail_.load(std::memory_order_acquire)) {
+            return closed ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
       }
 
       item = std::move(array_[currenthead_]);
       head_.store(increment(currenthead_), std::memory_order_release);
-      return true;
+      return queue_api::status::code::success;
    }
 
-   template <typename Element>
-   bool circular_fifo<Element>::empty() const {
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::push_n(Element* items, size_t count) {
+      if (closed_.load(std::memory_order_relaxed)) {
+         return 0;
+      }
+
+      const auto currenttail_ = tail_.load(std::memory_order_relaxed);
+      const auto free = (head_.load(std::memory_order_acquire) + kCapacity - currenttail_ - 1) % kCapacity;
+      const size_t pushed = std::min(count, free);
+      if (0 == pushed) {
+         return 0;  // full queue
+      }
+      const size_t to_end = std::min(pushed, kCapacity - currenttail_);
+      copy_range(&array_[currenttail_], items, to_end);
+      copy_range(&array_[0], items + to_end, pushed - to_end);
+      tail_.store((currenttail_ + pushed) % kCapacity, std::memory_order_release);
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         notify_if_drained(observer, currenttail_);
+      }
+      return pushed;
+   }
+
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::pop_n(Element* items, size_t max) {
+      const auto currenthead_ = head_.load(std::memory_order_relaxed);
+      const size_t popped = std::min(max, readable(currenthead_));
+      const size_t to_end = std::min(popped, kCapacity - currenthead_);
+      copy_range(items, &array_[currenthead_], to_end);
+      copy_range(items + to_end, &array_[0], popped - to_end);
+      if (popped) {
+         head_.store((currenthead_ + popped) % kCapacity, std::memory_order_release);
+      }
+      return popped;
+   }
+
+   template <typename Element, typename Allocator>
+   read_view<Element> circular_fifo<Element, Allocator>::peek() const {
+      const auto currenthead_ = head_.load(std::memory_order_relaxed);
+      const size_t waiting = readable(currenthead_);
+      const size_t to_end = std::min(waiting, kCapacity - currenthead_);
+      read_view<Element> view;
+      view.first = {array_.data() + currenthead_, to_end};
+      view.second = {array_.data(), waiting - to_end};
+      return view;
+   }
+
+   template <typename Element, typename Allocator>
+   void circular_fifo<Element, Allocator>::consume(size_t count) {
+      const auto currenthead_ = head_.load(std::memory_order_relaxed);
+      head_.store((currenthead_ + count) % kCapacity, std::memory_order_release);
+   }
+
+   // how many items the consumer can take from 'head'. With an observer or when closed an empty
+   // queue is checked again after the fence, as in 'pop'
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::readable(size_t head) const {
+      size_t waiting = (tail_.load(std::memory_order_acquire) + kCapacity - head) % kCapacity;
+      if (0 == waiting && (closed_.load(std::memory_order_acquire) || observer_.load(std::memory_order_relaxed))) {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         waiting = (tail_.load(std::memory_order_acquire) + kCapacity - head) % kCapacity;
+      }
+      return waiting;
+   }
+
+   template <typename Element, typename Allocator>
+   void circular_fifo<Element, Allocator>::copy_range(Element* to, Element* from, size_t count) {
+      if constexpr (std::is_trivially_copyable<Element>::value) {
+         if (count) {
+            std::memcpy(static_cast<void*>(to), static_cast<const void*>(from), count * sizeof(Element));
+         }
+      } else {
+         std::move(from, from + count, to);
+      }
+   }
+
+   template <typename Element, typename Allocator>
+   bool circular_fifo<Element, Allocator>::empty() const {
       // snapshot with acceptance of that this comparison operation is not atomic
       return (head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed));
    }
 
    // snapshot with acceptance that this comparison is not atomic
-   template <typename Element>
-   bool circular_fifo<Element>::full() const {
+   template <typename Element, typename Allocator>
+   bool circular_fifo<Element, Allocator>::full() const {
       const auto nexttail_ = increment(tail_.load(std::memory_order_relaxed));  // aquire, we dont know who call
       return (nexttail_ == head_.load(std::memory_order_relaxed));
    }
 
-   template <typename Element>
-   bool circular_fifo<Element>::lock_free() const {
+   template <typename Element, typename Allocator>
+   bool circular_fifo<Element, Allocator>::lock_free() const {
       return std::atomic<size_t>{}.is_lock_free();
    }
 
-   template <typename Element>
-   size_t circular_fifo<Element>::size() const {
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::size() const {
       return ((tail_.load() - head_.load() + kCapacity) % kCapacity);
    }
 
-   template <typename Element>
-   size_t circular_fifo<Element>::capacity_free() const {
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::capacity_free() const {
       return (kCapacity - size() - 1);
    }
 
-   template <typename Element>
-   size_t circular_fifo<Element>::capacity() const {
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::capacity() const {
       return kSize;
    }
 
    // percent usage
-   template <typename Element>
-   size_t circular_fifo<Element>::usage() const {
+   template <typename Element, typename Allocator>
+   size_t circular_fifo<Element, Allocator>::usage() const {
       return (100 * size() / kSize);
    }
+
+#if __has_include(<memory_resource>)
+   namespace pmr {
+      // storage from a std::pmr::memory_resource: circular_fifo<T> queue(size, &resource)
+      template <typename Element>
+      using circular_fifo = spsc::circular_fifo<Element, std::pmr::polymorphic_allocator<Element>>;
+   }  // namespace pmr
+#endif
 }  // namespace spsc
@@ -0,0 +1,251 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* SPSC for pointers, where the slot itself says whether it is full or empty: nullptr is empty.
+* Ref: Giacomoni et al, "FastForward for efficient pipeline parallelism" (PPoPP 2008)
+*      Wang et al, "B-Queue: efficient and practical queuing for fast core-to-core communication" (2013)
+*
+* spsc::circular_fifo compares its own index with the other side's index on every push and pop, so
+* the head and tail cache lines move between the cores all the time. Here the producer and the
+* consumer keep their index to themselves and only meet in the slots.
+*
+* The producer looks ahead: when it runs out of slots it knows are free it checks the slot 'batch'
+* positions ahead. The consumer frees slots in order, so if that one is free all slots before it are
+* too, and the producer then pushes 'batch' items without reading a slot the consumer writes.
+* When the look-ahead slot is taken the batch is halved, down to the next slot (B-Queue backtracking).
+*
+*    auto queue = queue_api::CreateQueue<spsc::pointer_fifo<std::unique_ptr<Message>>>(1024);
+*    auto queue = queue_api::CreateQueue<spsc::pointer_fifo<Message*>>(1024);
+*
+* Same API as spsc::circular_fifo: push, pop, attach (q/readiness.hpp), close (q/closable.hpp)
+*
+* IMPORTANT:
+* 1. Elements are 'T*' or 'std::unique_ptr<T, D>' with a default constructible 'D'. nullptr can
+*    not be pushed, it is what marks a free slot.
+* 2. 'size()', 'empty()' and 'full()' are snapshots of indexes the owning sides update with relaxed
+*    stores. They are never read on the push/pop path.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include "q/closable.hpp"
+#include "q/readiness.hpp"
+
+namespace spsc {
+   namespace pointer {
+      // how a queue element goes in and out of a raw slot pointer
+      template <typename Pointer>
+      struct slot_traits;
+
+      template <typename T>
+      struct slot_traits<T*> {
+         using raw = T*;
+         static raw get(T* const& item) { return item; }
+         static raw release(T*& item) { return item; }
+         static void reset(T*& item, raw value) { item = value; }
+         static void destroy(raw) {}  // not owned by the queue
+      };
+
+      template <typename T, typename D>
+      struct slot_traits<std::unique_ptr<T, D>> {
+         using raw = typename std::unique_ptr<T, D>::pointer;
+         static raw get(const std::unique_ptr<T, D>& item) { return item.get(); }
+         static raw release(std::unique_ptr<T, D>& item) { return item.release(); }
+         static void reset(std::unique_ptr<T, D>& item, raw value) { item.reset(value); }
+         static void destroy(raw value) { D()(value); }
+      };
+   }  // namespace pointer
+
+   template <typename Pointer>
+   class pointer_fifo {
+      using traits = pointer::slot_traits<Pointer>;
+      using raw = typename traits::raw;
+
+     public:
+      using value_type = Pointer;
+      static const size_t kMaxLookAhead = 64;
+
+      // size 0: std::invalid_argument
+      explicit pointer_fifo(const size_t size);
+      virtual ~pointer_fifo();
+
+      queue_api::status push(Pointer& item);
+      queue_api::status pop(Pointer& item);
+      bool empty() const { return 0 == size(); }
+      bool full() const { return size() >= kSize; }
+      size_t capacity() const { return kSize; }
+      size_t capacity_free() const { return kSize - size(); }
+      size_t usage() const { return (100 * size() / kSize); }
+      size_t size() const;
+      bool lock_free() const { return std::atomic<raw>{}.is_lock_free(); }
+
+      // consumer side: see q/readiness.hpp. Attach before the producer starts, nullptr detaches
+      void attach(readiness::observer* observer) { observer_.store(observer, std::memory_order_release); }
+
+      // producer side: no more pushes. See q/closable.hpp
+      void close();
+      bool closed() const { return closed_.load(std::memory_order_acquire); }
+
+     private:
+      pointer_fifo(const pointer_fifo&) = delete;
+      pointer_fifo& operator=(const pointer_fifo&) = delete;
+
+      size_t increment(size_t idx) const { return (++idx == kSize) ? 0 : idx; }
+      bool look_ahead();
+      void notify_if_drained(readiness::observer* observer) const;
+      static size_t checked_size(const size_t size);
+
+      const size_t kSize;
+      const size_t kLookAhead;
+      std::unique_ptr<std::atomic<raw>[]> slots_;
+
+      // producer: the next slot, the slots known to be free from there, and the total pushed
+      alignas(64) size_t tail_;
+      size_t free_ahead_;
+      std::atomic<size_t> pushed_;
+      std::atomic<bool> closed_;
+      // consumer: the next slot and the total popped
+      alignas(64) size_t head_;
+      std::atomic<size_t> popped_;
+      std::atomic<readiness::observer*> observer_;  // read by the producer, set once by the consumer
+      char pad_[64];
+   };
+
+   template <typename Pointer>
+   pointer_fifo<Pointer>::pointer_fifo(const size_t size) :
+       kSize(checked_size(size)),
+       kLookAhead(std::max(size_t{1}, std::min(size_t{kMaxLookAhead}, size / 4))),
+       slots_(new std::atomic<raw>[size]),
+       tail_(0),
+       free_ahead_(0),
+       pushed_(0),
+       closed_(false),
+       head_(0),
+       popped_(0),
+       observer_(nullptr) {
+      for (size_t i = 0; i < kSize; ++i) {
+         slots_[i].store(nullptr, std::memory_order_relaxed);
+      }
+   }
+
+   // a slot index is taken modulo the size
+   template <typename Pointer>
+   size_t pointer_fifo<Pointer>::checked_size(const size_t size) {
+      if (0 == size) {
+         throw std::invalid_argument("spsc::pointer_fifo: size 0, at least one slot is needed");
+      }
+      return size;
+   }
+
+   template <typename Pointer>
+   pointer_fifo<Pointer>::~pointer_fifo() {
+      for (size_t i = 0; i < kSize; ++i) {
+         raw left = slots_[i].load(std::memory_order_relaxed);
+         if (left) {
+            traits::destroy(left);
+         }
+      }
+   }
+
+   template <typename Pointer>
+   queue_api::status pointer_fifo<Pointer>::push(Pointer& item) {
+      assert(nullptr != traits::get(item) && "nullptr marks a free slot, it can not be pushed");
+      if (closed_.load(std::memory_order_relaxed)) {
+         return queue_api::status::code::closed;
+      }
+      if (0 == free_ahead_ && !look_ahead()) {
+         return queue_api::status::code::unavailable;  // full queue
+      }
+
+      slots_[tail_].store(traits::release(item), std::memory_order_release);
+      tail_ = increment(tail_);
+      --free_ahead_;
+      const size_t pushed = pushed_.load(std::memory_order_relaxed);
+      pushed_.store(pushed + 1, std::memory_order_relaxed);
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         notify_if_drained(observer);
+      }
+      return queue_api::status::code::success;
+   }
+
+   // the consumer frees the slots in order: a free slot 'batch' ahead means the ones before it are free
+   template <typename Pointer>
+   bool pointer_fifo<Pointer>::look_ahead() {
+      for (size_t batch = kLookAhead; batch > 0; batch /= 2) {
+         if (nullptr == slots_[(tail_ + batch - 1) % kSize].load(std::memory_order_acquire)) {
+            free_ahead_ = batch;
+            return true;
+         }
+      }
+      return false;
+   }
+
+   // As spsc::circular_fifo::pop, with the emptiness in the slot instead of in the producer's index
+   template <typename Pointer>
+   queue_api::status pointer_fifo<Pointer>::pop(Pointer& item) {
+      raw oldest = slots_[head_].load(std::memory_order_acquire);
+      if (nullptr == oldest) {
+         const bool closed = closed_.load(std::memory_order_acquire);
+         if (!closed && nullptr == observer_.load(std::memory_order_relaxed)) {
+            return queue_api::status::code::unavailable;  // empty queue
+         }
+
+         // pairs with the fence in 'notify_if_drained'. When closed: a push before the close is seen here
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         oldest = slots_[head_].load(std::memory_order_acquire);
+         if (nullptr == oldest) {
+            return closed ? queue_api::status::code::closed : queue_api::status::code::unavailable;
+         }
+      }
+
+      traits::reset(item, oldest);
+      slots_[head_].store(nullptr, std::memory_order_release);
+      head_ = increment(head_);
+      const size_t popped = popped_.load(std::memory_order_relaxed);
+      popped_.store(popped + 1, std::memory_order_relaxed);
+      return queue_api::status::code::success;
+   }
+
+   template <typename Pointer>
+   size_t pointer_fifo<Pointer>::size() const {
+      const size_t popped = popped_.load();
+      const size_t pushed = pushed_.load();
+      return pushed > popped ? pushed - popped : 0;
+   }
+
+   // The pushes before the close are visible to a consumer that sees 'closed_'.
+   // A sleeping consumer is always woken, the queue might be empty already
+   template <typename Pointer>
+   void pointer_fifo<Pointer>::close() {
+      closed_.store(true, std::memory_order_release);
+      auto observer = observer_.load(std::memory_order_acquire);
+      if (observer) {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         observer->notify();
+      }
+   }
+
+   // The consumer has popped everything up to the item we just pushed: it might be waiting for us.
+   // The consumer's counter is only read here, with an observer attached
+   template <typename Pointer>
+   void pointer_fifo<Pointer>::notify_if_drained(readiness::observer* observer) const {
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (popped_.load(std::memory_order_relaxed) + 1 == pushed_.load(std::memory_order_relaxed)) {
+         observer->notify();
+      }
+   }
+}  // namespace spsc
@@ -0,0 +1,313 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Work stealing thread pool
+*
+* - Each worker has a local Chase-Lev deque (q/work_stealing_deque.hpp). Tasks submitted from a worker
+*   go to its own deque and are run LIFO (newest first) by that worker, which keeps recursive work cache hot.
+* - Tasks submitted from any other thread go to a global injection queue (mpmc::lock_queue).
+* - An idle worker first checks its own deque, then the injection queue, then steals
+*   the OLDEST task from another worker.
+* - 'submit' returns a lightweight future. Waiting on it from a worker runs other tasks
+*   meanwhile, so fork-join recursion does not deadlock the pool.
+*
+* IMPORTANT:
+* 1. The destructor runs all submitted tasks before the workers exit.
+* 2. Exceptions thrown by a task are re-thrown from 'future::get()'
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "q/mpmc_lock_queue.hpp"
+#include "q/thread_exit_notifier.hpp"
+#include "q/work_stealing_deque.hpp"
+
+namespace executor {
+   class work_stealing_pool;
+
+   struct task {
+      virtual ~task() = default;
+      virtual void run() = 0;
+   };
+
+   // The result is stored in the task itself: one allocation per submit
+   template <typename R>
+   class task_state : public task {
+     public:
+      using storage = typename std::conditional<std::is_void<R>::value, bool, R>::type;
+
+      bool ready() const { return ready_.load(std::memory_order_acquire); }
+      R get() {
+         if (error_) {
+            std::rethrow_exception(error_);
+         }
+         if constexpr (!std::is_void<R>::value) {
+            return std::move(*value_);
+         }
+      }
+
+     protected:
+      void set_error(std::exception_ptr error) { error_ = error; }
+      void set_ready() { ready_.store(true, std::memory_order_release); }
+      std::optional<storage> value_;  // set when the task returns, R needs no default constructor
+
+     private:
+      std::exception_ptr error_;
+      std::atomic<bool> ready_{false};
+   };
+
+   template <typename R, typename F>
+   class task_impl : public task_state<R> {
+     public:
+      explicit task_impl(F&& f) :
+          f_(std::move(f)) {}
+
+      // the pool's reference is released when the task has run
+      std::shared_ptr<task_impl> self_;
+
+      void run() override {
+         try {
+            if constexpr (std::is_void<R>::value) {
+               f_();
+            } else {
+               this->value_.emplace(f_());
+            }
+         } catch (...) {
+            this->set_error(std::current_exception());
+         }
+         this->set_ready();
+         self_.reset();
+      }
+
+     private:
+      F f_;
+   };
+
+   template <typename R>
+   class future {
+     public:
+      future() = default;
+      future(std::shared_ptr<task_state<R>> state, work_stealing_pool* pool) :
+          state_(std::move(state)),
+          pool_(pool) {}
+
+      bool valid() const { return state_ != nullptr; }
+      bool ready() const { return state_->ready(); }
+      void wait() const;  // helps the pool while waiting
+      R get() {
+         wait();
+         return state_->get();
+      }
+
+     private:
+      std::shared_ptr<task_state<R>> state_;
+      work_stealing_pool* pool_ = nullptr;
+   };
+
+   class work_stealing_pool {
+     public:
+      explicit work_stealing_pool(const size_t workers = std::thread::hardware_concurrency());
+      virtual ~work_stealing_pool();
+
+      template <typename F>
+      auto submit(F&& f) -> future<typename std::invoke_result<typename std::decay<F>::type>::type>;
+
+      // runs one pending task on the calling thread, false if none was found
+      bool run_one();
+
+      size_t workers() const { return workers_.size(); }
+      size_t live_workers() const { return live_workers_.load(); }
+
+     private:
+      work_stealing_pool(const work_stealing_pool&) = delete;
+      work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+      struct worker {
+         work_stealing::deque<task*> deque_;
+         std::atomic<bool> active_{true};
+         std::thread thread_;
+      };
+
+      void enqueue(task* t);
+      bool steal(const size_t thief, task*& t);
+      bool find(const size_t self, task*& t);
+      void work(const size_t index);
+      void on_worker_exit(const size_t index);
+      static size_t& current_index();
+      static work_stealing_pool*& current_pool();
+      static const size_t kNotWorker = static_cast<size_t>(-1);
+
+      std::vector<std::unique_ptr<worker>> workers_;
+      mpmc::lock_queue<task*> injection_;
+      std::atomic<size_t> pending_;
+      std::atomic<size_t> sleepers_;
+      std::atomic<size_t> live_workers_;
+      std::atomic<bool> stop_;
+      std::mutex sleep_m_;
+      std::condition_variable sleep_cond_;
+   };
+
+   template <typename R>
+   void future<R>::wait() const {
+      size_t idle = 0;
+      while (!state_->ready()) {
+         if (pool_->run_one()) {
+            idle = 0;
+         } else if (++idle < 64) {
+            std::this_thread::yield();
+         } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+         }
+      }
+   }
+
+   inline work_stealing_pool::work_stealing_pool(const size_t workers) :
+       injection_(-1),
+       pending_(0),
+       sleepers_(0),
+       live_workers_(0),
+       stop_(false) {
+      const size_t count = (workers == 0) ? 1 : workers;
+      for (size_t i = 0; i < count; ++i) {
+         workers_.push_back(std::make_unique<worker>());
+      }
+      live_workers_.store(count);
+      for (size_t i = 0; i < count; ++i) {
+         workers_[i]->thread_ = std::thread(&work_stealing_pool::work, this, i);
+      }
+   }
+
+   inline work_stealing_pool::~work_stealing_pool() {
+      stop_.store(true);
+      {
+         std::lock_guard<std::mutex> lock(sleep_m_);
+      }
+      sleep_cond_.notify_all();
+      for (auto& w : workers_) {
+         w->thread_.join();
+      }
+   }
+
+   template <typename F>
+   auto work_stealing_pool::submit(F&& f) -> future<typename std::invoke_result<typename std::decay<F>::type>::type> {
+      using Function = typename std::decay<F>::type;
+      using R = typename std::invoke_result<Function>::type;
+      auto state = std::make_shared<task_impl<R, Function>>(Function(std::forward<F>(f)));
+      state->self_ = state;
+      enqueue(state.get());
+      return future<R>(std::move(state), this);
+   }
+
+   inline size_t& work_stealing_pool::current_index() {
+      thread_local size_t index = kNotWorker;
+      return index;
+   }
+
+   inline work_stealing_pool*& work_stealing_pool::current_pool() {
+      thread_local work_stealing_pool* pool = nullptr;
+      return pool;
+   }
+
+   inline void work_stealing_pool::enqueue(task* t) {
+      const size_t index = current_index();
+      if (current_pool() == this && index != kNotWorker) {
+         workers_[index]->deque_.push(t);
+      } else {
+         injection_.push(t);
+      }
+
+      // pairs with the sleeping worker that increments 'sleepers_' before it checks 'pending_'
+      pending_.fetch_add(1);
+      if (sleepers_.load() > 0) {
+         {
+            std::lock_guard<std::mutex> lock(sleep_m_);
+         }
+         sleep_cond_.notify_one();
+      }
+   }
+
+   inline bool work_stealing_pool::steal(const size_t thief, task*& t) {
+      const size_t count = workers_.size();
+      const size_t start = (thief == kNotWorker) ? 0 : thief + 1;
+      for (size_t i = 0; i < count; ++i) {
+         worker& victim = *workers_[(start + i) % count];
+         if (victim.active_.load(std::memory_order_relaxed) && victim.deque_.steal(t)) {
+            return true;
+         }
+      }
+      return false;
+   }
+
+   inline bool work_stealing_pool::find(const size_t self, task*& t) {
+      bool found = (self != kNotWorker && workers_[self]->deque_.pop(t)) || injection_.pop(t) || steal(self, t);
+      if (found) {
+         pending_.fetch_sub(1);
+      }
+      return found;
+   }
+
+   inline bool work_stealing_pool::run_one() {
+      const size_t self = (current_pool() == this) ? current_index() : kNotWorker;
+      task* t = nullptr;
+      if (!find(self, t)) {
+         return false;
+      }
+      t->run();
+      return true;
+   }
+
+   inline void work_stealing_pool::work(const size_t index) {
+      current_index() = index;
+      current_pool() = this;
+      ThreadExitNotifier notifier([this, index](std::thread::id) { on_worker_exit(index); });
+
+      task* t = nullptr;
+      for (;;) {
+         if (find(index, t)) {
+            t->run();
+            continue;
+         }
+         if (stop_.load() && pending_.load() == 0) {
+            break;
+         }
+
+         sleepers_.fetch_add(1);
+         {
+            std::unique_lock<std::mutex> lock(sleep_m_);
+            sleep_cond_.wait(lock, [this] { return pending_.load() > 0 || stop_.load(); });
+         }
+         sleepers_.fetch_sub(1);
+      }
+   }
+
+   // A worker that is gone is no longer a steal victim. Whatever is left
+   // in its deque goes to the injection queue so that no task is lost.
+   // Runs on the worker thread, the owner of the deque
+   inline void work_stealing_pool::on_worker_exit(const size_t index) {
+      worker& self = *workers_[index];
+      self.active_.store(false);
+      task* t = nullptr;
+      while (self.deque_.pop(t)) {
+         injection_.push(t);
+      }
+      live_workers_.fetch_sub(1);
+   }
+}  // namespace executor
@@ -0,0 +1,193 @@
+/*
+* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+* First published at: github.com/kjellkod/Q
+*
+* Chase-Lev work stealing deque
+* "Dynamic Circular Work-Stealing Deque", D. Chase, Y. Lev (2005)
+* with the C11 memory orderings from
+* "Correct and Efficient Work-Stealing for Weak Memory Models", N.M. Le et al. (2013)
+*
+* - ONE owner thread: 'push' and 'pop' at the bottom. The owner sees its items LIFO.
+* - Any number of thief threads: 'steal' from the top. Thieves see the items FIFO.
+* - The circular array grows when full, 'push' never fails.
+*
+* IMPORTANT:
+* 1. The Element must be trivially copyable, typically a pointer or an index. A thief reads the
+*    slot before it knows if it won the item, a losing thief just drops its copy.
+* 2. 'steal' returns false when the deque is empty OR when another thief/the owner won the race
+*    for the last item. A thief that fails should move on to another victim.
+* 3. Arrays outgrown by 'push' are kept until the deque is destroyed, since a thief may still read them.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace work_stealing {
+   template <typename Element>
+   class deque {
+      static_assert(std::is_trivially_copyable<Element>::value, "the Element must be trivially copyable");
+
+     public:
+      explicit deque(const size_t initial_size = 64);
+      virtual ~deque() = default;
+
+      bool push(Element& item);   // owner
+      bool pop(Element& item);    // owner
+      bool steal(Element& item);  // thieves
+      bool empty() const;
+      size_t capacity() const;  // current size of the circular array
+      size_t size() const;
+      bool lock_free() const;
+
+     private:
+      deque(const deque&) = delete;
+      deque& operator=(const deque&) = delete;
+
+      class circular_array {
+        public:
+         explicit circular_array(const size_t size) :
+             kSize(size),
+             kMask(size - 1),
+             slots_(new std::atomic<Element>[size]) {}
+
+         size_t size() const { return kSize; }
+         Element get(const int64_t index) const { return slots_[index & kMask].load(std::memory_order_relaxed); }
+         void put(const int64_t index, Element item) { slots_[index & kMask].store(item, std::memory_order_relaxed); }
+
+         // copies the live items [top, bottom) into an array twice the size
+         circular_array* grow(const int64_t top, const int64_t bottom) const {
+            auto bigger = new circular_array(kSize * 2);
+            for (int64_t i = top; i < bottom; ++i) {
+               bigger->put(i, get(i));
+            }
+            return bigger;
+         }
+
+        private:
+         const size_t kSize;
+         const size_t kMask;  // the size is a power of two
+         std::unique_ptr<std::atomic<Element>[]> slots_;
+      };
+
+      static size_t round_up(size_t size) {
+         size_t power = 2;
+         while (power < size) {
+            power <<= 1;
+         }
+         return power;
+      }
+
+      typedef char cache_line[64];
+      cache_line pad_top_;
+      std::atomic<int64_t> top_;  // stolen from here
+      cache_line pad_bottom_;
+      std::atomic<int64_t> bottom_;  // owner pushes and pops here
+      std::atomic<circular_array*> array_;
+      std::vector<std::unique_ptr<circular_array>> arrays_;  // owner only, current and outgrown arrays
+      cache_line pad_end_;
+   };
+
+   template <typename Element>
+   deque<Element>::deque(const size_t initial_size) :
+       top_(0),
+       bottom_(0),
+       array_(nullptr) {
+      arrays_.emplace_back(new circular_array(round_up(initial_size)));
+      array_.store(arrays_.back().get(), std::memory_order_relaxed);
+   }
+
+   template <typename Element>
+   bool deque<Element>::push(Element& item) {
+      const auto bottom = bottom_.load(std::memory_order_relaxed);
+      const auto top = top_.load(std::memory_order_acquire);
+      auto array = array_.load(std::memory_order_relaxed);
+      if (bottom - top > static_cast<int64_t>(array->size()) - 1) {
+         arrays_.emplace_back(array->grow(top, bottom));
+         array = arrays_.back().get();
+         array_.store(array, std::memory_order_release);
+      }
+      array->put(bottom, item);
+      std::atomic_thread_fence(std::memory_order_release);
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return true;
+   }
+
+   // The owner reserves the bottom item before it looks at the top. Only when
+   // one item is left does it have to race the thieves for it with a CAS
+   template <typename Element>
+   bool deque<Element>::pop(Element& item) {
+      const auto bottom = bottom_.load(std::memory_order_relaxed) - 1;
+      auto array = array_.load(std::memory_order_relaxed);
+      bottom_.store(bottom, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      auto top = top_.load(std::memory_order_relaxed);
+
+      if (top > bottom) {
+         bottom_.store(bottom + 1, std::memory_order_relaxed);
+         return false;  // empty deque
+      }
+
+      Element popped = array->get(bottom);
+      if (top == bottom) {
+         const bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+         bottom_.store(bottom + 1, std::memory_order_relaxed);
+         if (!won) {
+            return false;  // a thief took the last item
+         }
+      }
+      item = popped;
+      return true;
+   }
+
+   template <typename Element>
+   bool deque<Element>::steal(Element& item) {
+      auto top = top_.load(std::memory_order_acquire);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const auto bottom = bottom_.load(std::memory_order_acquire);
+      if (top >= bottom) {
+         return false;  // empty deque
+      }
+
+      Element stolen = array_.load(std::memory_order_acquire)->get(top);
+      if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+         return false;  // lost the race
+      }
+      item = stolen;
+      return true;
+   }
+
+   template <typename Element>
+   bool deque<Element>::empty() const {
+      // snapshot with acceptance of that this comparison operation is not atomic
+      return (bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed));
+   }
+
+   template <typename Element>
+   size_t deque<Element>::size() const {
+      const auto bottom = bottom_.load();
+      const auto top = top_.load();
+      return (bottom > top) ? static_cast<size_t>(bottom - top) : 0;
+   }
+
+   template <typename Element>
+   size_t deque<Element>::capacity() const {
+      return array_.load()->size();
+   }
+
+   template <typename Element>
+   bool deque<Element>::lock_free() const {
+      return std::atomic<int64_t>{}.is_lock_free() && std::atomic<Element>{}.is_lock_free();
+   }
+}  // namespace work_stealing
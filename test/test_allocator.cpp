@@ -0,0 +1,152 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include "q/mpmc.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc.hpp"
+
+namespace {
+   // std::allocator that counts the allocated bytes
+   template <typename T>
+   struct counting_allocator {
+      using value_type = T;
+      explicit counting_allocator(size_t* bytes) :
+          bytes_(bytes) {}
+      template <typename U>
+      counting_allocator(const counting_allocator<U>& other) :
+          bytes_(other.bytes_) {}
+
+      T* allocate(size_t n) {
+         *bytes_ += n * sizeof(T);
+         return std::allocator<T>().allocate(n);
+      }
+      void deallocate(T* p, size_t n) {
+         *bytes_ -= n * sizeof(T);
+         std::allocator<T>().deallocate(p, n);
+      }
+      template <typename U>
+      bool operator==(const counting_allocator<U>& other) const { return bytes_ == other.bytes_; }
+      template <typename U>
+      bool operator!=(const counting_allocator<U>& other) const { return bytes_ != other.bytes_; }
+
+      size_t* bytes_;
+   };
+
+   template <typename QType>
+   void PushAndPop(queue_api::Sender<QType>& sender, queue_api::Receiver<QType>& receiver) {
+      for (int i = 0; i < 10; ++i) {
+         int item = i;
+         EXPECT_TRUE(sender.push(item));
+      }
+      for (int i = 0; i < 10; ++i) {
+         int item = -1;
+         EXPECT_TRUE(receiver.pop(item));
+         EXPECT_EQ(i, item);
+      }
+   }
+}  // namespace
+
+TEST(Allocator, CircularFifoStorage) {
+   size_t bytes = 0;
+   {
+      using QType = spsc::circular_fifo<int, counting_allocator<int>>;
+      auto queue = queue_api::CreateQueue<QType>(10, counting_allocator<int>(&bytes));
+      EXPECT_EQ(11 * sizeof(int), bytes);  // size + 1 slots
+      PushAndPop(std::get<queue_api::index::sender>(queue), std::get<queue_api::index::receiver>(queue));
+   }
+   EXPECT_EQ(size_t{0}, bytes);
+}
+
+TEST(Allocator, LockQueueStorage) {
+   size_t bytes = 0;
+   {
+      using QType = mpmc::lock_queue<int, counting_allocator<int>>;
+      auto queue = queue_api::CreateQueue<QType>(10, counting_allocator<int>(&bytes));
+      PushAndPop(std::get<queue_api::index::sender>(queue), std::get<queue_api::index::receiver>(queue));
+      EXPECT_LT(size_t{0}, bytes);
+   }
+   EXPECT_EQ(size_t{0}, bytes);
+}
+
+TEST(Allocator, PmrCircularFifo) {
+   std::byte buffer[1024];
+   std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+   auto queue = queue_api::CreateQueue<spsc::pmr::circular_fifo<int>>(10, &arena);
+   PushAndPop(std::get<queue_api::index::sender>(queue), std::get<queue_api::index::receiver>(queue));
+}
+
+TEST(Allocator, PmrLockQueue) {
+   std::byte buffer[16 * 1024];
+   std::pmr::monotonic_buffer_resource arena(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+   auto queue = queue_api::CreateQueue<mpmc::pmr::lock_queue<std::pmr::string>>(10, &arena);
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+   std::pmr::string item("hello", &arena);
+   EXPECT_TRUE(sender.push(item));
+   std::pmr::string popped(&arena);
+   EXPECT_TRUE(receiver.pop(popped));
+   EXPECT_EQ("hello", popped);
+}
+
+// bounded: the ring is allocated once, push and pop do not allocate
+TEST(Allocator, BoundedLockQueueAllocatesUpFront) {
+   size_t bytes = 0;
+   using QType = mpmc::lock_queue<int, counting_allocator<int>>;
+   auto queue = queue_api::CreateQueue<QType>(10, counting_allocator<int>(&bytes));
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+   const size_t reserved = bytes;
+   EXPECT_LE(10 * sizeof(int), reserved);  // the ring, and whatever the unused std::deque allocates empty
+
+   // wraps around the ring a few times
+   int expected = 0;
+   int next = 0;
+   for (int round = 0; round < 7; ++round) {
+      for (int i = 0; i < 7; ++i) {
+         int item = next++;
+         EXPECT_TRUE(sender.push(item));
+      }
+      for (int i = 0; i < 7; ++i) {
+         int item = -1;
+         EXPECT_TRUE(receiver.pop(item));
+         EXPECT_EQ(expected++, item);
+      }
+   }
+   for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(sender.push(i));
+   }
+   int item = 10;
+   EXPECT_FALSE(sender.push(item));
+   EXPECT_EQ(size_t{10}, sender.size());
+   EXPECT_EQ(reserved, bytes);
+}
+
+TEST(Allocator, UnboundedLockQueueGrows) {
+   size_t bytes = 0;
+   using QType = mpmc::lock_queue<int, counting_allocator<int>>;
+   auto queue = queue_api::CreateQueue<QType>(-1, counting_allocator<int>(&bytes));
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+   for (int i = 0; i < 10000; ++i) {
+      EXPECT_TRUE(sender.push(i));
+   }
+   EXPECT_LT(10000 * sizeof(int), bytes);
+   for (int i = 0; i < 10000; ++i) {
+      int item = -1;
+      EXPECT_TRUE(receiver.pop(item));
+      EXPECT_EQ(i, item);
+   }
+   EXPECT_TRUE(receiver.empty());
+}
@@ -0,0 +1,250 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/closable.hpp"
+#include "q/mpmc.hpp"
+#include "q/mpsc_fixed_receiver_round_robin.hpp"
+#include "q/mpsc_ring_queue.hpp"
+#include "q/q_api.hpp"
+#include "q/spmc_fixed_sender_round_robin.hpp"
+#include "q/spsc.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   template <typename QType>
+   void DrainThenClosed() {
+      auto queue = queue_api::CreateQueue<QType>(10);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      std::string item = "hello";
+      EXPECT_TRUE(sender.push(item));
+      EXPECT_FALSE(sender.closed());
+      sender.close();
+      EXPECT_TRUE(receiver.closed());
+
+      item = "too late";
+      auto pushed = sender.push(item);
+      EXPECT_FALSE(pushed);
+      EXPECT_TRUE(pushed.closed());
+      EXPECT_EQ("too late", item);
+
+      auto popped = receiver.pop(item);
+      EXPECT_TRUE(popped);
+      EXPECT_FALSE(popped.closed());
+      EXPECT_EQ("hello", item);
+
+      popped = receiver.pop(item);
+      EXPECT_FALSE(popped);
+      EXPECT_TRUE(popped.closed());
+      popped = receiver.wait_and_pop(item, std::chrono::milliseconds(0));
+      EXPECT_TRUE(popped.closed());
+   }
+
+   template <typename QType>
+   void CloseWakesWaiter() {
+      auto queue = queue_api::CreateQueue<QType>(10);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      std::thread closing([sender]() mutable {
+         std::this_thread::sleep_for(std::chrono::milliseconds(50));
+         sender.close();
+      });
+      benchmark::stopwatch watch;
+      std::string item;
+      auto popped = receiver.wait_and_pop(item, std::chrono::milliseconds(10 * 1000));
+      EXPECT_TRUE(popped.closed());
+      EXPECT_LT(watch.elapsed_ms(), 5 * 1000);
+      closing.join();
+   }
+
+   template <typename QType>
+   void RangeFor() {
+      const uint64_t kItems = 10000;
+      auto queue = queue_api::CreateQueue<QType>(100);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+
+      std::thread producer([sender]() mutable {
+         for (uint64_t i = 1; i <= kItems; ++i) {
+            while (!sender.push(i)) {
+               std::this_thread::yield();
+            }
+         }
+         sender.close();
+      });
+
+      uint64_t sum = 0;
+      uint64_t count = 0;
+      for (auto value : receiver) {
+         sum += value;
+         ++count;
+      }
+      producer.join();
+      EXPECT_EQ(kItems, count);
+      EXPECT_EQ(kItems * (kItems + 1) / 2, sum);
+   }
+}  // namespace
+
+TEST(Closable, Status) {
+   queue_api::status unavailable;
+   EXPECT_FALSE(unavailable);
+   EXPECT_FALSE(unavailable.closed());
+   queue_api::status success = queue_api::status::code::success;
+   EXPECT_TRUE(success);
+   queue_api::status closed = queue_api::status::code::closed;
+   EXPECT_FALSE(closed);
+   EXPECT_TRUE(closed.closed());
+   EXPECT_TRUE(queue_api::to_status(true));
+   EXPECT_FALSE(queue_api::is_closed(false));
+}
+
+TEST(Closable, CircularFifoDrainThenClosed) {
+   DrainThenClosed<spsc::circular_fifo<std::string>>();
+}
+
+TEST(Closable, LockQueueDrainThenClosed) {
+   DrainThenClosed<mpmc::lock_queue<std::string>>();
+}
+
+TEST(Closable, TwoLockQueueDrainThenClosed) {
+   DrainThenClosed<mpmc::two_lock_queue<std::string>>();
+}
+
+TEST(Closable, FlatCombiningQueueDrainThenClosed) {
+   DrainThenClosed<mpmc::flat_combining_queue<std::string>>();
+}
+
+TEST(Closable, RingQueueDrainThenClosed) {
+   DrainThenClosed<mpsc::ring_queue<std::string>>();
+}
+
+TEST(Closable, CircularFifoCloseWakesWaiter) {
+   CloseWakesWaiter<spsc::circular_fifo<std::string>>();
+}
+
+TEST(Closable, LockQueueCloseWakesWaiter) {
+   CloseWakesWaiter<mpmc::lock_queue<std::string>>();
+}
+
+TEST(Closable, TwoLockQueueCloseWakesWaiter) {
+   CloseWakesWaiter<mpmc::two_lock_queue<std::string>>();
+}
+
+TEST(Closable, FlatCombiningQueueCloseWakesWaiter) {
+   CloseWakesWaiter<mpmc::flat_combining_queue<std::string>>();
+}
+
+TEST(Closable, RingQueueCloseWakesWaiter) {
+   CloseWakesWaiter<mpsc::ring_queue<std::string>>();
+}
+
+TEST(Closable, CircularFifoRangeFor) {
+   RangeFor<spsc::circular_fifo<uint64_t>>();
+}
+
+TEST(Closable, LockQueueRangeFor) {
+   RangeFor<mpmc::lock_queue<uint64_t>>();
+}
+
+TEST(Closable, TwoLockQueueRangeFor) {
+   RangeFor<mpmc::two_lock_queue<uint64_t>>();
+}
+
+TEST(Closable, FlatCombiningQueueRangeFor) {
+   RangeFor<mpmc::flat_combining_queue<uint64_t>>();
+}
+
+TEST(Closable, RingQueueRangeFor) {
+   RangeFor<mpsc::ring_queue<uint64_t>>();
+}
+
+TEST(Closable, MPSCClosedWhenAllProducersClosed) {
+   using QueueType = spsc::circular_fifo<int>;
+   std::vector<queue_api::Sender<QueueType>> senders;
+   std::vector<queue_api::Receiver<QueueType>> receivers;
+   for (int i = 0; i < 3; ++i) {
+      auto queue = queue_api::CreateQueue<QueueType>(10);
+      senders.push_back(std::get<queue_api::index::sender>(queue));
+      receivers.push_back(std::get<queue_api::index::receiver>(queue));
+   }
+   mpsc::fixed_size::round_robin::Receiver<QueueType> consumer(receivers);
+
+   std::vector<std::thread> producers;
+   for (int i = 0; i < 3; ++i) {
+      producers.emplace_back([sender = senders[i], i]() mutable {
+         for (int value = 0; value < 100; ++value) {
+            int item = i * 1000 + value;
+            while (!sender.push(item)) {
+               std::this_thread::yield();
+            }
+         }
+         sender.close();
+      });
+   }
+
+   int count = 0;
+   for (auto value : consumer) {
+      EXPECT_LT(value % 1000, 100);
+      ++count;
+   }
+   for (auto& p : producers) {
+      p.join();
+   }
+   EXPECT_EQ(300, count);
+   EXPECT_TRUE(consumer.closed());
+   int item = 0;
+   EXPECT_TRUE(consumer.pop(item).closed());
+}
+
+TEST(Closable, MPSCNotClosedWhileOneProducerIsOpen) {
+   using QueueType = spsc::circular_fifo<int>;
+   auto first = queue_api::CreateQueue<QueueType>(10);
+   auto second = queue_api::CreateQueue<QueueType>(10);
+   std::vector<queue_api::Receiver<QueueType>> receivers{std::get<queue_api::index::receiver>(first),
+                                                         std::get<queue_api::index::receiver>(second)};
+   mpsc::fixed_size::round_robin::Receiver<QueueType> consumer(receivers);
+
+   std::get<queue_api::index::sender>(first).close();
+   int item = 0;
+   auto popped = consumer.pop(item);
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   std::get<queue_api::index::sender>(second).close();
+   EXPECT_TRUE(consumer.pop(item).closed());
+}
+
+TEST(Closable, SPMCCloseClosesAllConsumers) {
+   using QueueType = spsc::circular_fifo<int>;
+   std::vector<queue_api::Sender<QueueType>> senders;
+   std::vector<queue_api::Receiver<QueueType>> receivers;
+   for (int i = 0; i < 2; ++i) {
+      auto queue = queue_api::CreateQueue<QueueType>(10);
+      senders.push_back(std::get<queue_api::index::sender>(queue));
+      receivers.push_back(std::get<queue_api::index::receiver>(queue));
+   }
+   spmc::fixed_size::round_robin::Sender<QueueType> producer(senders);
+
+   int item = 1;
+   EXPECT_TRUE(producer.push(item));
+   producer.close();
+   EXPECT_TRUE(producer.closed());
+   EXPECT_TRUE(producer.push(item).closed());
+
+   EXPECT_TRUE(receivers[0].pop(item));
+   EXPECT_TRUE(receivers[0].pop(item).closed());
+   EXPECT_TRUE(receivers[1].pop(item).closed());
+}
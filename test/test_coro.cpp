@@ -0,0 +1,172 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include "q/coro.hpp"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#include "q/mpmc.hpp"
+#include "q/spsc.hpp"
+
+namespace {
+   // fire and forget coroutine
+   struct detached {
+      struct promise_type {
+         detached get_return_object() { return {}; }
+         std::suspend_never initial_suspend() noexcept { return {}; }
+         std::suspend_never final_suspend() noexcept { return {}; }
+         void return_void() {}
+         void unhandled_exception() { std::terminate(); }
+      };
+   };
+
+   // single threaded executor, 'post' can be called from any thread
+   struct executor {
+      mpmc::lock_queue<std::function<void()>> tasks_{-1};
+      void post(std::function<void()> work) { tasks_.push(work); }
+      bool run_one(std::chrono::milliseconds wait) {
+         std::function<void()> work;
+         if (tasks_.wait_and_pop(work, wait)) {
+            work();
+            return true;
+         }
+         return false;
+      }
+      void run_until(std::atomic<bool>& done) {
+         while (!done.load()) {
+            run_one(std::chrono::milliseconds(10));
+         }
+      }
+   };
+
+   template <typename Receiver>
+   detached consume(Receiver& receiver, int count, long long& sum, std::atomic<bool>& done) {
+      for (int i = 0; i < count; ++i) {
+         int value = 0;
+         co_await receiver.pop(value);
+         sum += value;
+      }
+      done.store(true);
+   }
+
+   template <typename Receiver>
+   detached consume_until_closed(Receiver& receiver, long long& sum, std::atomic<bool>& done) {
+      int value = 0;
+      while (co_await receiver.pop(value)) {
+         sum += value;
+      }
+      done.store(true);
+   }
+
+   template <typename Sender>
+   detached produce(Sender& sender, int count, std::atomic<bool>& done) {
+      for (int i = 1; i <= count; ++i) {
+         int value = i;
+         co_await sender.push(value);
+      }
+      done.store(true);
+   }
+}  // namespace
+
+TEST(Coroutine, PopSuspendsUntilPush) {
+   executor producer_executor;
+   executor consumer_executor;
+   auto queue = coro::CreateQueue<spsc::circular_fifo<int>>(producer_executor, consumer_executor, 10);
+   auto& sender = queue.first;
+   auto& receiver = queue.second;
+
+   long long sum = 0;
+   std::atomic<bool> done{false};
+   consume(receiver, 1, sum, done);  // suspends, queue is empty
+   EXPECT_FALSE(done.load());
+   EXPECT_FALSE(consumer_executor.run_one(std::chrono::milliseconds(0)));
+
+   int value = 42;
+   EXPECT_TRUE(sender.queue().push(value));  // plain push also wakes the coroutine
+   EXPECT_TRUE(consumer_executor.run_one(std::chrono::milliseconds(1000)));
+   EXPECT_TRUE(done.load());
+   EXPECT_EQ(42, sum);
+}
+
+TEST(Coroutine, CloseResumesWaitingReceiver) {
+   executor producer_executor;
+   executor consumer_executor;
+   auto queue = coro::CreateQueue<spsc::circular_fifo<int>>(producer_executor, consumer_executor, 10);
+   auto& sender = queue.first;
+   auto& receiver = queue.second;
+
+   long long sum = 0;
+   std::atomic<bool> done{false};
+   consume_until_closed(receiver, sum, done);  // suspends, queue is empty
+   int value = 7;
+   EXPECT_TRUE(sender.queue().push(value));
+   EXPECT_TRUE(consumer_executor.run_one(std::chrono::milliseconds(1000)));
+   EXPECT_FALSE(done.load());
+   EXPECT_EQ(7, sum);
+
+   sender.queue().close();
+   EXPECT_TRUE(consumer_executor.run_one(std::chrono::milliseconds(1000)));
+   EXPECT_TRUE(done.load());
+}
+
+TEST(Coroutine, PushSuspendsWhileFull) {
+   executor producer_executor;
+   executor consumer_executor;
+   auto queue = coro::CreateQueue<spsc::circular_fifo<int>>(producer_executor, consumer_executor, 2);
+   auto& sender = queue.first;
+   auto& receiver = queue.second;
+
+   std::atomic<bool> done{false};
+   produce(sender, 3, done);  // third push suspends
+   EXPECT_FALSE(done.load());
+   EXPECT_TRUE(receiver.queue().full());
+
+   long long sum = 0;
+   std::atomic<bool> consumed{false};
+   consume(receiver, 1, sum, consumed);  // pop through coro::Receiver wakes the sender
+   EXPECT_TRUE(consumed.load());
+   EXPECT_EQ(1, sum);
+   EXPECT_TRUE(producer_executor.run_one(std::chrono::milliseconds(1000)));
+   EXPECT_TRUE(done.load());
+   EXPECT_EQ(2, receiver.queue().size());
+}
+
+TEST(Coroutine, ProducerConsumerOnTwoExecutors) {
+   const int kItems = 20000;
+   executor producer_executor;
+   executor consumer_executor;
+   auto queue = coro::CreateQueue<spsc::circular_fifo<int>>(producer_executor, consumer_executor, 16);
+   auto& sender = queue.first;
+   auto& receiver = queue.second;
+
+   std::atomic<bool> produced{false};
+   std::atomic<bool> consumed{false};
+   long long sum = 0;
+   // each coroutine is started on its own thread and only that thread runs the executor it is resumed on
+   std::thread consumer_thread([&] {
+      consume(receiver, kItems, sum, consumed);
+      consumer_executor.run_until(consumed);
+   });
+   std::thread producer_thread([&] {
+      produce(sender, kItems, produced);
+      producer_executor.run_until(produced);
+   });
+
+   consumer_thread.join();
+   producer_thread.join();
+   EXPECT_EQ(static_cast<long long>(kItems) * (kItems + 1) / 2, sum);
+}
+#endif  // __cpp_impl_coroutine
@@ -0,0 +1,149 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <array>
+#include <memory>
+#include <string>
+#include "q/envelope.hpp"
+#include "q/object_pool.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace {
+   struct small {
+      int value;
+   };
+   struct large {
+      std::array<char, 256> data;
+   };
+
+   // counts the live instances
+   struct counted {
+      static int alive;
+      counted() { ++alive; }
+      counted(counted&&) noexcept { ++alive; }
+      ~counted() { --alive; }
+   };
+   int counted::alive = 0;
+
+   struct handler {
+      int smalls = 0;
+      int strings = 0;
+      int larges = 0;
+      void operator()(small& msg) { smalls += msg.value; }
+      void operator()(std::string&) { ++strings; }
+      void operator()(large& msg) { larges += msg.data[0]; }
+   };
+}  // namespace
+
+TEST(Envelope, InlineOrHeap) {
+   using Envelope = message::envelope<64>;
+   EXPECT_TRUE(Envelope::stored_inline<small>());
+   EXPECT_TRUE(Envelope::stored_inline<std::string>());
+   EXPECT_TRUE(Envelope::stored_inline<pool::pooled_ptr<large>>());
+   EXPECT_FALSE(Envelope::stored_inline<large>());
+}
+
+TEST(Envelope, GetAndHolds) {
+   message::envelope<> item;
+   EXPECT_TRUE(item.empty());
+   EXPECT_TRUE(nullptr == item.get<small>());
+
+   item = message::envelope<>(small{7});
+   EXPECT_FALSE(item.empty());
+   EXPECT_TRUE(item.holds<small>());
+   EXPECT_FALSE(item.holds<std::string>());
+   ASSERT_TRUE(nullptr != item.get<small>());
+   EXPECT_EQ(7, item.get<small>()->value);
+
+   large big{};
+   big.data[0] = 'x';
+   item.emplace<large>(big);
+   EXPECT_TRUE(item.holds<large>());
+   EXPECT_EQ('x', item.get<large>()->data[0]);
+}
+
+TEST(Envelope, MoveLeavesEmpty) {
+   message::envelope<> first(std::string("hello"));
+   message::envelope<> second(std::move(first));
+   EXPECT_TRUE(first.empty());
+   ASSERT_TRUE(second.holds<std::string>());
+   EXPECT_EQ("hello", *second.get<std::string>());
+
+   large big{};
+   message::envelope<> heap(big);
+   first = std::move(heap);
+   EXPECT_TRUE(heap.empty());
+   EXPECT_TRUE(first.holds<large>());
+}
+
+TEST(Envelope, DestroysWhatItHolds) {
+   {
+      message::envelope<> item{counted()};
+      EXPECT_EQ(1, counted::alive);
+      message::envelope<> moved(std::move(item));
+      EXPECT_EQ(1, counted::alive);
+      moved.reset();
+      EXPECT_EQ(0, counted::alive);
+      moved.emplace<counted>();
+      EXPECT_EQ(1, counted::alive);
+   }
+   EXPECT_EQ(0, counted::alive);
+}
+
+TEST(Envelope, VisitDispatchesOnType) {
+   handler visitor;
+   message::envelope<> item(small{3});
+   EXPECT_TRUE((item.visit<std::string, small, large>(visitor)));
+   EXPECT_EQ(3, visitor.smalls);
+   EXPECT_EQ(0, visitor.strings);
+
+   item = message::envelope<>(std::string("hello"));
+   EXPECT_TRUE((item.visit<std::string, small, large>(visitor)));
+   EXPECT_EQ(1, visitor.strings);
+
+   item = message::envelope<>(3.14);
+   EXPECT_FALSE((item.visit<std::string, small, large>(visitor)));
+}
+
+TEST(Envelope, ManyTypesThroughOneQueue) {
+   using Envelope = message::envelope<>;
+   pool::object_pool<large> larges(2);
+   auto queue = queue_api::CreateQueue<spsc::circular_fifo<Envelope>>(10);
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+
+   Envelope item(small{5});
+   EXPECT_TRUE(sender.push(item));
+   EXPECT_TRUE(item.empty());
+   item = Envelope(std::string("hello"));
+   EXPECT_TRUE(sender.push(item));
+   auto pooled = larges.acquire();
+   pooled->data[0] = 2;
+   item = Envelope(std::move(pooled));
+   EXPECT_TRUE(sender.push(item));
+
+   handler visitor;
+   int pooled_larges = 0;
+   auto dispatch = [&](auto& msg) { visitor(msg); };
+   while (receiver.pop(item)) {
+      if (auto* p = item.get<pool::pooled_ptr<large>>()) {
+         pooled_larges += (*p)->data[0];
+         continue;
+      }
+      EXPECT_TRUE((item.visit<small, std::string>(dispatch)));
+   }
+   EXPECT_EQ(5, visitor.smalls);
+   EXPECT_EQ(1, visitor.strings);
+   EXPECT_EQ(2, pooled_larges);
+   item.reset();
+   EXPECT_EQ(size_t{2}, larges.available());
+}
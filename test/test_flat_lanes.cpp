@@ -0,0 +1,186 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/flat_lanes.hpp"
+
+namespace {
+   struct alignas(32) wide {
+      int value = 0;
+   };
+}  // namespace
+
+TEST(FlatLanes, MPSCRoundRobin) {
+   auto queues = mpsc::flat::CreateLanes<std::string>(3, 2);
+   auto& senders = queues.first;
+   auto& receiver = queues.second;
+   ASSERT_EQ(size_t{3}, senders.size());
+   EXPECT_EQ(size_t{6}, receiver.capacity());
+   EXPECT_EQ(size_t{2}, senders[0].capacity());
+   EXPECT_TRUE(receiver.empty());
+   EXPECT_TRUE(receiver.lock_free());
+
+   std::string item;
+   EXPECT_FALSE(receiver.pop(item));
+   for (auto text : {"a1", "a2"}) {
+      item = text;
+      EXPECT_TRUE(senders[0].push(item));
+   }
+   item = "a3";
+   EXPECT_FALSE(senders[0].push(item));  // each lane is full on its own
+   EXPECT_EQ("a3", item);
+   EXPECT_TRUE(senders[0].full());
+   item = "c1";
+   EXPECT_TRUE(senders[2].push(item));
+   EXPECT_EQ(size_t{3}, receiver.size());
+   EXPECT_EQ(size_t{50}, receiver.usage());
+
+   std::vector<std::string> popped;
+   while (receiver.pop(item)) {
+      popped.push_back(item);
+   }
+   EXPECT_EQ((std::vector<std::string>{"a1", "c1", "a2"}), popped);
+   EXPECT_TRUE(receiver.empty());
+}
+
+TEST(FlatLanes, MPSCDrainThenClosed) {
+   auto queues = mpsc::flat::CreateLanes<int>(2, 10);
+   auto& senders = queues.first;
+   auto& receiver = queues.second;
+   int item = 1;
+   EXPECT_TRUE(senders[0].push(item));
+   senders[0].close();
+   EXPECT_TRUE(senders[0].push(item).closed());
+   EXPECT_FALSE(receiver.closed());
+
+   EXPECT_TRUE(receiver.pop(item));
+   auto result = receiver.pop(item);
+   EXPECT_FALSE(result);
+   EXPECT_FALSE(result.closed());  // lane 1 is still open
+   senders[1].close();
+   EXPECT_TRUE(receiver.closed());
+   EXPECT_TRUE(receiver.pop(item).closed());
+   EXPECT_TRUE(receiver.wait_and_pop(item, std::chrono::milliseconds(0)).closed());
+}
+
+TEST(FlatLanes, SPMCRoundRobin) {
+   auto queues = spmc::flat::CreateLanes<int>(3, 1);
+   auto& sender = queues.first;
+   auto& receivers = queues.second;
+   ASSERT_EQ(size_t{3}, receivers.size());
+   EXPECT_EQ(size_t{3}, sender.capacity());
+   for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(sender.push(i));
+   }
+   int item = 3;
+   EXPECT_FALSE(sender.push(item));
+   EXPECT_TRUE(sender.full());
+   for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(receivers[i].pop(item));
+      EXPECT_EQ(i, item);
+   }
+
+   item = 4;
+   EXPECT_TRUE(sender.push(item));
+   sender.close();
+   EXPECT_TRUE(sender.closed());
+   EXPECT_TRUE(sender.push(item).closed());
+   EXPECT_TRUE(receivers[1].pop(item).closed());
+   EXPECT_TRUE(receivers[0].pop(item));  // what was pushed before the close is received
+   EXPECT_EQ(4, item);
+   EXPECT_TRUE(receivers[0].pop(item).closed());
+}
+
+TEST(FlatLanes, LanesAreCacheAligned) {
+   auto queues = mpsc::flat::CreateLanes<wide>(5, 3);
+   auto& senders = queues.first;
+   auto& receiver = queues.second;
+   for (int round = 0; round < 10; ++round) {
+      for (int lane = 0; lane < 5; ++lane) {
+         wide item;
+         item.value = lane * 100 + round;
+         EXPECT_TRUE(senders[lane].push(item));
+      }
+      for (int lane = 0; lane < 5; ++lane) {
+         wide item;
+         EXPECT_TRUE(receiver.pop(item));
+         EXPECT_EQ(lane * 100 + round, item.value);
+      }
+   }
+}
+
+TEST(FlatLanes, MPSCThreads) {
+   const size_t kProducers = 4;
+   const uint64_t kItems = 50000;
+   auto queues = mpsc::flat::CreateLanes<uint64_t>(kProducers, 64);
+   auto& senders = queues.first;
+   auto& receiver = queues.second;
+
+   std::vector<std::thread> threads;
+   for (size_t p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&senders, p, kItems] {
+         for (uint64_t i = 1; i <= kItems; ++i) {
+            uint64_t item = i;
+            while (!senders[p].push(item)) {
+               std::this_thread::yield();
+            }
+         }
+         senders[p].close();
+      });
+   }
+   uint64_t sum = 0;
+   for (auto value : receiver) {
+      sum += value;
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kItems * (kItems + 1) / 2, sum);
+   EXPECT_TRUE(receiver.empty());
+}
+
+TEST(FlatLanes, SPMCThreads) {
+   const size_t kConsumers = 4;
+   const uint64_t kItems = 200000;
+   auto queues = spmc::flat::CreateLanes<std::unique_ptr<uint64_t>>(kConsumers, 64);
+   auto& sender = queues.first;
+   auto& receivers = queues.second;
+
+   std::vector<uint64_t> sums(kConsumers, 0);
+   std::vector<std::thread> threads;
+   for (size_t c = 0; c < kConsumers; ++c) {
+      threads.emplace_back([&receivers, &sums, c] {
+         for (auto& item : receivers[c]) {
+            sums[c] += *item;
+         }
+      });
+   }
+   for (uint64_t i = 1; i <= kItems; ++i) {
+      auto item = std::make_unique<uint64_t>(i);
+      while (!sender.push(item)) {
+         std::this_thread::yield();
+      }
+   }
+   sender.close();
+   for (auto& t : threads) {
+      t.join();
+   }
+   uint64_t sum = 0;
+   for (auto s : sums) {
+      sum += s;
+   }
+   EXPECT_EQ(kItems * (kItems + 1) / 2, sum);
+}
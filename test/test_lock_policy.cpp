@@ -0,0 +1,135 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/lock_policy.hpp"
+#include "q/mpmc_lock_queue.hpp"
+#include "q/q_api.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   // non-atomic counter, only correct if the lock excludes
+   template <typename Lock>
+   void Excludes() {
+      const int kThreads = 4;
+      const int kIncrements = 20000;
+      Lock lock;
+      uint64_t counter = 0;
+      std::vector<std::thread> threads;
+      for (int t = 0; t < kThreads; ++t) {
+         threads.emplace_back([&] {
+            for (int i = 0; i < kIncrements; ++i) {
+               std::lock_guard<Lock> guard(lock);
+               ++counter;
+            }
+         });
+      }
+      for (auto& t : threads) {
+         t.join();
+      }
+      EXPECT_EQ(uint64_t{kThreads * kIncrements}, counter);
+   }
+
+   template <typename Lock>
+   void TryLock() {
+      Lock lock;
+      EXPECT_TRUE(lock.try_lock());
+      EXPECT_FALSE(lock.try_lock());
+      bool other = true;
+      std::thread([&] { other = lock.try_lock(); }).join();
+      EXPECT_FALSE(other);
+      lock.unlock();
+      EXPECT_TRUE(lock.try_lock());
+      lock.unlock();
+   }
+
+   template <typename Lock>
+   void QueueManyProducersManyConsumers() {
+      const int kProducers = 4;
+      const int kConsumers = 4;
+      const uint64_t kPerProducer = 20000;
+      auto queue = queue_api::CreateQueue<mpmc::lock_queue<uint64_t, std::allocator<uint64_t>, Lock>>(64);
+      auto producer = std::get<queue_api::index::sender>(queue);
+      auto consumer = std::get<queue_api::index::receiver>(queue);
+
+      std::atomic<int> running{kProducers};
+      std::atomic<uint64_t> sum{0};
+      std::atomic<uint64_t> count{0};
+      std::vector<std::thread> threads;
+      for (int p = 0; p < kProducers; ++p) {
+         threads.emplace_back([&, producer]() mutable {
+            for (uint64_t i = 1; i <= kPerProducer; ++i) {
+               uint64_t item = i;
+               EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)));
+            }
+            if (1 == running.fetch_sub(1)) {
+               producer.close();
+            }
+         });
+      }
+      for (int c = 0; c < kConsumers; ++c) {
+         threads.emplace_back([&, consumer]() mutable {
+            for (auto value : consumer) {
+               sum += value;
+               ++count;
+            }
+         });
+      }
+      for (auto& t : threads) {
+         t.join();
+      }
+      EXPECT_EQ(kProducers * kPerProducer, count.load());
+      EXPECT_EQ(kProducers * kPerProducer * (kPerProducer + 1) / 2, sum.load());
+      EXPECT_TRUE(consumer.empty());
+   }
+}  // namespace
+
+TEST(LockPolicy, AdaptiveMutexExcludes) {
+   Excludes<lock_policy::adaptive_mutex>();
+}
+
+TEST(LockPolicy, TicketMutexExcludes) {
+   Excludes<lock_policy::ticket_mutex>();
+}
+
+TEST(LockPolicy, AdaptiveMutexTryLock) {
+   TryLock<lock_policy::adaptive_mutex>();
+}
+
+TEST(LockPolicy, TicketMutexTryLock) {
+   TryLock<lock_policy::ticket_mutex>();
+}
+
+TEST(LockPolicy, LockQueueWithAdaptiveMutex) {
+   QueueManyProducersManyConsumers<lock_policy::adaptive_mutex>();
+}
+
+TEST(LockPolicy, LockQueueWithTicketMutex) {
+   QueueManyProducersManyConsumers<lock_policy::ticket_mutex>();
+}
+
+TEST(LockPolicy, WaitAndPopTimesOutWithAdaptiveMutex) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<std::string, std::allocator<std::string>, lock_policy::adaptive_mutex>>(10);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item;
+   benchmark::stopwatch watch;
+   auto popped = consumer.wait_and_pop(item, std::chrono::milliseconds(50));
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   EXPECT_LE(50, watch.elapsed_ms());
+}
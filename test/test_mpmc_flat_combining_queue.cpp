@@ -0,0 +1,169 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/mpmc.hpp"
+#include "q/q_api.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   using QType = mpmc::flat_combining_queue<std::string>;
+}
+
+TEST(FlatCombiningQueue, BoundedPushPop) {
+   auto queue = queue_api::CreateQueue<QType>(2);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_EQ(size_t{2}, producer.capacity());
+
+   std::string item = "hello";
+   EXPECT_TRUE(producer.push(item));
+   item = "world";
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_TRUE(producer.full());
+   EXPECT_EQ(size_t{100}, producer.usage());
+   item = "!";
+   EXPECT_FALSE(producer.push(item));
+   EXPECT_EQ("!", item);  // not moved from
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("hello", item);
+   EXPECT_EQ(size_t{1}, consumer.size());
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("world", item);
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(consumer.empty());
+}
+
+TEST(FlatCombiningQueue, MoveUnique) {
+   auto queue = queue_api::CreateQueue<mpmc::flat_combining_queue<std::unique_ptr<std::string>>>(-1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   auto arg = std::make_unique<std::string>("hello");
+   EXPECT_TRUE(producer.push(arg));
+   EXPECT_TRUE(nullptr == arg);
+   EXPECT_TRUE(consumer.pop(arg));
+   EXPECT_EQ("hello", *arg);
+}
+
+TEST(FlatCombiningQueue, PopAll) {
+   auto queue = queue_api::CreateQueue<mpmc::flat_combining_queue<int>>(-1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   for (int i = 0; i < 5; ++i) {
+      EXPECT_TRUE(producer.push(i));
+   }
+   std::vector<int> out;
+   EXPECT_EQ(size_t{5}, consumer.pop_all(out));
+   EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), out);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_EQ(size_t{0}, consumer.pop_all(out));
+}
+
+TEST(FlatCombiningQueue, WaitAndPopTimesOut) {
+   auto queue = queue_api::CreateQueue<QType>(10);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item;
+   benchmark::stopwatch watch;
+   auto popped = consumer.wait_and_pop(item, std::chrono::milliseconds(50));
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   EXPECT_LE(50, watch.elapsed_ms());
+}
+
+TEST(FlatCombiningQueue, PopWakesParkedProducer) {
+   auto queue = queue_api::CreateQueue<mpmc::flat_combining_queue<int>>(1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   int item = 1;
+   EXPECT_TRUE(producer.push(item));
+   std::thread popping([consumer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int popped = 0;
+      EXPECT_TRUE(consumer.pop(popped));
+   });
+   item = 2;
+   benchmark::stopwatch watch;
+   EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)));
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   popping.join();
+}
+
+TEST(FlatCombiningQueue, ManyProducersManyConsumers) {
+   const int kProducers = 4;
+   const int kConsumers = 4;
+   const uint64_t kPerProducer = 20000;
+   auto queue = queue_api::CreateQueue<mpmc::flat_combining_queue<uint64_t>>(64);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::atomic<int> running{kProducers};
+   std::atomic<uint64_t> sum{0};
+   std::atomic<uint64_t> count{0};
+   std::vector<std::thread> threads;
+   for (int p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, producer]() mutable {
+         for (uint64_t i = 1; i <= kPerProducer; ++i) {
+            uint64_t item = i;
+            EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)));
+         }
+         if (1 == running.fetch_sub(1)) {
+            producer.close();
+         }
+      });
+   }
+   for (int c = 0; c < kConsumers; ++c) {
+      threads.emplace_back([&, consumer]() mutable {
+         for (auto value : consumer) {
+            sum += value;
+            ++count;
+         }
+      });
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kPerProducer, count.load());
+   EXPECT_EQ(kProducers * kPerProducer * (kPerProducer + 1) / 2, sum.load());
+   EXPECT_TRUE(consumer.empty());
+}
+
+TEST(FlatCombiningQueue, MoreThreadsThanPublicationSlots) {
+   const int kThreads = 80;  // the queue has 64 slots
+   const int kPerThread = 500;
+   auto queue = queue_api::CreateQueue<mpmc::flat_combining_queue<int>>(-1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::vector<std::thread> threads;
+   for (int t = 0; t < kThreads; ++t) {
+      threads.emplace_back([producer]() mutable {
+         for (int i = 0; i < kPerThread; ++i) {
+            int item = i;
+            EXPECT_TRUE(producer.push(item));
+         }
+      });
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(size_t{kThreads * kPerThread}, consumer.size());
+   std::vector<int> out;
+   EXPECT_EQ(size_t{kThreads * kPerThread}, consumer.pop_all(out));
+   EXPECT_TRUE(consumer.empty());
+}
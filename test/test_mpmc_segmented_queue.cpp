@@ -0,0 +1,222 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/epoch_reclamation.hpp"
+#include "q/mpmc.hpp"
+#include "q/q_api.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   using QType = mpmc::segmented_queue<std::string, 4>;  // small segments, many segment changes
+}
+
+TEST(SegmentedQueue, PushPopAcrossSegments) {
+   auto queue = queue_api::CreateQueue<QType>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_FALSE(producer.full());
+   EXPECT_TRUE(producer.lock_free());
+
+   std::string item;
+   EXPECT_FALSE(consumer.pop(item));
+   for (int i = 0; i < 10; ++i) {
+      item = std::to_string(i);
+      EXPECT_TRUE(producer.push(item));
+   }
+   EXPECT_EQ(size_t{10}, consumer.size());
+   for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(std::to_string(i), item);
+   }
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_EQ(size_t{0}, consumer.size());
+}
+
+TEST(SegmentedQueue, MoveUnique) {
+   auto queue = queue_api::CreateQueue<mpmc::segmented_queue<std::unique_ptr<std::string>>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   auto arg = std::make_unique<std::string>("hello");
+   EXPECT_TRUE(producer.push(arg));
+   EXPECT_TRUE(nullptr == arg);
+   EXPECT_TRUE(consumer.pop(arg));
+   EXPECT_EQ("hello", *arg);
+}
+
+TEST(SegmentedQueue, ItemsLeftAreDestroyed) {
+   auto counted = std::make_shared<int>(0);
+   {
+      auto queue = queue_api::CreateQueue<mpmc::segmented_queue<std::shared_ptr<int>, 4>>();
+      auto producer = std::get<queue_api::index::sender>(queue);
+      for (int i = 0; i < 10; ++i) {
+         auto item = counted;
+         EXPECT_TRUE(producer.push(item));
+      }
+      EXPECT_EQ(11, counted.use_count());
+   }
+   EXPECT_EQ(1, counted.use_count());
+}
+
+TEST(SegmentedQueue, DrainThenClosed) {
+   auto queue = queue_api::CreateQueue<QType>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item = "hello";
+   EXPECT_TRUE(producer.push(item));
+   producer.close();
+   EXPECT_TRUE(consumer.closed());
+
+   item = "too late";
+   EXPECT_TRUE(producer.push(item).closed());
+   EXPECT_EQ("too late", item);
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("hello", item);
+   EXPECT_TRUE(consumer.pop(item).closed());
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(0)).closed());
+}
+
+TEST(SegmentedQueue, CloseWakesParkedConsumer) {
+   auto queue = queue_api::CreateQueue<QType>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::thread closing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      producer.close();
+   });
+   benchmark::stopwatch watch;
+   std::string item;
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(10 * 1000)).closed());
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   closing.join();
+}
+
+TEST(SegmentedQueue, WaitAndPopTimesOut) {
+   auto queue = queue_api::CreateQueue<QType>();
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item;
+   benchmark::stopwatch watch;
+   auto popped = consumer.wait_and_pop(item, std::chrono::milliseconds(50));
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   EXPECT_LE(50, watch.elapsed_ms());
+}
+
+// segments are recycled: the footprint follows the live items, not the items pushed so far
+TEST(SegmentedQueue, MemoryStaysBounded) {
+   mpmc::segmented_queue<int, 16> queue;
+   for (int round = 0; round < 1000; ++round) {
+      for (int i = 0; i < 64; ++i) {
+         EXPECT_TRUE(queue.push(i));
+      }
+      int item = 0;
+      for (int i = 0; i < 64; ++i) {
+         EXPECT_TRUE(queue.pop(item));
+         EXPECT_EQ(i, item);
+      }
+   }
+   // 64 live items are 4-5 segments, a couple more wait for the epoch, at most 4 are spare
+   EXPECT_GE(size_t{12}, queue.allocated_segments());
+}
+
+// threads that exit give their reclamation record back, they do not hold back the epoch
+TEST(SegmentedQueue, ExitedThreadsDoNotStopReclamation) {
+   mpmc::segmented_queue<int, 16> queue;
+   std::vector<std::thread> threads;
+   for (int t = 0; t < 16; ++t) {
+      threads.emplace_back([&queue] {
+         int item = 1;
+         EXPECT_TRUE(queue.push(item));
+      });
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   int item = 0;
+   for (int round = 0; round < 1000; ++round) {
+      while (queue.pop(item)) {
+      }
+      for (int i = 0; i < 16; ++i) {
+         EXPECT_TRUE(queue.push(i));
+      }
+   }
+   EXPECT_GE(size_t{12}, queue.allocated_segments());
+}
+
+TEST(SegmentedQueue, ManyProducersManyConsumers) {
+   const int kProducers = 4;
+   const int kConsumers = 4;
+   const uint64_t kPerProducer = 20000;
+   auto queue = queue_api::CreateQueue<mpmc::segmented_queue<uint64_t, 32>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::atomic<int> running{kProducers};
+   std::atomic<uint64_t> sum{0};
+   std::atomic<uint64_t> count{0};
+   std::vector<std::thread> threads;
+   for (int p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, producer]() mutable {
+         for (uint64_t i = 1; i <= kPerProducer; ++i) {
+            uint64_t item = i;
+            EXPECT_TRUE(producer.push(item));
+         }
+         if (1 == running.fetch_sub(1)) {
+            producer.close();
+         }
+      });
+   }
+   for (int c = 0; c < kConsumers; ++c) {
+      threads.emplace_back([&, consumer]() mutable {
+         for (auto value : consumer) {
+            sum += value;
+            ++count;
+         }
+      });
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kPerProducer, count.load());
+   EXPECT_EQ(kProducers * kPerProducer * (kPerProducer + 1) / 2, sum.load());
+   EXPECT_TRUE(consumer.empty());
+}
+
+TEST(EpochReclamation, AdvancesOnlyPastPinnedThreads) {
+   const uint64_t stamp = reclamation::retire_stamp();
+   std::atomic<bool> pinned{false};
+   std::atomic<bool> release{false};
+   std::thread reader([&] {
+      reclamation::epoch_guard guard;
+      pinned = true;
+      while (!release.load()) {
+         std::this_thread::yield();
+      }
+   });
+   while (!pinned.load()) {
+      std::this_thread::yield();
+   }
+   for (int i = 0; i < 10; ++i) {
+      EXPECT_FALSE(reclamation::safe_to_free(stamp));
+   }
+   release = true;
+   reader.join();
+   EXPECT_TRUE(reclamation::safe_to_free(stamp) || reclamation::safe_to_free(stamp));
+}
@@ -0,0 +1,241 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/mpsc_linked_queue.hpp"
+#include "q/q_api.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   struct message : mpsc::intrusive_node {
+      explicit message(int v = 0) :
+          value(v) {}
+      int value;
+   };
+}  // namespace
+
+TEST(LinkedQueue, PushPopInOrder) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<std::string>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_FALSE(producer.full());
+   EXPECT_TRUE(producer.lock_free());
+
+   std::string item;
+   EXPECT_FALSE(consumer.pop(item));
+   for (auto text : {"hello", "world", "!"}) {
+      item = text;
+      EXPECT_TRUE(producer.push(item));
+   }
+   EXPECT_FALSE(consumer.empty());
+   EXPECT_EQ(size_t{3}, consumer.size());
+   for (auto text : {"hello", "world", "!"}) {
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(text, item);
+   }
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_EQ(size_t{0}, consumer.size());
+}
+
+TEST(LinkedQueue, MoveUnique) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<std::unique_ptr<std::string>>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   auto arg = std::make_unique<std::string>("hello");
+   EXPECT_TRUE(producer.push(arg));
+   EXPECT_TRUE(nullptr == arg);
+   EXPECT_TRUE(consumer.pop(arg));
+   EXPECT_EQ("hello", *arg);
+}
+
+TEST(LinkedQueue, DrainThenClosed) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<std::string>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item = "hello";
+   EXPECT_TRUE(producer.push(item));
+   producer.close();
+   producer.close();  // once is enough, twice does no harm
+   EXPECT_TRUE(consumer.closed());
+
+   item = "too late";
+   auto pushed = producer.push(item);
+   EXPECT_TRUE(pushed.closed());
+   EXPECT_EQ("too late", item);
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("hello", item);
+   auto popped = consumer.pop(item);
+   EXPECT_FALSE(popped);
+   EXPECT_TRUE(popped.closed());
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(0)).closed());
+}
+
+TEST(LinkedQueue, WaitAndPopTimesOut) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<std::string>>();
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item;
+   benchmark::stopwatch watch;
+   auto popped = consumer.wait_and_pop(item, std::chrono::milliseconds(50));
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   EXPECT_LE(50, watch.elapsed_ms());
+}
+
+TEST(LinkedQueue, PushWakesParkedConsumer) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<int>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::thread pushing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int item = 42;
+      EXPECT_TRUE(producer.push(item));
+   });
+   benchmark::stopwatch watch;
+   int item = 0;
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(10 * 1000)));
+   EXPECT_EQ(42, item);
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   pushing.join();
+}
+
+TEST(LinkedQueue, CloseWakesParkedConsumer) {
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<int>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::thread closing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      producer.close();
+   });
+   benchmark::stopwatch watch;
+   int item = 0;
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(10 * 1000)).closed());
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   closing.join();
+}
+
+TEST(LinkedQueue, IntrusiveHandsBackTheSameNodes) {
+   auto queue = queue_api::CreateQueue<mpsc::intrusive_linked_queue<message>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   message messages[3];  // non-copyable, the queue links them in place
+   for (int i = 0; i < 3; ++i) {
+      messages[i].value = i + 1;
+   }
+   for (auto& m : messages) {
+      message* item = &m;
+      EXPECT_TRUE(producer.push(item));
+   }
+   EXPECT_EQ(size_t{3}, consumer.size());
+   message* popped = nullptr;
+   for (auto& m : messages) {
+      EXPECT_TRUE(consumer.pop(popped));
+      EXPECT_EQ(&m, popped);
+   }
+   EXPECT_FALSE(consumer.pop(popped));
+
+   // a node can be pushed again once popped
+   message* item = &messages[0];
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_TRUE(consumer.pop(popped));
+   EXPECT_EQ(1, popped->value);
+}
+
+TEST(LinkedQueue, ManyProducersRangeFor) {
+   const int kProducers = 8;
+   const uint64_t kPerProducer = 20000;
+   auto queue = queue_api::CreateQueue<mpsc::linked_queue<uint64_t>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::atomic<int> running{kProducers};
+   std::vector<std::thread> threads;
+   for (int p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, producer]() mutable {
+         for (uint64_t i = 1; i <= kPerProducer; ++i) {
+            uint64_t item = i;
+            EXPECT_TRUE(producer.push(item));
+         }
+         if (1 == running.fetch_sub(1)) {
+            producer.close();
+         }
+      });
+   }
+   uint64_t sum = 0;
+   uint64_t count = 0;
+   for (auto value : consumer) {
+      sum += value;
+      ++count;
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kPerProducer, count);
+   EXPECT_EQ(kProducers * kPerProducer * (kPerProducer + 1) / 2, sum);
+   EXPECT_TRUE(consumer.empty());
+}
+
+// producers read size/usage while the consumer hands nodes back, the count is a snapshot and
+// never walks nodes that are being recycled
+TEST(LinkedQueue, ProducersReadSizeWhileNodesAreRecycled) {
+   const int kProducers = 4;
+   const int kNodesPerProducer = 8;
+   const int kRounds = 20000;
+   auto queue = queue_api::CreateQueue<mpsc::intrusive_linked_queue<message>>();
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   const size_t kMaxInQueue = kProducers * kNodesPerProducer;
+
+   std::vector<std::unique_ptr<std::atomic<bool>>> in_queue;  // a node is pushed again once popped
+   std::vector<message> nodes(kMaxInQueue);
+   for (size_t i = 0; i < kMaxInQueue; ++i) {
+      nodes[i].value = static_cast<int>(i);
+      in_queue.push_back(std::make_unique<std::atomic<bool>>(false));
+   }
+   std::atomic<int> running{kProducers};
+   std::vector<std::thread> threads;
+   for (int p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, p, producer]() mutable {
+         for (int round = 0; round < kRounds; ++round) {
+            const size_t index = p * kNodesPerProducer + round % kNodesPerProducer;
+            while (in_queue[index]->load()) {
+               EXPECT_GE(kMaxInQueue, producer.size());
+               EXPECT_GE(size_t{100}, producer.usage());
+               std::this_thread::yield();
+            }
+            in_queue[index]->store(true);
+            message* item = &nodes[index];
+            EXPECT_TRUE(producer.push(item));
+         }
+         if (1 == running.fetch_sub(1)) {
+            producer.close();
+         }
+      });
+   }
+   int popped = 0;
+   for (auto node : consumer) {
+      in_queue[node->value]->store(false);
+      ++popped;
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kRounds, popped);
+   EXPECT_EQ(size_t{0}, consumer.size());
+}
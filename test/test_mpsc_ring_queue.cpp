@@ -0,0 +1,215 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/mpsc_ring_queue.hpp"
+#include "q/q_api.hpp"
+#include "q/readiness.hpp"
+
+namespace {
+   struct counting_observer : readiness::observer {
+      void notify() override { ++notified; }
+      std::atomic<int> notified{0};
+   };
+}  // namespace
+
+TEST(RingQueue, PushPopInOrder) {
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<std::string>>(3);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_FALSE(producer.full());
+   EXPECT_TRUE(producer.lock_free());
+   EXPECT_EQ(size_t{3}, producer.capacity());
+
+   std::string item;
+   EXPECT_FALSE(consumer.pop(item));
+   for (auto text : {"hello", "world", "!"}) {
+      item = text;
+      EXPECT_TRUE(producer.push(item));
+   }
+   EXPECT_TRUE(producer.full());
+   EXPECT_EQ(size_t{3}, consumer.size());
+   EXPECT_EQ(size_t{0}, producer.capacity_free());
+   EXPECT_EQ(size_t{100}, producer.usage());
+   item = "no room";
+   auto pushed = producer.push(item);
+   EXPECT_FALSE(pushed);
+   EXPECT_FALSE(pushed.closed());
+   EXPECT_EQ("no room", item);
+
+   for (auto text : {"hello", "world", "!"}) {
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(text, item);
+   }
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_EQ(size_t{0}, consumer.size());
+}
+
+TEST(RingQueue, WrapsAround) {
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<int>>(3);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   for (int i = 0; i < 100; ++i) {
+      int item = i;
+      EXPECT_TRUE(producer.push(item));
+      item = i + 1000;
+      EXPECT_TRUE(producer.push(item));
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(i, item);
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(i + 1000, item);
+   }
+   EXPECT_TRUE(consumer.empty());
+}
+
+TEST(RingQueue, MoveUnique) {
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<std::unique_ptr<std::string>>>(2);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   auto arg = std::make_unique<std::string>("hello");
+   EXPECT_TRUE(producer.push(arg));
+   EXPECT_TRUE(nullptr == arg);
+   EXPECT_TRUE(consumer.pop(arg));
+   EXPECT_EQ("hello", *arg);
+}
+
+TEST(RingQueue, DrainThenClosed) {
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<std::string>>(10);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item = "hello";
+   EXPECT_TRUE(producer.push(item));
+   producer.close();
+   producer.close();  // once is enough, twice does no harm
+   EXPECT_TRUE(consumer.closed());
+
+   item = "too late";
+   EXPECT_TRUE(producer.push(item).closed());
+   EXPECT_EQ("too late", item);
+   EXPECT_EQ(size_t{1}, consumer.size());
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("hello", item);
+   EXPECT_TRUE(consumer.pop(item).closed());
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(0)).closed());
+}
+
+TEST(RingQueue, NotifiesWhenTheConsumerCaughtUp) {
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<int>>(10);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   counting_observer observer;
+   consumer.attach(&observer);
+
+   int item = 1;
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_EQ(1, observer.notified.load());
+   EXPECT_TRUE(producer.push(item));  // the consumer has not caught up, no wakeup
+   EXPECT_EQ(1, observer.notified.load());
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_EQ(2, observer.notified.load());
+   producer.close();
+   EXPECT_EQ(3, observer.notified.load());
+   consumer.attach(nullptr);
+}
+
+// every push that succeeded is delivered, also the ones racing with the close
+TEST(RingQueue, CloseLosesNoAcceptedPush) {
+   const int kProducers = 4;
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<int>>(64);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::atomic<uint64_t> accepted{0};
+   std::vector<std::thread> threads;
+   for (int p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, producer]() mutable {
+         for (;;) {
+            int item = 1;
+            auto pushed = producer.push(item);
+            if (pushed.closed()) {
+               return;
+            }
+            if (pushed) {
+               ++accepted;
+            } else {
+               std::this_thread::yield();
+            }
+         }
+      });
+   }
+   std::thread closing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      producer.close();
+   });
+
+   uint64_t received = 0;
+   for (auto value : consumer) {
+      received += value;
+   }
+   closing.join();
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_LT(uint64_t{0}, received);
+   EXPECT_EQ(accepted.load(), received);
+}
+
+TEST(RingQueue, ManyProducersKeepTheirOrder) {
+   const int kProducers = 8;
+   const uint64_t kPerProducer = 20000;
+   auto queue = queue_api::CreateQueue<mpsc::ring_queue<uint64_t>>(128);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::atomic<int> running{kProducers};
+   std::vector<std::thread> threads;
+   for (uint64_t p = 0; p < kProducers; ++p) {
+      threads.emplace_back([&, p, producer]() mutable {
+         for (uint64_t i = 1; i <= kPerProducer; ++i) {
+            uint64_t item = (p << 32) | i;
+            while (!producer.push(item)) {
+               std::this_thread::yield();
+            }
+         }
+         if (1 == running.fetch_sub(1)) {
+            producer.close();
+         }
+      });
+   }
+   std::vector<uint64_t> last(kProducers, 0);
+   uint64_t count = 0;
+   for (auto value : consumer) {
+      const uint64_t p = value >> 32;
+      const uint64_t i = value & 0xFFFFFFFF;
+      ASSERT_GT(uint64_t{kProducers}, p);
+      EXPECT_EQ(last[p] + 1, i);  // global FIFO keeps each producer's order
+      last[p] = i;
+      ++count;
+   }
+   for (auto& t : threads) {
+      t.join();
+   }
+   EXPECT_EQ(kProducers * kPerProducer, count);
+   EXPECT_TRUE(consumer.empty());
+}
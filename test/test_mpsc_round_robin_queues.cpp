@@ -196,4 +196,57 @@ TEST(MultipleProducers_SingleConsumer, usage) {
 
    s2.push(arg);
    EXPECT_EQ(100, consumer.usage());
-}
\ No newline at end of file
+}
+
+TEST(MultipleProducers_SingleConsumer, StaticRoundRobinWraps) {
+   using qtype = spsc::circular_fifo<std::string>;
+   using power_of_two = mpsc::static_size::round_robin::Receiver<qtype, 4>;
+   using odd = mpsc::static_size::round_robin::Receiver<qtype, 3>;
+   EXPECT_EQ(1, power_of_two::increment(0));
+   EXPECT_EQ(0, power_of_two::increment(3));
+   EXPECT_EQ(2, odd::increment(1));
+   EXPECT_EQ(0, odd::increment(2));
+}
+
+TEST(MultipleProducers_SingleConsumer, StaticPopIsFairAndClosesWithAllLanes) {
+   using qtype = spsc::circular_fifo<std::string>;
+   auto lanes = round_robin::CreateLanes<qtype, 3>(2);
+   auto& senders = lanes.first;
+   mpsc::static_size::round_robin::Receiver<qtype, 3> consumer(lanes.second);
+   EXPECT_EQ(6, consumer.capacity());
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_TRUE(consumer.lock_free());
+
+   std::string arg = "s0";
+   senders[0].push(arg);
+   std::string recv;
+   EXPECT_TRUE(consumer.pop(recv));
+   EXPECT_EQ("s0", recv);
+
+   arg = "a";
+   senders[0].push(arg);
+   arg = "b";
+   senders[1].push(arg);
+   arg = "c";
+   senders[2].push(arg);
+   EXPECT_EQ(3, consumer.size());
+   EXPECT_EQ(50, consumer.usage());
+   for (auto expected : {"b", "c", "a"}) {  // lane 0 was served last
+      EXPECT_TRUE(consumer.pop(recv));
+      EXPECT_EQ(expected, recv);
+   }
+   EXPECT_FALSE(consumer.pop(recv));
+
+   senders[0].close();
+   senders[1].close();
+   auto popped = consumer.pop(recv);
+   EXPECT_FALSE(popped);
+   EXPECT_FALSE(popped.closed());
+   arg = "last";
+   senders[2].push(arg);
+   senders[2].close();
+   EXPECT_TRUE(consumer.wait_and_pop(recv, std::chrono::milliseconds(0)));
+   EXPECT_EQ("last", recv);
+   EXPECT_TRUE(consumer.pop(recv).closed());
+   EXPECT_TRUE(consumer.closed());
+}
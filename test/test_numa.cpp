@@ -0,0 +1,94 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "q/flat_lanes.hpp"
+#include "q/numa.hpp"
+#include "q/q_api.hpp"
+
+TEST(Numa, TopologyIsSane) {
+   const int nodes = numa::node_count();
+   EXPECT_LE(1, nodes);
+   EXPECT_LE(0, numa::this_node());
+   EXPECT_GT(nodes, numa::this_node());
+   EXPECT_GT(nodes, numa::node_of_cpu(0));
+}
+
+TEST(Numa, CircularFifoOnThisNode) {
+   const int node = numa::this_node();
+   numa::allocator<int> memory(node);
+   auto queue = queue_api::CreateQueue<spsc::numa::circular_fifo<int>>(1000, memory);
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+
+   auto where = memory.placement();  // copies of the allocator share the report
+   EXPECT_EQ(node, where.requested);
+   if (numa::node_count() == 1) {
+      EXPECT_FALSE(where.bound);  // nothing to choose from
+      EXPECT_EQ(0, where.node);
+   } else if (where.bound) {
+      EXPECT_EQ(node, where.node);
+   }
+
+   for (int i = 0; i < 1000; ++i) {
+      EXPECT_TRUE(sender.push(i));
+   }
+   int item = 1000;
+   EXPECT_FALSE(sender.push(item));
+   for (int i = 0; i < 1000; ++i) {
+      EXPECT_TRUE(receiver.pop(item));
+      EXPECT_EQ(i, item);
+   }
+}
+
+// a node that does not exist is not an error, the memory is allocated as usual
+TEST(Numa, MissingNodeDegrades) {
+   const int missing = numa::node_count() + 7;
+   numa::allocator<uint64_t> memory(missing);
+   std::vector<uint64_t, numa::allocator<uint64_t>> values(100000, 1, memory);
+   EXPECT_EQ(missing, memory.placement().requested);
+   EXPECT_FALSE(memory.placement().bound);
+   uint64_t sum = 0;
+   for (auto value : values) {
+      sum += value;
+   }
+   EXPECT_EQ(uint64_t{100000}, sum);
+}
+
+TEST(Numa, FlatLanesReportPlacement) {
+   auto anywhere = mpsc::flat::CreateLanes<int>(2, 16);
+   EXPECT_EQ(numa::kAnyNode, anywhere.second.placement().requested);
+
+   const int node = numa::this_node();
+   auto queues = spmc::flat::CreateLanes<int>(2, 16, node);
+   auto& sender = queues.first;
+   auto& receivers = queues.second;
+   EXPECT_EQ(node, sender.placement().requested);
+   EXPECT_EQ(node, receivers[1].placement().requested);
+   for (int i = 0; i < 4; ++i) {
+      EXPECT_TRUE(sender.push(i));
+   }
+   int item = -1;
+   EXPECT_TRUE(receivers[1].pop(item));
+   EXPECT_EQ(1, item);
+}
+
+TEST(Numa, PinToThisNode) {
+   std::thread pinned([] {
+      const int node = numa::this_node();
+      if (numa::pin_this_thread(node)) {
+         EXPECT_EQ(node, numa::this_node());
+      }
+   });
+   pinned.join();
+}
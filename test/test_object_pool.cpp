@@ -0,0 +1,122 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/object_pool.hpp"
+#include "q/q_api.hpp"
+#include "q/spsc_circular_fifo.hpp"
+
+namespace {
+   using Pooled = pool::pooled_ptr<std::string>;
+}
+
+TEST(ObjectPool, AcquireUntilEmpty) {
+   pool::object_pool<std::string> strings(3);
+   EXPECT_EQ(size_t{3}, strings.capacity());
+   EXPECT_EQ(size_t{3}, strings.available());
+
+   std::set<std::string*> handed_out;
+   std::vector<Pooled> in_use;
+   for (int i = 0; i < 3; ++i) {
+      in_use.push_back(strings.acquire());
+      ASSERT_TRUE(nullptr != in_use.back());
+      handed_out.insert(in_use.back().get());
+   }
+   EXPECT_EQ(size_t{3}, handed_out.size());
+   EXPECT_EQ(size_t{0}, strings.available());
+   EXPECT_TRUE(nullptr == strings.acquire());
+
+   in_use.pop_back();  // released on the producer thread
+   EXPECT_EQ(size_t{1}, strings.available());
+   auto again = strings.acquire();
+   ASSERT_TRUE(nullptr != again);
+   EXPECT_EQ(size_t{1}, handed_out.count(again.get()));
+}
+
+TEST(ObjectPool, ObjectsAreReusedAsIs) {
+   pool::object_pool<std::string> strings(1);
+   auto first = strings.acquire();
+   auto* address = first.get();
+   *first = "hello";
+   first.reset();
+
+   auto second = strings.acquire();
+   EXPECT_EQ(address, second.get());
+   EXPECT_EQ("hello", *second);
+}
+
+// same as Queue.circular_fifoQ_MoveUnique but with pooled pointers
+TEST(ObjectPool, MovePooledThroughQueue) {
+   pool::object_pool<std::string> strings(4);
+   auto queue = queue_api::CreateQueue<spsc::circular_fifo<Pooled>>(2);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   auto arg = strings.acquire();
+   *arg = "hello";
+   EXPECT_TRUE(producer.push(arg));
+   ASSERT_TRUE(nullptr == arg);
+
+   arg = strings.acquire();
+   *arg = "world";
+   EXPECT_TRUE(producer.push(arg));
+   ASSERT_TRUE(nullptr == arg);
+
+   arg = strings.acquire();
+   *arg = "!";
+   EXPECT_FALSE(producer.push(arg));
+   ASSERT_FALSE(nullptr == arg);
+   EXPECT_EQ("!", *arg);
+
+   Pooled received;
+   EXPECT_TRUE(consumer.pop(received));
+   EXPECT_EQ("hello", *received);
+}
+
+TEST(ObjectPool, ReturnedByTheConsumerThread) {
+   const size_t kObjects = 8;
+   const int kMessages = 100000;
+   pool::object_pool<std::string> strings(kObjects);
+   auto queue = queue_api::CreateQueue<spsc::circular_fifo<Pooled>>(kObjects);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::set<std::string*> addresses;
+   std::thread receiving([&]() {
+      int expected = 0;
+      for (auto& item : consumer) {
+         EXPECT_EQ(std::to_string(expected), *item);
+         ++expected;
+      }
+      EXPECT_EQ(kMessages, expected);
+   });
+
+   for (int i = 0; i < kMessages; ++i) {
+      auto item = strings.acquire();
+      while (!item) {
+         std::this_thread::yield();
+         item = strings.acquire();
+      }
+      addresses.insert(item.get());
+      *item = std::to_string(i);
+      while (!producer.push(item)) {
+         std::this_thread::yield();
+      }
+   }
+   producer.close();
+   receiving.join();
+
+   EXPECT_GE(kObjects, addresses.size());  // no other objects than the pooled ones
+   EXPECT_EQ(kObjects, strings.available());
+}
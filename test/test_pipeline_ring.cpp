@@ -0,0 +1,158 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/pipeline_ring.hpp"
+
+namespace {
+   struct Item {
+      uint64_t raw = 0;
+      uint64_t decoded = 0;
+      uint64_t left = 0;
+      uint64_t right = 0;
+   };
+}  // namespace
+
+TEST(PipelineRing, Initialization) {
+   pipeline::ring<std::string> ring(10);
+   auto first = ring.add_stage();
+   EXPECT_EQ(0, first);
+   EXPECT_EQ(1, ring.stages());
+   EXPECT_TRUE(ring.empty());
+   EXPECT_FALSE(ring.full());
+   EXPECT_EQ(10, ring.capacity());
+   EXPECT_EQ(10, ring.capacity_free());
+   EXPECT_EQ(0, ring.size());
+   EXPECT_EQ(0, ring.usage());
+   EXPECT_TRUE(ring.lock_free());
+}
+
+// a stage can only follow a stage that exists, anything else would leave it gated by the producer only
+TEST(PipelineRing, RejectsUnknownDependency) {
+   pipeline::ring<std::string> ring(10);
+   auto first = ring.add_stage();
+   EXPECT_THROW(ring.add_stage({first + 1}), std::invalid_argument);  // itself, a forward reference
+   EXPECT_THROW(ring.add_stage({first, 42}), std::invalid_argument);
+   EXPECT_EQ(1, ring.stages());  // nothing was added
+
+   auto second = ring.add_stage({first});
+   EXPECT_EQ(1, second);
+   std::string item = "hello";
+   EXPECT_TRUE(ring.push(item));
+   EXPECT_EQ(0, ring.process(second, [](std::string&) {}));  // still gated by 'first'
+}
+
+TEST(PipelineRing, ItemStaysInSlotThroughStages) {
+   pipeline::ring<std::string> ring(2);
+   auto decode = ring.add_stage();
+   auto enrich = ring.add_stage({decode});
+
+   std::string arg = "hello";
+   EXPECT_TRUE(ring.push(arg));
+   EXPECT_TRUE(arg.empty());
+   arg = "world";
+   EXPECT_TRUE(ring.push(arg));
+   arg.assign(1, '!');  // not a char* assignment: GCC -Wrestrict false positive under C++20
+   EXPECT_FALSE(ring.push(arg));  // full, nothing released yet
+   EXPECT_EQ("!", arg);
+   EXPECT_TRUE(ring.full());
+
+   // enrich depends on decode, it cannot run ahead
+   EXPECT_EQ(0, ring.process(enrich, [](std::string&) {}));
+   EXPECT_EQ(2, ring.process(decode, [](std::string& s) { s += "-decoded"; }));
+   EXPECT_TRUE(ring.full());  // enrich still holds the slots
+
+   std::vector<std::string> seen;
+   EXPECT_EQ(2, ring.process(enrich, [&](std::string& s) { seen.push_back(s); }));
+   ASSERT_EQ(2, seen.size());
+   EXPECT_EQ("hello-decoded", seen[0]);
+   EXPECT_EQ("world-decoded", seen[1]);
+   EXPECT_TRUE(ring.empty());
+   EXPECT_TRUE(ring.push(arg));
+}
+
+TEST(PipelineRing, StatsCountProcessedAndLag) {
+   pipeline::ring<int> ring(10);
+   auto first = ring.add_stage();
+   auto second = ring.add_stage({first});
+   for (int i = 0; i < 5; ++i) {
+      EXPECT_TRUE(ring.push(i));
+   }
+   EXPECT_EQ(3, ring.process(first, [](int&) {}, 3));
+   auto stats = ring.stats(first);
+   EXPECT_EQ(3, stats.processed);
+   EXPECT_EQ(2, stats.lag);
+   EXPECT_EQ(1, stats.batches);
+
+   stats = ring.stats(second);
+   EXPECT_EQ(0, stats.processed);
+   EXPECT_EQ(5, stats.lag);
+   EXPECT_EQ(0, stats.batches);
+   EXPECT_EQ(5, ring.size());
+}
+
+TEST(PipelineRing, DiamondTopologyThreaded) {
+   // decode -> {left, right} -> persist
+   const uint64_t kItems = 200000;
+   pipeline::ring<Item> ring(64);
+   auto decode = ring.add_stage();
+   auto left = ring.add_stage({decode});
+   auto right = ring.add_stage({decode});
+   auto persist = ring.add_stage({left, right});
+
+   auto run_stage = [&ring](size_t stage, auto handler) {
+      uint64_t count = 0;
+      while (count < kItems) {
+         size_t processed = ring.process(stage, handler);
+         if (processed == 0) {
+            std::this_thread::yield();
+         }
+         count += processed;
+      }
+   };
+
+   std::atomic<uint64_t> errors{0};
+   uint64_t sum = 0;
+   std::thread t_decode(run_stage, decode, [](Item& item) { item.decoded = item.raw * 2; });
+   std::thread t_left(run_stage, left, [](Item& item) { item.left = item.decoded + 1; });
+   std::thread t_right(run_stage, right, [](Item& item) { item.right = item.decoded + 2; });
+   std::thread t_persist(run_stage, persist, [&](Item& item) {
+      if (item.left != item.raw * 2 + 1 || item.right != item.raw * 2 + 2) {
+         ++errors;
+      }
+      sum += item.raw;
+   });
+
+   for (uint64_t i = 1; i <= kItems; ++i) {
+      Item item;
+      item.raw = i;
+      while (!ring.push(item)) {
+         std::this_thread::yield();
+      }
+   }
+
+   t_decode.join();
+   t_left.join();
+   t_right.join();
+   t_persist.join();
+   EXPECT_EQ(0, errors.load());
+   EXPECT_EQ(kItems * (kItems + 1) / 2, sum);
+   EXPECT_TRUE(ring.empty());
+   for (size_t stage = 0; stage < ring.stages(); ++stage) {
+      EXPECT_EQ(kItems, ring.stats(stage).processed);
+      EXPECT_EQ(0, ring.stats(stage).lag);
+   }
+}
@@ -12,7 +12,13 @@
 #include <q/mpmc.hpp>
 #include <q/q_api.hpp>
 #include <q/spsc.hpp>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 #include "stopwatch.hpp"
 
 using namespace std;
@@ -141,6 +147,13 @@ TEST(Queue, BaseAPI_DynamicLocked) {
    EXPECT_EQ(0, producer.usage());
 }
 
+TEST(Queue, DynamicLockedRejectsNegativeSize) {
+   EXPECT_THROW(LockedQ queue(-2), std::invalid_argument);
+   EXPECT_THROW(LockedQ queue(std::numeric_limits<int>::min()), std::invalid_argument);
+   LockedQ unbounded(-1);
+   EXPECT_TRUE(unbounded.empty());
+}
+
 TEST(Queue, SFINAE_HasWaitAndPop) {
    auto queue = queue_api::CreateQueue<HasWaitAndPop>();
    auto consumer = std::get<queue_api::index::receiver>(queue);
@@ -368,3 +381,174 @@ TEST(Queue, LockedQ_NoMoveUnique) {
    auto consumer = std::get<queue_api::index::receiver>(queue);
    NoMovePtrArgument(producer, consumer);
 }
+
+TEST(Queue, LockedQ_PopAll) {
+   for (int max_size : {-1, 5}) {
+      auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(max_size);
+      auto producer = std::get<queue_api::index::sender>(queue);
+      auto consumer = std::get<queue_api::index::receiver>(queue);
+      std::vector<int> out;
+      EXPECT_EQ(size_t{0}, consumer.pop_all(out));
+
+      for (int round = 0; round < 3; ++round) {  // the bounded ring wraps around
+         for (int i = 0; i < 4; ++i) {
+            EXPECT_TRUE(producer.push(i));
+         }
+         out.clear();
+         EXPECT_EQ(size_t{4}, consumer.pop_all(out));
+         EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), out);
+         EXPECT_TRUE(consumer.empty());
+      }
+   }
+}
+
+namespace {
+   // no default constructor, counts the live instances
+   struct Counted {
+      static int live;
+      int value;
+      explicit Counted(int v) : value(v) { ++live; }
+      Counted(Counted&& other) : value(other.value) { ++live; }
+      Counted& operator=(Counted&& other) {
+         value = other.value;
+         return *this;
+      }
+      ~Counted() { --live; }
+   };
+   int Counted::live = 0;
+}  // namespace
+
+TEST(Queue, LockedQ_NoDefaultConstructor) {
+   {
+      mpmc::lock_queue<Counted> queue(3);
+      EXPECT_EQ(0, Counted::live);  // the slots are raw until pushed to
+      for (int round = 0; round < 2; ++round) {  // the ring wraps around
+         for (int i = 0; i < 3; ++i) {
+            Counted item(i);
+            EXPECT_TRUE(queue.push(item));
+         }
+         Counted popped(-1);
+         EXPECT_TRUE(queue.pop(popped));
+         EXPECT_EQ(0, popped.value);
+         std::vector<Counted> out;
+         EXPECT_EQ(size_t{2}, queue.pop_all(out));
+         EXPECT_EQ(2, out.back().value);
+      }
+      EXPECT_EQ(0, Counted::live);
+
+      Counted item(7);
+      EXPECT_TRUE(queue.push(item));
+      EXPECT_EQ(2, Counted::live);
+   }
+   EXPECT_EQ(0, Counted::live);  // the destructor destroys what is left in the ring
+}
+
+TEST(Queue, LockedQ_PopAllSwapsUnbounded) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<std::string>>(-1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::string item = "hello";
+   EXPECT_TRUE(producer.push(item));
+   item = "world";
+   EXPECT_TRUE(producer.push(item));
+
+   std::deque<std::string> out;
+   EXPECT_EQ(size_t{2}, consumer.pop_all(out));
+   EXPECT_EQ("hello", out.front());
+   EXPECT_EQ("world", out.back());
+   EXPECT_TRUE(consumer.empty());
+
+   item = "!";
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_EQ(size_t{1}, consumer.pop_all(out));  // 'out' is not empty: appended to
+   EXPECT_EQ(size_t{3}, out.size());
+   EXPECT_EQ("!", out.back());
+}
+
+TEST(Queue, LockedQ_PushWakesParkedConsumer) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(10);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   std::thread pushing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int item = 42;
+      producer.push(item);
+   });
+   int item = 0;
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(10 * 1000)));
+   EXPECT_EQ(42, item);
+   pushing.join();
+}
+
+TEST(Queue, LockedQ_WaitAndPushTimesOutWhenFull) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   int item = 1;
+   EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(0)));
+   benchmark::stopwatch watch;
+   auto pushed = producer.wait_and_push(item, std::chrono::milliseconds(50));
+   EXPECT_FALSE(pushed);
+   EXPECT_FALSE(pushed.closed());
+   EXPECT_LE(50, watch.elapsed_ms());
+}
+
+TEST(Queue, LockedQ_PopWakesParkedProducer) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   int item = 1;
+   EXPECT_TRUE(producer.push(item));
+
+   std::thread popping([consumer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int popped = 0;
+      EXPECT_TRUE(consumer.pop(popped));
+      EXPECT_EQ(1, popped);
+   });
+   benchmark::stopwatch watch;
+   item = 2;
+   EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)));
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   popping.join();
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ(2, item);
+}
+
+TEST(Queue, LockedQ_OnePopWakesParkedProducer) {
+   // one pop off a full queue is enough, the producer does not wait for the queue to drain
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(8);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   for (int item = 0; item < 8; ++item) {
+      EXPECT_TRUE(producer.push(item));
+   }
+
+   std::thread popping([consumer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      int popped = -1;
+      EXPECT_TRUE(consumer.pop(popped));
+      EXPECT_EQ(0, popped);
+   });
+   benchmark::stopwatch watch;
+   int item = 8;
+   EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)));
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   popping.join();
+   EXPECT_EQ(size_t{8}, consumer.size());
+}
+
+TEST(Queue, LockedQ_CloseWakesParkedProducer) {
+   auto queue = queue_api::CreateQueue<mpmc::lock_queue<int>>(1);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   int item = 1;
+   EXPECT_TRUE(producer.push(item));
+
+   std::thread closing([producer]() mutable {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      producer.close();
+   });
+   benchmark::stopwatch watch;
+   EXPECT_TRUE(producer.wait_and_push(item, std::chrono::milliseconds(10 * 1000)).closed());
+   EXPECT_GT(5 * 1000, watch.elapsed_ms());
+   closing.join();
+}
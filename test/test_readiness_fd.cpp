@@ -0,0 +1,121 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#if !defined(_WIN32)
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/mpmc.hpp"
+#include "q/mpsc_fixed_receiver_round_robin.hpp"
+#include "q/q_api.hpp"
+#include "q/readiness_fd.hpp"
+#include "q/spsc.hpp"
+
+namespace {
+   bool readable(int fd, int timeout_ms = 0) {
+      pollfd item{fd, POLLIN, 0};
+      return (1 == poll(&item, 1, timeout_ms)) && (item.revents & POLLIN);
+   }
+
+   template <typename QType>
+   void BecomesReadableOnEmptyToNonEmpty() {
+      readiness::fd_notifier notifier;
+      ASSERT_TRUE(notifier.valid());
+      auto queue = queue_api::CreateQueue<QType>(10);
+      auto sender = std::get<queue_api::index::sender>(queue);
+      auto receiver = std::get<queue_api::index::receiver>(queue);
+      receiver.attach(&notifier);
+      EXPECT_FALSE(readable(notifier.fd()));
+
+      std::string value = "1";
+      EXPECT_TRUE(sender.push(value));
+      EXPECT_TRUE(readable(notifier.fd()));
+      EXPECT_EQ(1, notifier.signals());
+
+      // already non-empty, no more signals
+      value = "2";
+      EXPECT_TRUE(sender.push(value));
+      EXPECT_EQ(1, notifier.signals());
+
+      notifier.clear();
+      EXPECT_FALSE(readable(notifier.fd()));
+      while (receiver.pop(value)) {
+      }
+      value = "3";
+      EXPECT_TRUE(sender.push(value));
+      EXPECT_TRUE(readable(notifier.fd()));
+      EXPECT_EQ(2, notifier.signals());
+      receiver.attach(nullptr);
+   }
+}  // namespace
+
+TEST(ReadinessFd, circular_fifo) {
+   BecomesReadableOnEmptyToNonEmpty<spsc::circular_fifo<std::string>>();
+}
+
+TEST(ReadinessFd, lock_queue) {
+   BecomesReadableOnEmptyToNonEmpty<mpmc::lock_queue<std::string>>();
+}
+
+TEST(ReadinessFd, MPSC_Receiver) {
+   using qtype = spsc::circular_fifo<std::string>;
+   auto q1 = queue_api::CreateQueue<qtype>(10);
+   auto q2 = queue_api::CreateQueue<qtype>(10);
+   mpsc::fixed_size::round_robin::Receiver<qtype> consumer({std::get<queue_api::index::receiver>(q1),
+                                                           std::get<queue_api::index::receiver>(q2)});
+   readiness::fd_notifier notifier;
+   consumer.attach(&notifier);
+   EXPECT_FALSE(readable(notifier.fd()));
+
+   std::string value = "second";
+   std::get<queue_api::index::sender>(q2).push(value);
+   EXPECT_TRUE(readable(notifier.fd()));
+   notifier.clear();
+   EXPECT_TRUE(consumer.pop(value));
+   EXPECT_EQ("second", value);
+   EXPECT_FALSE(readable(notifier.fd()));
+   consumer.attach(nullptr);
+}
+
+TEST(ReadinessFd, ConsumerSleepsInPoll) {
+   const int kItems = 50000;
+   readiness::fd_notifier notifier;
+   auto queue = queue_api::CreateQueue<spsc::circular_fifo<int>>(64);
+   auto sender = std::get<queue_api::index::sender>(queue);
+   auto receiver = std::get<queue_api::index::receiver>(queue);
+   receiver.attach(&notifier);
+
+   auto producer = std::async(std::launch::async, [sender, kItems]() mutable {
+      for (int i = 1; i <= kItems; ++i) {
+         int value = i;
+         while (!sender.push(value)) {
+            std::this_thread::yield();
+         }
+      }
+   });
+
+   int expected = 1;
+   while (expected <= kItems) {
+      ASSERT_TRUE(readable(notifier.fd(), 5000)) << "lost wakeup at: " << expected;
+      notifier.clear();
+      int value = 0;
+      while (receiver.pop(value)) {
+         ASSERT_EQ(expected, value);
+         ++expected;
+      }
+   }
+   producer.wait();
+   EXPECT_LE(notifier.signals(), static_cast<uint64_t>(kItems));
+   receiver.attach(nullptr);
+}
+#endif  // !defined(_WIN32)
@@ -0,0 +1,163 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "q/rpc_channel.hpp"
+
+namespace {
+   auto echo = [](std::string& request) { return request + "!"; };
+}  // namespace
+
+TEST(RpcChannel, Initialization) {
+   auto channel = rpc::CreateChannel<std::string, std::string>(4);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+   EXPECT_EQ(4, client.capacity());
+   EXPECT_EQ(0, client.in_flight());
+   EXPECT_EQ(0, server.serve(echo));
+}
+
+TEST(RpcChannel, RepliesArePickedUpInAnyOrder) {
+   auto channel = rpc::CreateChannel<std::string, std::string>(4);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+
+   std::string request = "hello";
+   auto first = client.call(request);
+   request = "world";
+   auto second = client.call(request);
+   ASSERT_TRUE(first.valid());
+   ASSERT_TRUE(second.valid());
+   EXPECT_NE(first.id(), second.id());
+   EXPECT_EQ(2, client.in_flight());
+   EXPECT_FALSE(first.ready());
+
+   EXPECT_EQ(2, server.serve(echo));
+   EXPECT_TRUE(first.ready());
+   EXPECT_EQ("world!", second.get());
+   EXPECT_EQ("hello!", first.get());
+   EXPECT_FALSE(first.valid());
+   EXPECT_EQ(0, client.in_flight());
+}
+
+TEST(RpcChannel, CallFailsWhenAllSlotsAreInUse) {
+   auto channel = rpc::CreateChannel<int, int>(2);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+   auto twice = [](int& value) { return value * 2; };
+
+   int request = 1;
+   auto first = client.call(request);
+   auto second = client.call(request);
+   request = 3;
+   auto third = client.call(request);
+   EXPECT_FALSE(third.valid());
+   EXPECT_EQ(3, request);  // untouched
+
+   EXPECT_EQ(1, server.serve(twice, 1));
+   EXPECT_EQ(2, first.get());
+   third = client.call(request);
+   ASSERT_TRUE(third.valid());
+   EXPECT_EQ(2, server.serve(twice));
+   EXPECT_EQ(6, third.get());
+   EXPECT_EQ(2, second.get());
+}
+
+TEST(RpcChannel, AbandonedCallGivesBackItsSlot) {
+   auto channel = rpc::CreateChannel<int, int>(1);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+   auto same = [](int& value) { return value; };
+
+   int request = 1;
+   {
+      auto dropped = client.call(request);
+      EXPECT_TRUE(dropped.valid());
+   }
+   EXPECT_EQ(1, client.in_flight());  // the reply is still on its way
+   request = 2;
+   EXPECT_FALSE(client.call(request).valid());
+
+   EXPECT_EQ(1, server.serve(same));
+   auto next = client.call(request);  // the reply arrived, the call collects the slot
+   ASSERT_TRUE(next.valid());
+   EXPECT_EQ(1, server.serve(same));
+   EXPECT_EQ(2, next.get());
+}
+
+// a client that drops every future keeps getting slots back
+TEST(RpcChannel, DroppedFuturesDoNotLeakSlots) {
+   auto channel = rpc::CreateChannel<int, int>(2);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+   auto same = [](int& value) { return value; };
+
+   for (int round = 0; round < 10; ++round) {
+      for (int i = 0; i < 2; ++i) {
+         int request = i;
+         EXPECT_TRUE(client.call(request).valid());  // dropped at once
+      }
+      EXPECT_EQ(2, server.serve(same));
+   }
+}
+
+TEST(RpcChannel, InvalidFutureIsNeverReady) {
+   auto channel = rpc::CreateChannel<int, int>(1);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+
+   rpc::future<int, int> empty;
+   EXPECT_FALSE(empty.valid());
+   EXPECT_FALSE(empty.ready());
+   int reply = 0;
+   EXPECT_FALSE(empty.try_get(reply));
+
+   int request = 7;
+   auto call = client.call(request);
+   auto moved = std::move(call);
+   EXPECT_FALSE(call.ready());
+   EXPECT_EQ(1, server.serve([](int& value) { return value; }));
+   EXPECT_EQ(7, moved.get());
+   EXPECT_FALSE(moved.ready());  // already taken
+}
+
+TEST(RpcChannel, PingPongThreaded) {
+   const int kCalls = 100000;
+   auto channel = rpc::CreateChannel<int, int>(8);
+   auto client = std::get<rpc::index::client>(channel);
+   auto server = std::get<rpc::index::server>(channel);
+
+   std::atomic<bool> done{false};
+   std::thread serving([&] {
+      while (!done.load()) {
+         if (0 == server.serve([](int& value) { return value + 1; })) {
+            std::this_thread::yield();
+         }
+      }
+   });
+
+   int errors = 0;
+   for (int i = 0; i < kCalls; ++i) {
+      int request = i;
+      auto reply = client.call(request);
+      if (reply.get() != i + 1) {
+         ++errors;
+      }
+   }
+   done = true;
+   serving.join();
+   EXPECT_EQ(0, errors);
+   EXPECT_EQ(0, client.in_flight());
+}
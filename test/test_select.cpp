@@ -0,0 +1,151 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <string>
+#include <thread>
+#include "q/mpmc.hpp"
+#include "q/q_api.hpp"
+#include "q/select.hpp"
+#include "q/spsc.hpp"
+#include "stopwatch.hpp"
+
+namespace {
+   using ControlQ = mpmc::lock_queue<std::string>;
+   using DataQ = spsc::circular_fifo<int>;
+}  // namespace
+
+TEST(Select, TimeoutWhenNothingIsReady) {
+   auto control = queue_api::CreateQueue<ControlQ>(10);
+   auto data = queue_api::CreateQueue<DataQ>(10);
+   selector::select select;
+   select.add(std::get<queue_api::index::receiver>(control));
+   select.add(std::get<queue_api::index::receiver>(data));
+   EXPECT_EQ(2, select.size());
+   EXPECT_EQ(selector::select::kTimeout, select.poll());
+
+   benchmark::stopwatch watch;
+   EXPECT_EQ(selector::select::kTimeout, select.wait(std::chrono::milliseconds(50)));
+   EXPECT_GE(watch.elapsed_ms(), 50);
+}
+
+TEST(Select, ReturnsTheReadySource) {
+   auto control = queue_api::CreateQueue<ControlQ>(10);
+   auto data = queue_api::CreateQueue<DataQ>(10);
+   selector::select select;
+   auto control_id = select.add(std::get<queue_api::index::receiver>(control));
+   auto data_id = select.add(std::get<queue_api::index::receiver>(data));
+
+   int value = 42;
+   EXPECT_TRUE(std::get<queue_api::index::sender>(data).push(value));
+   EXPECT_EQ(data_id, select.wait(std::chrono::milliseconds(0)));
+
+   std::string command = "stop";
+   EXPECT_TRUE(std::get<queue_api::index::sender>(control).push(command));
+   EXPECT_EQ(control_id, select.poll());  // control was added first, same priority
+
+   std::string received;
+   EXPECT_TRUE(std::get<queue_api::index::receiver>(control).pop(received));
+   EXPECT_EQ("stop", received);
+   EXPECT_EQ(data_id, select.poll());
+}
+
+TEST(Select, PriorityOrdering) {
+   auto control = queue_api::CreateQueue<ControlQ>(10);
+   auto data = queue_api::CreateQueue<DataQ>(10);
+   selector::select select;
+   auto data_id = select.add(std::get<queue_api::index::receiver>(data), 0);
+   auto control_id = select.add(std::get<queue_api::index::receiver>(control), 10);
+
+   int value = 1;
+   std::string command = "reload";
+   std::get<queue_api::index::sender>(data).push(value);
+   std::get<queue_api::index::sender>(control).push(command);
+   EXPECT_EQ(control_id, select.poll());
+   EXPECT_NE(data_id, select.poll());
+}
+
+TEST(Select, WakesUpOnPushFromOtherThread) {
+   using namespace std::chrono_literals;
+   auto control = queue_api::CreateQueue<ControlQ>(10);
+   auto data = queue_api::CreateQueue<DataQ>(10);
+   selector::select select;
+   select.add(std::get<queue_api::index::receiver>(control));
+   auto data_id = select.add(std::get<queue_api::index::receiver>(data));
+
+   auto sender = std::get<queue_api::index::sender>(data);
+   auto producer = std::async(std::launch::async, [sender]() mutable {
+      std::this_thread::sleep_for(20ms);
+      int value = 7;
+      return sender.push(value);
+   });
+
+   benchmark::stopwatch watch;
+   EXPECT_EQ(data_id, select.wait(10s));
+   EXPECT_LT(watch.elapsed_ms(), 5000);
+   EXPECT_TRUE(producer.get());
+}
+
+TEST(Select, ManyWakeups) {
+   using namespace std::chrono_literals;
+   const int kItems = 10000;
+   auto data = queue_api::CreateQueue<DataQ>(16);
+   auto receiver = std::get<queue_api::index::receiver>(data);
+   selector::select select;
+   auto data_id = select.add(receiver);
+
+   auto sender = std::get<queue_api::index::sender>(data);
+   auto producer = std::async(std::launch::async, [sender, kItems]() mutable {
+      for (int i = 1; i <= kItems; ++i) {
+         int value = i;
+         while (!sender.push(value)) {
+            std::this_thread::yield();
+         }
+      }
+   });
+
+   int expected = 1;
+   while (expected <= kItems) {
+      ASSERT_EQ(data_id, select.wait(10s));
+      int value = 0;
+      while (receiver.pop(value)) {
+         ASSERT_EQ(expected, value);
+         ++expected;
+      }
+   }
+   producer.wait();
+}
+
+TEST(Select, Timer) {
+   using namespace std::chrono_literals;
+   auto data = queue_api::CreateQueue<DataQ>(10);
+   selector::select select;
+   select.add(std::get<queue_api::index::receiver>(data));
+   auto timer_id = select.add_timer(20ms);
+
+   benchmark::stopwatch watch;
+   EXPECT_EQ(timer_id, select.wait(10s));
+   EXPECT_GE(watch.elapsed_ms(), 19);
+   EXPECT_EQ(selector::select::kTimeout, select.poll());  // re-armed
+}
+
+// a timer that is several periods late fires once and is then re-armed after 'now'
+TEST(Select, LateTimerFiresOnce) {
+   using namespace std::chrono_literals;
+   selector::select select;
+   auto timer_id = select.add_timer(20ms);
+
+   std::this_thread::sleep_for(50ms);  // past two periods
+   EXPECT_EQ(timer_id, select.poll());
+   EXPECT_EQ(selector::select::kTimeout, select.poll());
+   EXPECT_EQ(selector::select::kTimeout, select.poll());
+}
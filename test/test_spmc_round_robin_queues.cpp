@@ -90,3 +90,35 @@ TEST(SingleProducer_MultipleConsumers, push) {
    EXPECT_TRUE(producer.push(arg));
    EXPECT_FALSE(producer.push(arg));
 }
+
+TEST(SingleProducer_MultipleConsumers, StaticPush) {
+   using qtype = spsc::circular_fifo<std::string>;
+   auto lanes = round_robin::CreateLanes<qtype, 2>(1);
+   auto& receivers = lanes.second;
+   spmc::static_size::round_robin::Sender<qtype, 2> producer(lanes.first);
+   EXPECT_EQ(2, producer.capacity());
+
+   std::string arg = "s0";
+   EXPECT_TRUE(producer.push(arg));
+   std::string recv;
+   EXPECT_FALSE(receivers[1].pop(recv));
+   EXPECT_TRUE(receivers[0].pop(recv));
+   EXPECT_EQ("s0", recv);
+
+   arg = "s1";
+   EXPECT_TRUE(producer.push(arg));
+   arg = "s2";
+   EXPECT_TRUE(producer.push(arg));
+   EXPECT_TRUE(producer.full());
+   EXPECT_FALSE(producer.push(arg));
+
+   EXPECT_TRUE(receivers[1].pop(recv));
+   EXPECT_EQ("s1", recv);
+   EXPECT_TRUE(receivers[0].pop(recv));
+   EXPECT_EQ("s2", recv);
+
+   producer.close();
+   EXPECT_TRUE(producer.push(arg).closed());
+   EXPECT_TRUE(receivers[0].pop(recv).closed());
+   EXPECT_TRUE(receivers[1].pop(recv).closed());
+}
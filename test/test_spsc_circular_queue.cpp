@@ -10,7 +10,10 @@
 * Originally published at: https://github.com/KjellKod/Q
 */
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <string>
+#include <vector>
+#include "q/q_api.hpp"
 #include "q/spsc.hpp"
 
 using namespace std;
@@ -160,3 +163,78 @@ TEST(SPCS_CircularQueue, AddTillFullRemoveTillEmpty) {
    spsc::circular_fifo<string> dQ(10);
    AddTillFullRemoveTillEmpty(dQ);
 }
+
+TEST(SPCS_CircularQueue, BulkPushPopWrapsAround) {
+   spsc::circular_fifo<int> q(10);
+   int in[12];
+   int out[12];
+   int next = 0;
+   int expected = 0;
+   for (size_t round = 0; round < 20; ++round) {
+      const size_t count = 1 + round % 12;  // sometimes more than fits
+      for (size_t i = 0; i < count; ++i) {
+         in[i] = next + static_cast<int>(i);
+      }
+      const size_t pushed = q.push_n(in, count);
+      EXPECT_EQ(std::min(count, q.capacity() - (q.size() - pushed)), pushed);
+      next += static_cast<int>(pushed);
+
+      const size_t popped = q.pop_n(out, 1 + round % 7);
+      for (size_t i = 0; i < popped; ++i) {
+         EXPECT_EQ(expected++, out[i]);
+      }
+   }
+   while (size_t popped = q.pop_n(out, 12)) {
+      for (size_t i = 0; i < popped; ++i) {
+         EXPECT_EQ(expected++, out[i]);
+      }
+   }
+   EXPECT_EQ(next, expected);
+   EXPECT_TRUE(q.empty());
+}
+
+TEST(SPCS_CircularQueue, BulkMovesNonTrivialElements) {
+   spsc::circular_fifo<string> q(4);
+   string in[] = {"a", "b", "c", "d", "e"};
+   EXPECT_EQ(size_t{4}, q.push_n(in, 5));
+   EXPECT_TRUE(in[0].empty());
+   EXPECT_EQ("e", in[4]);  // did not fit, not moved from
+   string out[2];
+   EXPECT_EQ(size_t{2}, q.pop_n(out, 2));
+   EXPECT_EQ("a", out[0]);
+   EXPECT_EQ("b", out[1]);
+   EXPECT_EQ(size_t{1}, q.push_n(&in[4], 1));
+   string rest[3];
+   EXPECT_EQ(size_t{3}, q.pop_n(rest, 3));
+   EXPECT_EQ("c", rest[0]);
+   EXPECT_EQ("e", rest[2]);
+
+   q.close();
+   EXPECT_EQ(size_t{0}, q.push_n(in, 1));
+   EXPECT_EQ(size_t{0}, q.pop_n(out, 2));
+}
+
+TEST(SPCS_CircularQueue, PeekSplitsWhereTheRingWraps) {
+   auto queue = queue_api::CreateQueue<spsc::circular_fifo<unsigned int>>(5);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.peek().empty());
+
+   unsigned int in[] = {1, 2, 3, 4, 5};
+   EXPECT_EQ(size_t{4}, producer.push_n(in, 4));
+   consumer.consume(3);
+   EXPECT_EQ(size_t{4}, producer.push_n(in + 1, 4));  // 2, 3, 4, 5 wrap around
+
+   auto view = consumer.peek();
+   ASSERT_EQ(size_t{5}, view.size());
+   EXPECT_EQ(size_t{3}, view.first.size);  // slots 3, 4 and 5 up to the end of the ring
+   EXPECT_EQ(size_t{2}, view.second.size);
+   std::vector<unsigned int> seen(view.first.begin(), view.first.end());
+   seen.insert(seen.end(), view.second.begin(), view.second.end());
+   EXPECT_EQ((std::vector<unsigned int>{4, 2, 3, 4, 5}), seen);
+   EXPECT_EQ(size_t{5}, consumer.size());  // peek takes nothing
+
+   consumer.consume(view.size());
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_TRUE(consumer.peek().empty());
+}
@@ -0,0 +1,202 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/q_api.hpp"
+#include "q/readiness.hpp"
+#include "q/spsc_pointer_fifo.hpp"
+
+namespace {
+   std::atomic<int> g_deleted{0};
+   struct counting_delete {
+      void operator()(std::string* text) const {
+         ++g_deleted;
+         delete text;
+      }
+   };
+   using counted_string = std::unique_ptr<std::string, counting_delete>;
+
+   struct counting_observer : readiness::observer {
+      void notify() override { ++notified; }
+      std::atomic<int> notified{0};
+   };
+}  // namespace
+
+TEST(PointerFifo, RawPointersInOrder) {
+   auto queue = queue_api::CreateQueue<spsc::pointer_fifo<int*>>(3);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   EXPECT_TRUE(consumer.empty());
+   EXPECT_TRUE(producer.lock_free());
+   EXPECT_EQ(size_t{3}, producer.capacity());
+
+   int values[4] = {1, 2, 3, 4};
+   int* item = nullptr;
+   EXPECT_FALSE(consumer.pop(item));
+   for (int i = 0; i < 3; ++i) {
+      item = &values[i];
+      EXPECT_TRUE(producer.push(item));
+   }
+   EXPECT_TRUE(producer.full());
+   EXPECT_EQ(size_t{3}, consumer.size());
+   EXPECT_EQ(size_t{100}, producer.usage());
+   item = &values[3];
+   auto pushed = producer.push(item);
+   EXPECT_FALSE(pushed);
+   EXPECT_FALSE(pushed.closed());
+   EXPECT_EQ(&values[3], item);
+
+   for (int i = 0; i < 3; ++i) {
+      EXPECT_TRUE(consumer.pop(item));
+      EXPECT_EQ(&values[i], item);
+   }
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(consumer.empty());
+}
+
+// the look-ahead must never let the producer overwrite a slot the consumer has not taken
+TEST(PointerFifo, LookAheadNeverOverwrites) {
+   for (size_t size : {1, 2, 5, 64, 300}) {
+      auto queue = queue_api::CreateQueue<spsc::pointer_fifo<size_t*>>(size);
+      auto producer = std::get<queue_api::index::sender>(queue);
+      auto consumer = std::get<queue_api::index::receiver>(queue);
+      std::vector<size_t> values(10 * size + 7);
+      size_t next_push = 0;
+      size_t next_pop = 0;
+      for (size_t round = 0; next_pop < values.size(); ++round) {
+         const size_t to_push = 1 + round % (size + 1);  // sometimes more than fits
+         for (size_t i = 0; i < to_push && next_push < values.size(); ++i) {
+            size_t* item = &values[next_push];
+            if (!producer.push(item)) {
+               EXPECT_EQ(size, consumer.size());
+               break;
+            }
+            ++next_push;
+         }
+         const size_t to_pop = 1 + round % 3;
+         size_t* item = nullptr;
+         for (size_t i = 0; i < to_pop && consumer.pop(item); ++i) {
+            ASSERT_EQ(&values[next_pop], item);
+            ++next_pop;
+         }
+      }
+      EXPECT_TRUE(consumer.empty());
+   }
+}
+
+TEST(PointerFifo, UniquePtrOwnership) {
+   g_deleted = 0;
+   {
+      auto queue = queue_api::CreateQueue<spsc::pointer_fifo<counted_string>>(2);
+      auto producer = std::get<queue_api::index::sender>(queue);
+      auto consumer = std::get<queue_api::index::receiver>(queue);
+      counted_string item(new std::string("hello"));
+      EXPECT_TRUE(producer.push(item));
+      EXPECT_TRUE(nullptr == item);
+      item.reset(new std::string("world"));
+      EXPECT_TRUE(producer.push(item));
+      item.reset(new std::string("no room"));
+      EXPECT_FALSE(producer.push(item));
+      ASSERT_TRUE(nullptr != item);
+      EXPECT_EQ("no room", *item);
+
+      EXPECT_TRUE(consumer.pop(item));  // "no room" is deleted when replaced
+      EXPECT_EQ("hello", *item);
+      EXPECT_EQ(1, g_deleted.load());
+   }
+   EXPECT_EQ(3, g_deleted.load());  // what was left in the queue is deleted with it
+}
+
+TEST(PointerFifo, RejectsSizeZero) {
+   EXPECT_THROW(spsc::pointer_fifo<int*>(0), std::invalid_argument);
+   spsc::pointer_fifo<int*> one(1);
+   int value = 1;
+   int* item = &value;
+   EXPECT_TRUE(one.push(item));
+   EXPECT_FALSE(one.push(item));
+   EXPECT_TRUE(one.pop(item));
+   EXPECT_EQ(&value, item);
+}
+
+TEST(PointerFifo, DrainThenClosed) {
+   auto queue = queue_api::CreateQueue<spsc::pointer_fifo<std::unique_ptr<std::string>>>(10);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   auto item = std::make_unique<std::string>("hello");
+   EXPECT_TRUE(producer.push(item));
+   producer.close();
+   EXPECT_TRUE(consumer.closed());
+
+   item = std::make_unique<std::string>("too late");
+   EXPECT_TRUE(producer.push(item).closed());
+   EXPECT_EQ("too late", *item);
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_EQ("hello", *item);
+   EXPECT_TRUE(consumer.pop(item).closed());
+   EXPECT_TRUE(consumer.wait_and_pop(item, std::chrono::milliseconds(0)).closed());
+}
+
+TEST(PointerFifo, NotifiesWhenTheConsumerCaughtUp) {
+   auto queue = queue_api::CreateQueue<spsc::pointer_fifo<int*>>(10);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+   counting_observer observer;
+   consumer.attach(&observer);
+
+   int value = 1;
+   int* item = &value;
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_EQ(1, observer.notified.load());
+   EXPECT_TRUE(producer.push(item));  // the consumer has not caught up, no wakeup
+   EXPECT_EQ(1, observer.notified.load());
+
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_TRUE(consumer.pop(item));
+   EXPECT_FALSE(consumer.pop(item));
+   EXPECT_TRUE(producer.push(item));
+   EXPECT_EQ(2, observer.notified.load());
+   producer.close();
+   EXPECT_EQ(3, observer.notified.load());
+   consumer.attach(nullptr);
+}
+
+TEST(PointerFifo, ProducerConsumerThreads) {
+   const uint64_t kItems = 200000;
+   auto queue = queue_api::CreateQueue<spsc::pointer_fifo<std::unique_ptr<uint64_t>>>(128);
+   auto producer = std::get<queue_api::index::sender>(queue);
+   auto consumer = std::get<queue_api::index::receiver>(queue);
+
+   std::thread pushing([producer]() mutable {
+      for (uint64_t i = 1; i <= kItems; ++i) {
+         auto item = std::make_unique<uint64_t>(i);
+         while (!producer.push(item)) {
+            std::this_thread::yield();
+         }
+      }
+      producer.close();
+   });
+   uint64_t expected = 1;
+   for (auto& item : consumer) {
+      ASSERT_EQ(expected, *item);
+      ++expected;
+   }
+   pushing.join();
+   EXPECT_EQ(kItems + 1, expected);
+   EXPECT_TRUE(consumer.empty());
+}
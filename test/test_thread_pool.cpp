@@ -0,0 +1,109 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "q/thread_pool.hpp"
+
+namespace {
+   uint64_t fibonacci(executor::work_stealing_pool& pool, const unsigned int n) {
+      if (n < 2) {
+         return n;
+      }
+      auto left = pool.submit([&pool, n] { return fibonacci(pool, n - 1); });
+      uint64_t right = fibonacci(pool, n - 2);
+      return left.get() + right;
+   }
+
+   struct NoDefault {
+      explicit NoDefault(int v) : value(v) {}
+      int value;
+   };
+}  // namespace
+
+TEST(ThreadPool, Initialization) {
+   executor::work_stealing_pool pool(3);
+   EXPECT_EQ(3, pool.workers());
+   EXPECT_EQ(3, pool.live_workers());
+   EXPECT_FALSE(pool.run_one());
+}
+
+TEST(ThreadPool, SubmitReturnsValue) {
+   executor::work_stealing_pool pool(2);
+   auto number = pool.submit([] { return 42; });
+   auto text = pool.submit([] { return std::string("hello"); });
+   std::atomic<bool> done{false};
+   auto nothing = pool.submit([&done] { done = true; });
+   EXPECT_EQ(42, number.get());
+   EXPECT_EQ("hello", text.get());
+   nothing.get();
+   EXPECT_TRUE(done.load());
+   EXPECT_TRUE(number.ready());
+}
+
+TEST(ThreadPool, ResultNeedsNoDefaultConstructor) {
+   executor::work_stealing_pool pool(1);
+   auto result = pool.submit([] { return NoDefault(7); });
+   EXPECT_EQ(7, result.get().value);
+}
+
+TEST(ThreadPool, ExceptionIsRethrownFromGet) {
+   executor::work_stealing_pool pool(1);
+   auto failed = pool.submit([]() -> int { throw std::runtime_error("task failed"); });
+   EXPECT_THROW(failed.get(), std::runtime_error);
+}
+
+TEST(ThreadPool, ForkJoinDoesNotDeadlock) {
+   // every worker blocks in 'get' on its children, only possible since waiting runs other tasks
+   executor::work_stealing_pool pool(2);
+   auto result = pool.submit([&pool] { return fibonacci(pool, 20); });
+   EXPECT_EQ(6765, result.get());
+}
+
+TEST(ThreadPool, ManyTasksFromManyThreads) {
+   const size_t kThreads = 4;
+   const size_t kTasks = 20000;
+   std::atomic<uint64_t> sum{0};
+   {
+      executor::work_stealing_pool pool(4);
+      std::vector<std::thread> submitters;
+      for (size_t t = 0; t < kThreads; ++t) {
+         submitters.emplace_back([&] {
+            for (size_t i = 1; i <= kTasks; ++i) {
+               pool.submit([&sum, i] { sum.fetch_add(i); });
+            }
+         });
+      }
+      for (auto& t : submitters) {
+         t.join();
+      }
+   }  // the destructor runs what is left
+
+   EXPECT_EQ(kThreads * kTasks * (kTasks + 1) / 2, sum.load());
+}
+
+TEST(ThreadPool, WorkersExitOnDestruction) {
+   std::atomic<size_t> ran{0};
+   {
+      executor::work_stealing_pool pool(2);
+      for (int i = 0; i < 100; ++i) {
+         pool.submit([&ran] {
+            std::this_thread::sleep_for(std::chrono::microseconds(10));
+            ++ran;
+         });
+      }
+   }
+   EXPECT_EQ(100, ran.load());
+}
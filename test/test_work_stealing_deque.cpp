@@ -0,0 +1,112 @@
+/* Not any company's property but Public-Domain
+* Do with source-code as you will. No requirement to keep this
+* header if need to use it/change it/ or do whatever with it
+*
+* Note that there is No guarantee that this code will work
+* and I take no responsibility for this code and any problems you
+* might get if using it.
+*
+* Originally published at: https://github.com/KjellKod/Q
+*/
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "q/work_stealing_deque.hpp"
+
+TEST(WorkStealingDeque, Initialization) {
+   work_stealing::deque<int> deque(10);
+   EXPECT_TRUE(deque.empty());
+   EXPECT_EQ(0, deque.size());
+   EXPECT_EQ(16, deque.capacity());  // power of two
+   EXPECT_TRUE(deque.lock_free());
+   int item = 0;
+   EXPECT_FALSE(deque.pop(item));
+   EXPECT_FALSE(deque.steal(item));
+}
+
+TEST(WorkStealingDeque, OwnerIsLifoThiefIsFifo) {
+   work_stealing::deque<int> deque;
+   for (int i = 1; i <= 4; ++i) {
+      EXPECT_TRUE(deque.push(i));
+   }
+   EXPECT_EQ(4, deque.size());
+
+   int item = 0;
+   EXPECT_TRUE(deque.pop(item));
+   EXPECT_EQ(4, item);
+   EXPECT_TRUE(deque.steal(item));
+   EXPECT_EQ(1, item);
+   EXPECT_TRUE(deque.pop(item));
+   EXPECT_EQ(3, item);
+   EXPECT_TRUE(deque.steal(item));
+   EXPECT_EQ(2, item);
+   EXPECT_TRUE(deque.empty());
+   EXPECT_FALSE(deque.pop(item));
+   EXPECT_FALSE(deque.steal(item));
+}
+
+TEST(WorkStealingDeque, GrowsWhenFull) {
+   work_stealing::deque<int> deque(2);
+   EXPECT_EQ(2, deque.capacity());
+   int item = 0;
+   EXPECT_TRUE(deque.push(item));
+   EXPECT_TRUE(deque.steal(item));  // the items wrap around in the new array
+
+   for (int i = 0; i < 100; ++i) {
+      EXPECT_TRUE(deque.push(i));
+   }
+   EXPECT_EQ(100, deque.size());
+   EXPECT_EQ(128, deque.capacity());
+   for (int i = 0; i < 100; ++i) {
+      EXPECT_TRUE(deque.steal(item));
+      EXPECT_EQ(i, item);
+   }
+   EXPECT_TRUE(deque.empty());
+}
+
+TEST(WorkStealingDeque, EveryItemIsTakenExactlyOnce) {
+   const uint64_t kItems = 200000;
+   const size_t kThieves = 4;
+   work_stealing::deque<uint64_t> deque(16);  // small, to grow while thieves are stealing
+   std::atomic<bool> done{false};
+   std::atomic<uint64_t> stolen_sum{0};
+   std::atomic<uint64_t> stolen_count{0};
+
+   std::vector<std::thread> thieves;
+   for (size_t i = 0; i < kThieves; ++i) {
+      thieves.emplace_back([&] {
+         uint64_t item = 0;
+         while (!done.load() || !deque.empty()) {
+            if (deque.steal(item)) {
+               stolen_sum += item;
+               ++stolen_count;
+            }
+         }
+      });
+   }
+
+   uint64_t popped_sum = 0;
+   uint64_t popped_count = 0;
+   uint64_t item = 0;
+   for (uint64_t i = 1; i <= kItems; ++i) {
+      deque.push(i);
+      if (i % 3 == 0 && deque.pop(item)) {
+         popped_sum += item;
+         ++popped_count;
+      }
+   }
+   while (deque.pop(item)) {
+      popped_sum += item;
+      ++popped_count;
+   }
+   done = true;
+   for (auto& t : thieves) {
+      t.join();
+   }
+
+   EXPECT_EQ(kItems, popped_count + stolen_count.load());
+   EXPECT_EQ(kItems * (kItems + 1) / 2, popped_sum + stolen_sum.load());
+   EXPECT_TRUE(deque.empty());
+}